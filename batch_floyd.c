@@ -0,0 +1,408 @@
+/* File:     batch_floyd.c
+ *
+ * Purpose:  Solve the all-pairs shortest path problem for a large batch
+ *           of small, independent digraphs with Floyd's algorithm.
+ *
+ *           The graphs are processed in groups of LANES.  A group is
+ *           stored as a structure of arrays over its graphs:  entry
+ *           (i, j) of the LANES graphs is stored in LANES consecutive
+ *           ints,
+ *
+ *              d[(i*n_max + j)*LANES + lane]
+ *
+ *           so a single SIMD add and min relaxes entry (i, j) of 8 (or
+ *           16) graphs at once, and every graph in the group follows
+ *           the same loops.  The threads take groups from a shared
+ *           counter.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o batch_floyd batch_floyd.c
+ *              -lpthread
+ *           (Add -DLANES=16 to relax 16 graphs at once:  see note 3.)
+ * Run:      ./batch_floyd gen <count> <min_n> <max_n> <file>
+ *              Generate count random graphs with min_n to max_n
+ *              vertices, as gen_mat does, and write them to file
+ *           ./batch_floyd <thread_count> <in_file> <out_file> [c]
+ *              Find the shortest path costs of the graphs in in_file
+ *              and write them to out_file.  With c, check the results
+ *              against the serial algorithm in floyd.c.
+ *
+ * Input:    A packed binary file of 32-bit ints in the machine's own
+ *           byte order:  the number of graphs, and then, for each
+ *           graph, n, followed by the n x n adjacency matrix in row
+ *           major order.  Infinity is INFINITY, as in floyd.c.
+ * Output:   out_file, in the same format, with the matrices replaced
+ *           by the costs of the shortest paths.  The time for the
+ *           computation, and the time including reading and writing.
+ *
+ * Notes:
+ * 1.  A group is padded to the number of vertices of its largest
+ *     graph, n_max, with extra vertices that have no edges.  They
+ *     can't be on a path, so they don't change the costs.  A short
+ *     last group is padded with empty graphs.  So it's best if the
+ *     graphs in the file are sorted by size.
+ * 2.  The file is read and solved CHUNK groups at a time, so the whole
+ *     batch doesn't have to fit in memory.
+ * 3.  If the compiler is targeting AVX2 and LANES is a multiple of 8,
+ *     the relaxations use AVX2 intrinsics.  Otherwise the loop over
+ *     the lanes is left to the compiler's vectorizer:  e.g. with
+ *     -march=native -DLANES=16 on a system with AVX-512.
+ * 4.  Sums of two costs are at most 2*INFINITY, so they can't
+ *     overflow.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timer.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifndef LANES
+#define LANES 8
+#endif
+#define CHUNK 64
+
+const int INFINITY = 1000000;
+const int MAX_COST = 10;
+
+typedef struct {
+   int  count;        /* Number of real graphs in the group */
+   int  n[LANES];     /* Number of vertices of each graph   */
+   int  n_max;
+   int* d;            /* n_max*n_max*LANES ints             */
+} group_t;
+
+/* Shared by the threads */
+int      thread_count;
+int      group_count;
+int      next_group;
+group_t* groups;
+
+void Usage(char* prog_name);
+void Generate(int count, int min_n, int max_n, char* file_name);
+int  Read_group(FILE* fp, int remaining, group_t* group);
+void Write_group(FILE* fp, group_t* group);
+void Floyd_group(group_t* group);
+void* Pth_floyd(void* rank);
+void Solve_chunk(void);
+int  Check_group(group_t* group, group_t* orig);
+void Floyd(int mat[], int n);
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   FILE *in_fp, *out_fp;
+   int total, remaining, g, check, ok = 1;
+   group_t* orig = NULL;
+   double start, finish, compute_start, compute_finish, compute = 0.0;
+
+   if (argc == 6 && strcmp(argv[1], "gen") == 0) {
+      Generate(strtol(argv[2], NULL, 10), strtol(argv[3], NULL, 10),
+            strtol(argv[4], NULL, 10), argv[5]);
+      return 0;
+   }
+   if (argc != 4 && argc != 5) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   check = (argc == 5 && strcmp(argv[4], "c") == 0);
+   if (thread_count <= 0 || (argc == 5 && !check)) Usage(argv[0]);
+
+   GET_TIME(start);
+   in_fp = fopen(argv[2], "rb");
+   out_fp = fopen(argv[3], "wb");
+   if (in_fp == NULL || out_fp == NULL ||
+         fread(&total, sizeof(int), 1, in_fp) != 1) {
+      fprintf(stderr, "Can't open %s or %s\n", argv[2], argv[3]);
+      exit(-1);
+   }
+   fwrite(&total, sizeof(int), 1, out_fp);
+
+   groups = calloc(CHUNK, sizeof(group_t));
+   if (check) orig = calloc(CHUNK, sizeof(group_t));
+   remaining = total;
+   while (remaining > 0) {
+      for (group_count = 0; group_count < CHUNK && remaining > 0;
+            group_count++) {
+         if (Read_group(in_fp, remaining, &groups[group_count]) != 0) {
+            fprintf(stderr, "%s is too short\n", argv[2]);
+            exit(-1);
+         }
+         remaining -= groups[group_count].count;
+      }
+      if (check)
+         for (g = 0; g < group_count; g++) {
+            orig[g] = groups[g];
+            orig[g].d = malloc(((size_t) groups[g].n_max)*groups[g].n_max*
+                  LANES*sizeof(int));
+            memcpy(orig[g].d, groups[g].d, ((size_t) groups[g].n_max)*
+                  groups[g].n_max*LANES*sizeof(int));
+         }
+
+      GET_TIME(compute_start);
+      Solve_chunk();
+      GET_TIME(compute_finish);
+      compute += compute_finish - compute_start;
+
+      for (g = 0; g < group_count; g++) {
+         if (check && !Check_group(&groups[g], &orig[g])) ok = 0;
+         Write_group(out_fp, &groups[g]);
+         free(groups[g].d);
+         if (check) free(orig[g].d);
+      }
+   }
+   fclose(in_fp);
+   fclose(out_fp);
+   GET_TIME(finish);
+
+   printf("Solved %d graphs in %e seconds (%e graphs per second)\n",
+         total, compute, total/compute);
+   printf("Including reading and writing:  %e seconds\n", finish - start);
+   if (check)
+      printf("The costs are %s\n", ok ? "correct" : "NOT correct");
+
+   free(groups);
+   free(orig);
+   return 0;
+}  /* main */
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program and quit
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s gen <count> <min_n> <max_n> <file>\n",
+         prog_name);
+   fprintf(stderr, "       %s <thread_count> <in_file> <out_file> [c]\n",
+         prog_name);
+   fprintf(stderr, "   c:  check the results\n");
+   exit(0);
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:  Generate
+ * Purpose:   Write a batch of count random graphs with min_n to max_n
+ *            vertices to file_name.  The edges are generated as in
+ *            gen_mat.c, so the batch is the same for the same
+ *            arguments.
+ * In args:   all
+ */
+void Generate(int count, int min_n, int max_n, char* file_name) {
+   FILE* fp = fopen(file_name, "wb");
+   int g, n, i, j, val;
+   int* mat;
+
+   if (fp == NULL || count <= 0 || min_n <= 0 || max_n < min_n) {
+      fprintf(stderr, "Can't generate %s\n", file_name);
+      exit(-1);
+   }
+   mat = malloc(((size_t) max_n)*max_n*sizeof(int));
+   fwrite(&count, sizeof(int), 1, fp);
+   for (g = 0; g < count; g++) {
+      n = min_n + random() % (max_n - min_n + 1);
+      for (i = 0; i < n; i++)
+         for (j = 0; j < n; j++)
+            if (i == j) {
+               mat[i*n + j] = 0;
+            } else {
+               val = random() % MAX_COST + 1;
+               mat[i*n + j] = (val == MAX_COST) ? INFINITY : val;
+            }
+      fwrite(&n, sizeof(int), 1, fp);
+      fwrite(mat, sizeof(int), ((size_t) n)*n, fp);
+   }
+   free(mat);
+   fclose(fp);
+}  /* Generate */
+
+/*-------------------------------------------------------------------
+ * Function:  Read_group
+ * Purpose:   Read the next LANES graphs (or the remaining graphs, if
+ *            there are fewer) into group, interleaving and padding
+ *            them (see note 1)
+ * In args:   fp
+ *            remaining:  the number of graphs left in the file
+ * Out arg:   group
+ * Ret val:   0 on success, -1 if the file is too short
+ */
+int Read_group(FILE* fp, int remaining, group_t* group) {
+   int lane, i, j, n, n_max = 0;
+   int* mats[LANES];
+   size_t nn;
+
+   memset(group, 0, sizeof(group_t));
+   group->count = (remaining < LANES) ? remaining : LANES;
+   for (lane = 0; lane < group->count; lane++) {
+      if (fread(&n, sizeof(int), 1, fp) != 1 || n <= 0) return -1;
+      nn = ((size_t) n)*n;
+      mats[lane] = malloc(nn*sizeof(int));
+      if (fread(mats[lane], sizeof(int), nn, fp) != nn) return -1;
+      group->n[lane] = n;
+      if (n > n_max) n_max = n;
+   }
+
+   group->n_max = n_max;
+   group->d = malloc(((size_t) n_max)*n_max*LANES*sizeof(int));
+   for (i = 0; i < n_max; i++)
+      for (j = 0; j < n_max; j++)
+         for (lane = 0; lane < LANES; lane++) {
+            n = group->n[lane];
+            group->d[(i*n_max + j)*LANES + lane] =
+               (i < n && j < n) ? mats[lane][i*n + j] :
+               (i == j) ? 0 : INFINITY;
+         }
+   for (lane = 0; lane < group->count; lane++)
+      free(mats[lane]);
+   return 0;
+}  /* Read_group */
+
+/*-------------------------------------------------------------------
+ * Function:  Write_group
+ * Purpose:   Write the real graphs in group to fp in the input format
+ * In args:   fp, group
+ */
+void Write_group(FILE* fp, group_t* group) {
+   int lane, i, j, n, n_max = group->n_max;
+   int* row = malloc(n_max*sizeof(int));
+
+   for (lane = 0; lane < group->count; lane++) {
+      n = group->n[lane];
+      fwrite(&n, sizeof(int), 1, fp);
+      for (i = 0; i < n; i++) {
+         for (j = 0; j < n; j++)
+            row[j] = group->d[(i*n_max + j)*LANES + lane];
+         fwrite(row, sizeof(int), n, fp);
+      }
+   }
+   free(row);
+}  /* Write_group */
+
+/*-------------------------------------------------------------------
+ * Function:    Floyd_group
+ * Purpose:     Apply Floyd's algorithm to the LANES graphs in group at
+ *              once
+ * In/out arg:  group
+ */
+void Floyd_group(group_t* group) {
+   int n = group->n_max, k, i, j;
+   int *d = group->d, *d_ik, *d_ij, *d_kj;
+#  if defined(__AVX2__) && LANES % 8 == 0
+   __m256i ik[LANES/8], sum;
+   int v;
+#  else
+   int lane, temp;
+#  endif
+
+   for (k = 0; k < n; k++)
+      for (i = 0; i < n; i++) {
+         d_ik = d + (i*n + k)*LANES;
+#        if defined(__AVX2__) && LANES % 8 == 0
+         for (v = 0; v < LANES/8; v++)
+            ik[v] = _mm256_loadu_si256((__m256i*) (d_ik + 8*v));
+         for (j = 0; j < n; j++) {
+            d_ij = d + (i*n + j)*LANES;
+            d_kj = d + (k*n + j)*LANES;
+            for (v = 0; v < LANES/8; v++) {
+               sum = _mm256_add_epi32(ik[v],
+                     _mm256_loadu_si256((__m256i*) (d_kj + 8*v)));
+               _mm256_storeu_si256((__m256i*) (d_ij + 8*v),
+                     _mm256_min_epi32(sum,
+                        _mm256_loadu_si256((__m256i*) (d_ij + 8*v))));
+            }
+         }
+#        else
+         for (j = 0; j < n; j++) {
+            d_ij = d + (i*n + j)*LANES;
+            d_kj = d + (k*n + j)*LANES;
+            for (lane = 0; lane < LANES; lane++) {
+               temp = d_ik[lane] + d_kj[lane];
+               d_ij[lane] = (temp < d_ij[lane]) ? temp : d_ij[lane];
+            }
+         }
+#        endif
+      }
+}  /* Floyd_group */
+
+/*-------------------------------------------------------------------
+ * Function:       Pth_floyd
+ * Purpose:        Thread function:  solve groups until there are none
+ *                 left in the chunk
+ * In arg:         rank
+ * Global in vars: group_count
+ * Global in/out:  next_group, groups
+ * Note:           The groups may have different sizes, so they're
+ *                 handed out one at a time instead of in blocks.
+ */
+void* Pth_floyd(void* rank) {
+   int g;
+
+   while ((g = __atomic_fetch_add(&next_group, 1, __ATOMIC_RELAXED))
+         < group_count)
+      Floyd_group(&groups[g]);
+
+   return NULL;
+}  /* Pth_floyd */
+
+/*-------------------------------------------------------------------
+ * Function:       Solve_chunk
+ * Purpose:        Start thread_count threads to solve the groups in
+ *                 groups[0 .. group_count-1], and wait for them
+ * Global in vars: thread_count, group_count
+ * Global in/out:  next_group, groups
+ */
+void Solve_chunk(void) {
+   long       thread;
+   pthread_t* thread_handles;
+
+   next_group = 0;
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         Pth_floyd, (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   free(thread_handles);
+}  /* Solve_chunk */
+
+/*-------------------------------------------------------------------
+ * Function:  Check_group
+ * Purpose:   Solve each graph of orig with the serial Floyd, and
+ *            compare with the graph in group
+ * In args:   group, orig:  the group before it was solved
+ * Ret val:   1 if the costs are the same, 0 otherwise
+ */
+int Check_group(group_t* group, group_t* orig) {
+   int lane, i, j, n, n_max = group->n_max, ok = 1;
+   int* mat = malloc(((size_t) n_max)*n_max*sizeof(int));
+
+   for (lane = 0; lane < group->count; lane++) {
+      n = group->n[lane];
+      for (i = 0; i < n; i++)
+         for (j = 0; j < n; j++)
+            mat[i*n + j] = orig->d[(i*n_max + j)*LANES + lane];
+      Floyd(mat, n);
+      for (i = 0; i < n; i++)
+         for (j = 0; j < n; j++)
+            if (mat[i*n + j] != group->d[(i*n_max + j)*LANES + lane])
+               ok = 0;
+   }
+   free(mat);
+   return ok;
+}  /* Check_group */
+
+/*-------------------------------------------------------------------
+ * Function:    Floyd
+ * Purpose:     Apply Floyd's algorithm to the matrix mat (see floyd.c)
+ * In arg:      n
+ * In/out arg:  mat
+ */
+void Floyd(int mat[], int n) {
+   int int_city, city1, city2, temp;
+
+   for (int_city = 0; int_city < n; int_city++)
+      for (city1 = 0; city1 < n; city1++)
+         for (city2 = 0; city2 < n; city2++) {
+            temp = mat[city1*n + int_city] + mat[int_city*n + city2];
+            if (temp < mat[city1*n+city2])
+               mat[city1*n + city2] = temp;
+         }
+}  /* Floyd */
@@ -0,0 +1,361 @@
+/* File:     ckpt.c
+ *
+ * Purpose:  Implement asynchronous checkpoints written by a background
+ *           thread, and restarting from them.  See ckpt.h.
+ *
+ * Compile:  Compile and link with a program that uses the functions,
+ *           e.g.
+ *           mpicc -g -Wall -o mpi_floyd mpi_floyd.c par_output.c ckpt.c
+ *              -lpthread
+ *
+ * File format:
+ *    ckpt_header_t (magic, step, size, checksum), then size bytes of
+ *    data.  The checksum is a Fletcher-style pair of sums over the data
+ *    taken 8 bytes at a time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "ckpt.h"
+
+#define CKPT_MAGIC "CKPT001"
+#define NAME_MAX_LEN 4096
+
+typedef struct {
+   char     magic[8];
+   long     step;
+   uint64_t size;
+   uint64_t checksum;
+} ckpt_header_t;
+
+static void* Writer(void* arg);
+static int   Next_slot(ckpt_t* ck);
+static int   Write_file(const char* prefix, int rank, int slot, long step,
+      const char* data, size_t size);
+static int   Read_header(const char* prefix, int rank, int slot,
+      ckpt_header_t* header, FILE** fp_p);
+static uint64_t Checksum(const char* data, size_t size);
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_init
+ * Purpose:    Initialize ck and start its writer thread
+ * In args:    prefix:  the checkpoint files are <prefix>.<rank>.<slot>
+ *             rank
+ *             keep_step:  when restarting, the step that was loaded.
+ *                The slot holding it isn't overwritten until
+ *                Ckpt_keep is called with a newer step.  -1 if not
+ *                restarting:  then any existing checkpoint files with
+ *                prefix and rank are removed.
+ * Out arg:    ck
+ */
+void Ckpt_init(ckpt_t* ck, const char* prefix, int rank, long keep_step) {
+   ckpt_header_t header;
+   FILE* fp;
+   char name[NAME_MAX_LEN];
+   int slot;
+
+   ck->prefix = strdup(prefix);
+   ck->rank = rank;
+   for (slot = 0; slot < 2; slot++) {
+      ck->slot_step[slot] = -1;
+      if (keep_step >= 0) {
+         if (Read_header(prefix, rank, slot, &header, &fp) == 0) {
+            fclose(fp);
+            ck->slot_step[slot] = header.step;
+         }
+      } else {
+         /* Don't let a restart find the files of an earlier run */
+         snprintf(name, NAME_MAX_LEN, "%s.%d.%d", prefix, rank, slot);
+         remove(name);
+      }
+   }
+   ck->keep_step = keep_step;
+   ck->buf = NULL;
+   ck->size = ck->capacity = 0;
+   ck->step = -1;
+   ck->pending = ck->done = ck->error = 0;
+   ck->last_step = keep_step;
+   pthread_mutex_init(&ck->mutex, NULL);
+   pthread_cond_init(&ck->cond, NULL);
+   pthread_create(&ck->writer, NULL, Writer, ck);
+}  /* Ckpt_init */
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_save
+ * Purpose:    Start a checkpoint of data:  wait for the previous
+ *             checkpoint to be written, copy data, and have the writer
+ *             thread write the copy
+ * In args:    step, data, size
+ * In/out arg: ck
+ */
+void Ckpt_save(ckpt_t* ck, long step, const void* data, size_t size) {
+   pthread_mutex_lock(&ck->mutex);
+   while (ck->pending)
+      pthread_cond_wait(&ck->cond, &ck->mutex);
+   if (size > ck->capacity) {
+      free(ck->buf);
+      ck->buf = malloc(size);
+      ck->capacity = size;
+   }
+   memcpy(ck->buf, data, size);
+   ck->size = size;
+   ck->step = step;
+   ck->pending = 1;
+   ck->error = 0;
+   pthread_cond_broadcast(&ck->cond);
+   pthread_mutex_unlock(&ck->mutex);
+}  /* Ckpt_save */
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_wait
+ * Purpose:    Wait until the last checkpoint started has been written
+ * In/out arg: ck
+ * Ret val:    0 if the last checkpoint started was written (or none
+ *             was started), -1 if its write failed
+ */
+int Ckpt_wait(ckpt_t* ck) {
+   int error;
+
+   pthread_mutex_lock(&ck->mutex);
+   while (ck->pending)
+      pthread_cond_wait(&ck->cond, &ck->mutex);
+   error = ck->error;
+   pthread_mutex_unlock(&ck->mutex);
+   return error ? -1 : 0;
+}  /* Ckpt_wait */
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_keep
+ * Purpose:    Make keep_step the checkpoint that later writes mustn't
+ *             overwrite, e.g. the newest step every rank has written
+ * In arg:     keep_step:  -1 to allow either slot to be overwritten
+ * In/out arg: ck
+ */
+void Ckpt_keep(ckpt_t* ck, long keep_step) {
+   pthread_mutex_lock(&ck->mutex);
+   ck->keep_step = keep_step;
+   pthread_mutex_unlock(&ck->mutex);
+}  /* Ckpt_keep */
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_last_step
+ * Purpose:    Return the step of the newest checkpoint this rank has
+ *             written completely, or the keep_step passed to
+ *             Ckpt_init if it hasn't written one
+ * In arg:     ck
+ */
+long Ckpt_last_step(ckpt_t* ck) {
+   long step;
+
+   pthread_mutex_lock(&ck->mutex);
+   step = ck->last_step;
+   pthread_mutex_unlock(&ck->mutex);
+   return step;
+}  /* Ckpt_last_step */
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_finalize
+ * Purpose:    Wait for the last checkpoint to be written, stop the
+ *             writer thread, and free the storage used by ck
+ * In/out arg: ck
+ */
+void Ckpt_finalize(ckpt_t* ck) {
+   pthread_mutex_lock(&ck->mutex);
+   ck->done = 1;
+   pthread_cond_broadcast(&ck->cond);
+   pthread_mutex_unlock(&ck->mutex);
+   pthread_join(ck->writer, NULL);
+
+   pthread_mutex_destroy(&ck->mutex);
+   pthread_cond_destroy(&ck->cond);
+   free(ck->buf);
+   free(ck->prefix);
+}  /* Ckpt_finalize */
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_latest
+ * Purpose:    Find the newest complete checkpoint of this rank with
+ *             size bytes of data
+ * In args:    prefix, rank, size
+ * Ret val:    The step of the checkpoint, or -1 if there isn't one
+ * Note:       The checksums aren't verified until the data is loaded.
+ */
+long Ckpt_latest(const char* prefix, int rank, size_t size) {
+   ckpt_header_t header;
+   FILE* fp;
+   long latest = -1;
+   int slot;
+
+   for (slot = 0; slot < 2; slot++)
+      if (Read_header(prefix, rank, slot, &header, &fp) == 0) {
+         fclose(fp);
+         if (header.size == size && header.step > latest)
+            latest = header.step;
+      }
+   return latest;
+}  /* Ckpt_latest */
+
+/*-------------------------------------------------------------------
+ * Function:   Ckpt_load
+ * Purpose:    Load this rank's checkpoint of step
+ * In args:    prefix, rank, step, size
+ * Out arg:    data
+ * Ret val:    0 if a checkpoint of step with size bytes was found and
+ *             its checksum is correct, -1 otherwise
+ */
+int Ckpt_load(const char* prefix, int rank, long step, void* data,
+      size_t size) {
+   ckpt_header_t header;
+   FILE* fp;
+   int slot, ok;
+
+   for (slot = 0; slot < 2; slot++) {
+      if (Read_header(prefix, rank, slot, &header, &fp) != 0) continue;
+      ok = (header.step == step && header.size == size &&
+            fread(data, 1, size, fp) == size &&
+            Checksum(data, size) == header.checksum);
+      fclose(fp);
+      if (ok) return 0;
+   }
+   return -1;
+}  /* Ckpt_load */
+
+/*-------------------------------------------------------------------
+ * Function:   Next_slot
+ * Purpose:    Choose the slot for the next checkpoint:  not the one
+ *             holding keep_step, and otherwise the one with the older
+ *             checkpoint
+ * In arg:     ck
+ * Note:       Called with ck->mutex locked
+ */
+static int Next_slot(ckpt_t* ck) {
+   if (ck->keep_step >= 0 && ck->slot_step[0] == ck->keep_step) return 1;
+   if (ck->keep_step >= 0 && ck->slot_step[1] == ck->keep_step) return 0;
+   return (ck->slot_step[0] <= ck->slot_step[1]) ? 0 : 1;
+}  /* Next_slot */
+
+/*-------------------------------------------------------------------
+ * Function:   Writer
+ * Purpose:    Thread function:  write each checkpoint started by
+ *             Ckpt_save to the slot chosen by Next_slot
+ * In/out arg: arg:  the ckpt_t
+ * Note:       A failed write leaves the old file in its slot, since
+ *             the new one is only renamed over it once it's complete.
+ */
+static void* Writer(void* arg) {
+   ckpt_t* ck = (ckpt_t*) arg;
+   int failed, slot;
+
+   pthread_mutex_lock(&ck->mutex);
+   while (1) {
+      while (!ck->pending && !ck->done)
+         pthread_cond_wait(&ck->cond, &ck->mutex);
+      if (!ck->pending) break;
+
+      /* Ckpt_save doesn't touch buf while pending is set */
+      slot = Next_slot(ck);
+      pthread_mutex_unlock(&ck->mutex);
+      failed = Write_file(ck->prefix, ck->rank, slot, ck->step,
+            ck->buf, ck->size);
+      pthread_mutex_lock(&ck->mutex);
+
+      if (failed) {
+         ck->error = 1;
+      } else {
+         ck->last_step = ck->step;
+         ck->slot_step[slot] = ck->step;
+      }
+      ck->pending = 0;
+      pthread_cond_broadcast(&ck->cond);
+   }
+   pthread_mutex_unlock(&ck->mutex);
+   return NULL;
+}  /* Writer */
+
+/*-------------------------------------------------------------------
+ * Function:   Write_file
+ * Purpose:    Write a checkpoint to <prefix>.<rank>.<slot>.tmp, flush
+ *             it to disk, and rename it <prefix>.<rank>.<slot>
+ * In args:    all
+ * Ret val:    0 on success, -1 on failure
+ */
+static int Write_file(const char* prefix, int rank, int slot, long step,
+      const char* data, size_t size) {
+   char name[NAME_MAX_LEN], tmp_name[NAME_MAX_LEN + 4];
+   ckpt_header_t header;
+   FILE* fp;
+   int ok;
+
+   snprintf(name, NAME_MAX_LEN, "%s.%d.%d", prefix, rank, slot);
+   snprintf(tmp_name, NAME_MAX_LEN + 4, "%s.tmp", name);
+   memset(&header, 0, sizeof(header));
+   strcpy(header.magic, CKPT_MAGIC);
+   header.step = step;
+   header.size = size;
+   header.checksum = Checksum(data, size);
+
+   fp = fopen(tmp_name, "wb");
+   if (fp == NULL) return -1;
+   ok = (fwrite(&header, sizeof(header), 1, fp) == 1 &&
+         fwrite(data, 1, size, fp) == size &&
+         fflush(fp) == 0 && fsync(fileno(fp)) == 0);
+   if (fclose(fp) != 0) ok = 0;
+   if (!ok || rename(tmp_name, name) != 0) {
+      remove(tmp_name);
+      return -1;
+   }
+   return 0;
+}  /* Write_file */
+
+/*-------------------------------------------------------------------
+ * Function:   Read_header
+ * Purpose:    Open <prefix>.<rank>.<slot> and read its header
+ * In args:    prefix, rank, slot
+ * Out args:   header, fp_p:  the open file, positioned at the data
+ * Ret val:    0 on success, -1 if the file doesn't exist or doesn't
+ *             start with a checkpoint header.  The file is closed on
+ *             failure.
+ */
+static int Read_header(const char* prefix, int rank, int slot,
+      ckpt_header_t* header, FILE** fp_p) {
+   char name[NAME_MAX_LEN];
+   FILE* fp;
+
+   snprintf(name, NAME_MAX_LEN, "%s.%d.%d", prefix, rank, slot);
+   fp = fopen(name, "rb");
+   if (fp == NULL) return -1;
+   if (fread(header, sizeof(*header), 1, fp) != 1 ||
+         memcmp(header->magic, CKPT_MAGIC, sizeof(header->magic)) != 0) {
+      fclose(fp);
+      return -1;
+   }
+   *fp_p = fp;
+   return 0;
+}  /* Read_header */
+
+/*-------------------------------------------------------------------
+ * Function:   Checksum
+ * Purpose:    Compute a Fletcher-style checksum of data:  a running
+ *             sum of the 8-byte words and a sum of the running sums
+ * In args:    data, size
+ * Ret val:    The checksum
+ */
+static uint64_t Checksum(const char* data, size_t size) {
+   uint64_t sum1 = 0, sum2 = 0, word;
+   size_t i;
+
+   for (i = 0; i + 8 <= size; i += 8) {
+      memcpy(&word, data + i, 8);
+      sum1 += word;
+      sum2 += sum1;
+   }
+   if (i < size) {
+      word = 0;
+      memcpy(&word, data + i, size - i);
+      sum1 += word;
+      sum2 += sum1;
+   }
+   return sum1 ^ (sum2 << 1) ^ size;
+}  /* Checksum */
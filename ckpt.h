@@ -0,0 +1,89 @@
+/* File:     ckpt.h
+ *
+ * Purpose:  Declare functions for asynchronous checkpoints of a block
+ *           of memory, and for finding and loading the latest one.
+ *
+ *           Ckpt_save copies the data into a buffer and returns, and a
+ *           background thread writes the buffer to a file.  So the
+ *           program only stops for the copy.  Each process (rank)
+ *           writes its own files, and it alternates between two of
+ *           them ("slots"):
+ *
+ *              <prefix>.<rank>.0   and   <prefix>.<rank>.1
+ *
+ *           so the file with the previous checkpoint is never the one
+ *           being written.  A file is written as <file>.tmp, flushed to
+ *           disk, and then renamed, and it starts with a header with
+ *           the step, the size of the data, and a checksum.  So a
+ *           checkpoint that was interrupted is never mistaken for a
+ *           complete one.
+ *
+ * Example:
+ *    ckpt_t ck;
+ *    Ckpt_init(&ck, "/scratch/run", my_rank, -1);
+ *    for (step = 0; step < steps; step++) {
+ *       . . .
+ *       if ((step + 1) % every == 0)
+ *          Ckpt_save(&ck, step + 1, data, size);
+ *    }
+ *    Ckpt_finalize(&ck);
+ *
+ *    // Restart
+ *    step = Ckpt_latest("/scratch/run", my_rank, size);
+ *    if (step >= 0) Ckpt_load("/scratch/run", my_rank, step, data, size);
+ *
+ * Compile:  Link with ckpt.c.  Needs -lpthread.
+ *
+ * Notes:
+ * 1.  Ckpt_save waits for the previous checkpoint to be written before
+ *     it copies the data, so there's at most one write in progress.
+ *     Ckpt_wait reports whether the last checkpoint started was
+ *     written:  a failed write doesn't make later ones look failed.
+ * 2.  In a parallel program, the ranks' latest checkpoints may differ,
+ *     and a write can fail on some ranks and succeed on others.  So
+ *     before each Ckpt_save the ranks call Ckpt_wait and agree on
+ *     whether every write succeeded.  If so, they call Ckpt_keep with
+ *     Ckpt_last_step.  The slot holding the kept step is never
+ *     overwritten, so every rank always has the newest step that
+ *     every rank confirmed, and the consistent step to restart from is
+ *     the minimum of the ranks' Ckpt_latest.  See mpi_floyd.c.  With a
+ *     single rank, call Ckpt_keep(ck, -1) after Ckpt_init:  then the
+ *     older slot is always the one overwritten.  See fin_diff.c.c.
+ * 3.  The data is stored in the machine's own format, so a checkpoint
+ *     should be loaded on the same kind of system.
+ */
+#ifndef _CKPT_H_
+#define _CKPT_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+typedef struct {
+   char*  prefix;
+   int    rank;
+   /* The step of the complete checkpoint in each slot, or -1 */
+   long   slot_step[2];
+   long   keep_step;  /* Don't overwrite the slot holding this step  */
+   char*  buf;        /* Copy of the data being written              */
+   size_t size, capacity;
+   long   step;       /* The step of the data in buf                 */
+   int    pending;    /* buf hasn't been written yet                 */
+   int    done;       /* Tells the writer thread to quit             */
+   int    error;      /* The last write failed                       */
+   long   last_step;  /* Step of the last complete checkpoint, or -1 */
+   pthread_t       writer;
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+} ckpt_t;
+
+void Ckpt_init(ckpt_t* ck, const char* prefix, int rank, long keep_step);
+void Ckpt_save(ckpt_t* ck, long step, const void* data, size_t size);
+int  Ckpt_wait(ckpt_t* ck);
+void Ckpt_keep(ckpt_t* ck, long keep_step);
+long Ckpt_last_step(ckpt_t* ck);
+void Ckpt_finalize(ckpt_t* ck);
+long Ckpt_latest(const char* prefix, int rank, size_t size);
+int  Ckpt_load(const char* prefix, int rank, long step, void* data,
+      size_t size);
+
+#endif
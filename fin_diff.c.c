@@ -2,8 +2,12 @@
  * Purpose:  Solve the one-dimensional heat equation on [0,1]x[0,1] using 
  *           finite differences.
  *
- * Compile:  gcc -g -Wall -o fin_diff fin_diff.c -lm
- * Run:      ./fin_diff
+ * Compile:  gcc -g -Wall -o fin_diff fin_diff.c ckpt.c -lm -lpthread
+ * Run:      ./fin_diff [ckpt <every> <prefix>] [restart <prefix>]
+ *              ckpt <every> <prefix>:  checkpoint the time step and u
+ *                 every <every> time steps to <prefix>.0.<0|1>
+ *              restart <prefix>:  resume from the latest checkpoint
+ *                 with prefix
  *
  * Input:    m, the number of segments into which the bar is divided
  *           n, the number of time intervals
@@ -17,14 +21,26 @@
  *     u(x,1) and u_exact(x,1) will be printed at each time step.
  * 2.  DEBUG compile flag adds extra output.
  * 3.  Boundary conditions are 0:  u(0,t) = u(1,t) = 0, for all t
+ * 4.  Checkpoints are written by a background thread (see ckpt.h), so
+ *     the time steps only wait for u to be copied.  On a restart, m, n
+ *     and the initial values are still read, the output starts at the
+ *     time step of the checkpoint, and with -DEXACT the max error only
+ *     covers the time steps after it.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include "ckpt.h"
 
 const int MAX_X = 101;
 
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], int* every_p, char** ckpt_prefix_p,
+      char** restart_prefix_p);
 void Get_input(double u[], int* m_p, int* n_p);
+int  Restart(double u[], double scratch[], int m, char* prefix);
 void Print_step(double t, double u[], int m);
 void Copy_vals(double new_u[], double old_u[], int m);
 void Print_exact(int m, double h_x, double t);
@@ -33,19 +49,30 @@ void Compare_exact(double u[], int m, double h_x, double t,
 double u_exact(double x, double t);
 
 /*-------------------------------------------------------------------*/
-int main(void) {
+int main(int argc, char* argv[]) {
    double new_u[MAX_X];
    double old_u[MAX_X];
    int m, n;
    double h_x, h_t, fact;
    double t;
-   int int_x, int_time;
+   int int_x, int_time, first_time = 0, every;
+   char *ckpt_prefix, *restart_prefix;
+   ckpt_t ck;
 #  ifdef EXACT
    double max_err = 0.0;
    double max_err_x, max_err_t;
 #  endif
 
+   Get_args(argc, argv, &every, &ckpt_prefix, &restart_prefix);
    Get_input(new_u, &m, &n);
+   if (restart_prefix != NULL)
+      first_time = Restart(new_u, old_u, m, restart_prefix);
+   if (ckpt_prefix != NULL) {
+      Ckpt_init(&ck, ckpt_prefix, 0, (first_time > 0 &&
+            strcmp(ckpt_prefix, restart_prefix) == 0) ? first_time : -1);
+      /* One process:  the newest complete checkpoint is consistent */
+      Ckpt_keep(&ck, -1);
+   }
    h_x = 1.0/m;
    h_t = 1.0/n;
    fact = h_t/(h_x*h_x);
@@ -53,13 +80,14 @@ int main(void) {
    printf("m = %d, n = %d\n", m, n);
    printf("h_x = %e, h_t = %e, fact = %e\n", h_x, h_t, fact);
 #  endif
-   Print_step(0, new_u, m);
+   Print_step(first_time*h_t, new_u, m);
 #  ifdef EXACT
-   Print_exact(m, h_x, 0.0);
-   Compare_exact(new_u, m, h_x, 0.0, &max_err, &max_err_x, &max_err_t);
+   Print_exact(m, h_x, first_time*h_t);
+   Compare_exact(new_u, m, h_x, first_time*h_t, &max_err, &max_err_x,
+         &max_err_t);
    printf("\n");
 #  endif
-   for (int_time = 1; int_time <= n; int_time++) {
+   for (int_time = first_time + 1; int_time <= n; int_time++) {
       t = int_time*h_t;
       Copy_vals(new_u, old_u, m);
       new_u[0] = new_u[m] = 0.0;  // Boundary values are 0
@@ -72,6 +100,15 @@ int main(void) {
       Compare_exact(new_u, m, h_x, t, &max_err, &max_err_x, &max_err_t);
       printf("\n");
 #     endif
+      if (ckpt_prefix != NULL && int_time % every == 0 && int_time < n)
+         Ckpt_save(&ck, int_time, new_u, (m+1)*sizeof(double));
+   }
+
+   if (ckpt_prefix != NULL) {
+      if (Ckpt_wait(&ck) != 0)
+         fprintf(stderr, "The last checkpoint with prefix %s wasn't "
+               "written\n", ckpt_prefix);
+      Ckpt_finalize(&ck);
    }
 
 #  ifdef EXACT
@@ -82,6 +119,51 @@ int main(void) {
    return 0;
 }  /* main */
 
+/*-------------------------------------------------------------------*/
+/* Function:  Usage
+ * Purpose:   Print a message showing how to run the program and quit
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s [ckpt <every> <prefix>] [restart <prefix>]\n",
+         prog_name);
+   fprintf(stderr, "   ckpt <every> <prefix>:  checkpoint every <every>"
+         " time steps\n");
+   fprintf(stderr, "   restart <prefix>:  resume from the latest"
+         " checkpoint\n");
+   exit(0);
+}  /* Usage */
+
+/*-------------------------------------------------------------------*/
+/* Function:     Get_args
+ * Purpose:      Get the optional command line arguments
+ * Input args:   argc, argv
+ * Output args:  every_p:  the number of time steps between checkpoints
+ *               ckpt_prefix_p:  the prefix of the checkpoint files, or
+ *                  NULL if there are no checkpoints
+ *               restart_prefix_p:  the prefix of the checkpoint files
+ *                  to restart from, or NULL
+ */
+void Get_args(int argc, char* argv[], int* every_p, char** ckpt_prefix_p,
+      char** restart_prefix_p) {
+   int a = 1;
+
+   *every_p = 0;
+   *ckpt_prefix_p = *restart_prefix_p = NULL;
+   while (a < argc) {
+      if (strcmp(argv[a], "ckpt") == 0 && a + 2 < argc &&
+            (*every_p = strtol(argv[a+1], NULL, 10)) > 0) {
+         *ckpt_prefix_p = argv[a+2];
+         a += 3;
+      } else if (strcmp(argv[a], "restart") == 0 && a + 1 < argc) {
+         *restart_prefix_p = argv[a+1];
+         a += 2;
+      } else {
+         Usage(argv[0]);
+      }
+   }
+}  /* Get_args */
+
 /*-------------------------------------------------------------------*/
 /* Function:     Get_input
  * Purpose:      Read the input data from stdin
@@ -101,6 +183,33 @@ void Get_input(double u[], int* m_p, int* n_p){
       scanf("%lf", &u[i]);
 }  /* Get_input */
 
+/*-------------------------------------------------------------------*/
+/* Function:     Restart
+ * Purpose:      Load the latest checkpoint with prefix
+ * Input args:   m:  the number of segments in the bar
+ *               prefix
+ * In/out arg:   u:  on output the temperatures at the time step of the
+ *                  checkpoint.  Unchanged if there's no checkpoint.
+ * Scratch:      scratch:  storage for m+1 doubles
+ * Return val:   The time step of the checkpoint, or 0 if there isn't
+ *               one
+ */
+int Restart(double u[], double scratch[], int m, char* prefix) {
+   size_t size = (m+1)*sizeof(double);
+   long step;
+
+   /* Load into scratch, so a damaged checkpoint doesn't change u */
+   step = Ckpt_latest(prefix, 0, size);
+   if (step <= 0 || Ckpt_load(prefix, 0, step, scratch, size) != 0) {
+      printf("No checkpoint with prefix %s, starting from time step 0\n",
+            prefix);
+      return 0;
+   }
+   printf("Restarting from time step %ld\n", step);
+   Copy_vals(scratch, u, m);
+   return step;
+}  /* Restart */
+
 /*-------------------------------------------------------------------*/
 /* Function:  Print_step
  * Purpose:   Print the time and the computed values for the current
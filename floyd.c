@@ -7,11 +7,14 @@
  *           mat, the adjacency matrix of the digraph
  * Output:   A matrix showing the costs of the shortest paths
  *
- * Compile:  gcc -g -Wall -o floyd floyd.c
+ * Compile:  gcc -g -Wall -O3 -march=native -o floyd floyd.c -lpthread
  *           (See note 7)
- * Run:      ./floyd
+ * Run:      ./floyd [closure <thread_count>]
  *           For large matrices, put the matrix into a file with n as
  *           the first line and run with ./floyd < large_matrix
+ *              closure <thread_count>:  only find which vertices can be
+ *                 reached from each vertex, using thread_count threads
+ *                 (see note 9)
  *
  * Notes:
  * 1.  The input matrix is overwritten by the matrix of lengths of shortest
@@ -28,29 +31,146 @@
  *     column is mat[i*n + j]
  * 7.  Use the compile flag -DSHOW_INT_MATS to print the matrix after its
  *     been updated with each intermediate city.
+ * 8.  Use the compile flag -DPERF and link with perf_counters.c to print
+ *     the elapsed time and the hardware event counts for Floyd (see
+ *     perf_counters.h):
+ *     gcc -g -Wall -DPERF -o floyd floyd.c perf_counters.c -lpthread
+ * 9.  With closure, the program computes the transitive closure with
+ *     Warshall's algorithm:  entry (i, j) of the solution is 1 if there
+ *     is a path from i to j, and 0 otherwise.  An entry of the input
+ *     that isn't INFINITY is an edge.  Each row is stored as a bitset
+ *     of 64-bit words, so a row takes n/8 bytes instead of 4n, and
+ *     updating row i with row k is row_i |= row_k, which is done 256
+ *     bits at a time if the compiler targets AVX2.  The threads split
+ *     the rows, and synchronize with a barrier after each k.
+ * 10. If every path is short enough, the shortest path costs are
+ *     computed with 8- or 16-bit unsigned ints, so twice or four times
+ *     as many entries fit in a cache line or a SIMD register.  A
+ *     shortest path has at most n-1 edges, so no cost is larger than
+ *     (n-1)*max_cost, where max_cost is the largest edge cost.  If
+ *     this is at most 254, uint8_t is used with 255 for infinity, and
+ *     if it's at most 65534, uint16_t is used with 65535 for
+ *     infinity.  Otherwise int is used.  Sums saturate at infinity, so
+ *     infinity plus anything is infinity, and a sum that's too large
+ *     can't be the cost of a shortest path.  The input and output
+ *     don't change.  With -DSHOW_INT_MATS, int is always used, and
+ *     with -DPERF the number of bits is printed.
+ * 11. A row i whose entry in column k is infinite can't change in
+ *     iteration k, so it's skipped.  Entry j of a row can only change
+ *     if entry j of row k is finite, so when row k has few finite
+ *     entries, Floyd makes a list of them and only updates those.
+ *     The list costs an indirect access per entry, so it isn't used
+ *     when a full pass over the row is cheaper:  SPARSE_* can be
+ *     changed with -D.  For sparse or disconnected graphs this skips
+ *     most of the work (see floyd_bench.c, and the density argument
+ *     of gen_mat.c).
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#ifdef PERF
+#include "timer.h"
+#include "perf_counters.h"
+#endif
 
 const int INFINITY = 1000000;
 
+/* Use the list of finite entries of row k if there are fewer than
+ * n/SPARSE_* of them (see note 11) */
+#ifndef SPARSE_INT
+#define SPARSE_INT 4
+#endif
+#ifndef SPARSE_U16
+#define SPARSE_U16 8
+#endif
+#ifndef SPARSE_U8
+#define SPARSE_U8 16
+#endif
+
+/* Closure globals */
+int       thread_count;
+int       closure_n;
+int       words;      /* 64-bit words per row, a multiple of 4 */
+uint64_t* bits;
+pthread_barrier_t barrier;
+
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], int* closure_p);
 void Read_matrix(int mat[], int n);
 void Print_matrix(int mat[], int n);
 void Floyd(int mat[], int n);
+void Pack_matrix(int mat[], int n);
+void Unpack_matrix(int mat[], int n);
+void Closure(void);
+void* Pth_closure(void* rank);
+void Or_row(uint64_t row_i[], const uint64_t row_k[], int words);
+int  Choose_width(int mat[], int n);
+void* Narrow_matrix(int mat[], int n, int width);
+void Widen_matrix(int mat[], void* narrow, int n, int width);
+void Floyd_u8(uint8_t mat[], int n);
+void Relax_u8(uint8_t row_i[], const uint8_t row_k[], uint8_t d_ik,
+      int n);
+void Floyd_u16(uint16_t mat[], int n);
+void Relax_u16(uint16_t row_i[], const uint16_t row_k[], uint16_t d_ik,
+      int n);
 
-int main(void) {
-   int  n;
+int main(int argc, char* argv[]) {
+   int  n, closure, width = 32;
    int* mat;
+   void* narrow = NULL;
+#  ifdef PERF
+   perf_counters_t counters;
+   double start, finish;
+#  endif
 
+   Get_args(argc, argv, &closure);
    printf("How many vertices?\n");
    scanf("%d", &n);
    mat = malloc(n*n*sizeof(int));
 
    printf("Enter the matrix\n");
    Read_matrix(mat, n);
+   if (closure) {
+      Pack_matrix(mat, n);
+   } else {
+      width = Choose_width(mat, n);
+      if (width < 32) narrow = Narrow_matrix(mat, n, width);
+   }
 
-   Floyd(mat, n);
+#  ifdef PERF
+   Perf_open(&counters);
+   GET_TIME(start);
+   Perf_start(&counters);
+#  endif
+   if (closure)
+      Closure();
+   else if (width == 8)
+      Floyd_u8(narrow, n);
+   else if (width == 16)
+      Floyd_u16(narrow, n);
+   else
+      Floyd(mat, n);
+#  ifdef PERF
+   Perf_stop(&counters);
+   GET_TIME(finish);
+   Perf_close(&counters);
+   if (!closure) printf("Costs stored in %d bits\n", width);
+   printf("Elapsed time = %e seconds\n", finish - start);
+   Perf_print(stdout, &counters);
+#  endif
 
+   if (closure) {
+      Unpack_matrix(mat, n);
+      free(bits);
+   } else if (narrow != NULL) {
+      Widen_matrix(mat, narrow, n, width);
+      free(narrow);
+   }
    printf("The solution is:\n");
    Print_matrix(mat, n);
 
@@ -59,6 +179,36 @@ int main(void) {
    return 0;
 }  /* main */
 
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program and quit
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s [closure <thread_count>]\n", prog_name);
+   fprintf(stderr, "   closure:  only compute which vertices are"
+         " reachable\n");
+   exit(0);
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get the optional command line arguments
+ * In args:     argc, argv
+ * Out arg:     closure_p:  1 if only the transitive closure should be
+ *              computed
+ * Out global:  thread_count
+ */
+void Get_args(int argc, char* argv[], int* closure_p) {
+   *closure_p = 0;
+   thread_count = 1;
+   if (argc == 1) return;
+   if (argc != 3 || strcmp(argv[1], "closure") != 0) Usage(argv[0]);
+   *closure_p = 1;
+   thread_count = strtol(argv[2], NULL, 10);
+   if (thread_count <= 0) Usage(argv[0]);
+}  /* Get_args */
+
 /*-------------------------------------------------------------------
  * Function:  Read_matrix
  * Purpose:   Read in the adjacency matrix
@@ -100,18 +250,352 @@ void Print_matrix(int mat[], int n) {
  *              vertices.
  */
 void Floyd(int mat[], int n) {
-   int int_city, city1, city2, temp;
+   int int_city, city1, city2, temp, d_ik, count, c;
+   int *row_k, *row_i;
+   int* cols = malloc(n*sizeof(int));
 
    for (int_city = 0; int_city < n; int_city++) {
-      for (city1 = 0; city1 < n; city1++)
-         for (city2 = 0; city2 < n; city2++) {
-               temp = mat[city1*n + int_city] + mat[int_city*n + city2];
-               if (temp < mat[city1*n+city2])
-                  mat[city1*n + city2] = temp;
+      row_k = mat + int_city*n;
+      count = 0;
+      for (city2 = 0; city2 < n; city2++)
+         if (row_k[city2] != INFINITY) cols[count++] = city2;
+      for (city1 = 0; city1 < n; city1++) {
+         row_i = mat + city1*n;
+         d_ik = row_i[int_city];
+         if (d_ik == INFINITY) continue;
+         if (count < n/SPARSE_INT) {
+            for (c = 0; c < count; c++) {
+               city2 = cols[c];
+               temp = d_ik + row_k[city2];
+               if (temp < row_i[city2]) row_i[city2] = temp;
+            }
+         } else {
+            for (city2 = 0; city2 < n; city2++) {
+               temp = d_ik + row_k[city2];
+               if (temp < row_i[city2]) row_i[city2] = temp;
+            }
          }
+      }
 #     ifdef SHOW_INT_MATS
       printf("After int_city = %d\n", int_city);
       Print_matrix(mat, n);
 #     endif
    }
-}  /* Floyd */
\ No newline at end of file
+   free(cols);
+}  /* Floyd */
+
+/*-------------------------------------------------------------------
+ * Function:     Pack_matrix
+ * Purpose:      Store the adjacency matrix as rows of bits:  bit j of
+ *               row i is set if there's an edge from i to j
+ * In args:      mat, n
+ * Out globals:  closure_n, words, bits
+ */
+void Pack_matrix(int mat[], int n) {
+   int i, j;
+
+   closure_n = n;
+   words = 4*((n + 255)/256);
+   bits = calloc(((size_t) n)*words, sizeof(uint64_t));
+   for (i = 0; i < n; i++)
+      for (j = 0; j < n; j++)
+         if (mat[i*n + j] != INFINITY)
+            bits[((size_t) i)*words + j/64] |= ((uint64_t) 1) << (j % 64);
+}  /* Pack_matrix */
+
+/*-------------------------------------------------------------------
+ * Function:    Unpack_matrix
+ * Purpose:     Store the transitive closure in mat:  1 if bit j of
+ *              row i is set, 0 otherwise
+ * In arg:      n
+ * In globals:  words, bits
+ * Out arg:     mat
+ */
+void Unpack_matrix(int mat[], int n) {
+   int i, j;
+
+   for (i = 0; i < n; i++)
+      for (j = 0; j < n; j++)
+         mat[i*n + j] = (bits[((size_t) i)*words + j/64] >> (j % 64)) & 1;
+}  /* Unpack_matrix */
+
+/*-------------------------------------------------------------------
+ * Function:    Closure
+ * Purpose:     Compute the transitive closure of the packed matrix
+ *              with thread_count threads
+ * In globals:  thread_count, closure_n, words
+ * In/out global:  bits
+ */
+void Closure(void) {
+   long       thread;
+   pthread_t* thread_handles;
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   pthread_barrier_init(&barrier, NULL, thread_count);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         Pth_closure, (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   pthread_barrier_destroy(&barrier);
+   free(thread_handles);
+}  /* Closure */
+
+/*-------------------------------------------------------------------
+ * Function:       Pth_closure
+ * Purpose:        Thread function:  apply Warshall's algorithm to a
+ *                 block of rows of the packed matrix
+ * In arg:         rank
+ * Global in vars: thread_count, closure_n, words
+ * Global in/out:  bits
+ * Note:           Row k isn't changed in iteration k, so the only
+ *                 synchronization needed is a barrier after each k.
+ */
+void* Pth_closure(void* rank) {
+   long my_rank = (long) rank;
+   int n = closure_n, quotient = n/thread_count, rem = n % thread_count;
+   int my_first, my_last, i, k;
+   uint64_t *row_k, mask;
+
+   if (my_rank < rem) {
+      my_first = my_rank*(quotient + 1);
+      my_last = my_first + quotient + 1;
+   } else {
+      my_first = my_rank*quotient + rem;
+      my_last = my_first + quotient;
+   }
+
+   for (k = 0; k < n; k++) {
+      row_k = bits + ((size_t) k)*words;
+      mask = ((uint64_t) 1) << (k % 64);
+      for (i = my_first; i < my_last; i++)
+         if (i != k && (bits[((size_t) i)*words + k/64] & mask))
+            Or_row(bits + ((size_t) i)*words, row_k, words);
+      pthread_barrier_wait(&barrier);
+   }
+
+   return NULL;
+}  /* Pth_closure */
+
+/*-------------------------------------------------------------------
+ * Function:    Or_row
+ * Purpose:     row_i |= row_k
+ * In args:     row_k, words:  a multiple of 4
+ * In/out arg:  row_i
+ */
+void Or_row(uint64_t row_i[], const uint64_t row_k[], int words) {
+   int w;
+
+#  if defined(__AVX2__)
+   __m256i a, b;
+
+   for (w = 0; w < words; w += 4) {
+      a = _mm256_loadu_si256((__m256i*) (row_i + w));
+      b = _mm256_loadu_si256((const __m256i*) (row_k + w));
+      _mm256_storeu_si256((__m256i*) (row_i + w), _mm256_or_si256(a, b));
+   }
+#  else
+   for (w = 0; w < words; w++)
+      row_i[w] |= row_k[w];
+#  endif
+}  /* Or_row */
+
+/*-------------------------------------------------------------------
+ * Function:  Choose_width
+ * Purpose:   Find the narrowest unsigned type that can store every
+ *            shortest path cost and infinity (see note 10)
+ * In args:   mat, n
+ * Ret val:   8, 16, or 32 (int)
+ */
+int Choose_width(int mat[], int n) {
+   int i, max_cost = 0;
+   long bound;
+
+#  ifdef SHOW_INT_MATS
+   return 32;
+#  endif
+   for (i = 0; i < n*n; i++)
+      if (mat[i] != INFINITY && mat[i] > max_cost)
+         max_cost = mat[i];
+   bound = ((long) n - 1)*max_cost;
+   if (bound <= UINT8_MAX - 1)
+      return 8;
+   else if (bound <= UINT16_MAX - 1)
+      return 16;
+   else
+      return 32;
+}  /* Choose_width */
+
+/*-------------------------------------------------------------------
+ * Function:  Narrow_matrix
+ * Purpose:   Copy mat into a new matrix of 8- or 16-bit unsigned ints,
+ *            with INFINITY replaced by the largest value of the type
+ * In args:   mat, n, width:  8 or 16
+ * Ret val:   The new matrix
+ */
+void* Narrow_matrix(int mat[], int n, int width) {
+   int i;
+   uint8_t* mat8;
+   uint16_t* mat16;
+
+   if (width == 8) {
+      mat8 = malloc(((size_t) n)*n*sizeof(uint8_t));
+      for (i = 0; i < n*n; i++)
+         mat8[i] = (mat[i] == INFINITY) ? UINT8_MAX : mat[i];
+      return mat8;
+   } else {
+      mat16 = malloc(((size_t) n)*n*sizeof(uint16_t));
+      for (i = 0; i < n*n; i++)
+         mat16[i] = (mat[i] == INFINITY) ? UINT16_MAX : mat[i];
+      return mat16;
+   }
+}  /* Narrow_matrix */
+
+/*-------------------------------------------------------------------
+ * Function:  Widen_matrix
+ * Purpose:   Copy the 8- or 16-bit matrix narrow back into mat, with
+ *            the largest value of the type replaced by INFINITY
+ * In args:   narrow, n, width
+ * Out arg:   mat
+ */
+void Widen_matrix(int mat[], void* narrow, int n, int width) {
+   int i;
+   uint8_t* mat8 = narrow;
+   uint16_t* mat16 = narrow;
+
+   for (i = 0; i < n*n; i++)
+      if (width == 8)
+         mat[i] = (mat8[i] == UINT8_MAX) ? INFINITY : mat8[i];
+      else
+         mat[i] = (mat16[i] == UINT16_MAX) ? INFINITY : mat16[i];
+}  /* Widen_matrix */
+
+/*-------------------------------------------------------------------
+ * Function:    Floyd_u8
+ * Purpose:     Apply Floyd's algorithm to a matrix of 8-bit costs
+ * In arg:      n
+ * In/out arg:  mat:  UINT8_MAX is infinity
+ */
+void Floyd_u8(uint8_t mat[], int n) {
+   int int_city, city1, j, count, c;
+   int* cols = malloc(n*sizeof(int));
+   uint8_t *row_k, *row_i, d_ik;
+   unsigned temp;
+
+   for (int_city = 0; int_city < n; int_city++) {
+      row_k = mat + ((size_t) int_city)*n;
+      count = 0;
+      for (j = 0; j < n; j++)
+         if (row_k[j] != UINT8_MAX) cols[count++] = j;
+      for (city1 = 0; city1 < n; city1++) {
+         row_i = mat + ((size_t) city1)*n;
+         d_ik = row_i[int_city];
+         if (d_ik == UINT8_MAX) continue;
+         if (count < n/SPARSE_U8) {
+            /* The sums can't saturate if they're smaller than row_i[j] */
+            for (c = 0; c < count; c++) {
+               j = cols[c];
+               temp = d_ik + row_k[j];
+               if (temp < row_i[j]) row_i[j] = temp;
+            }
+         } else {
+            Relax_u8(row_i, row_k, d_ik, n);
+         }
+      }
+   }
+   free(cols);
+}  /* Floyd_u8 */
+
+/*-------------------------------------------------------------------
+ * Function:    Relax_u8
+ * Purpose:     row_i[j] = min(row_i[j], d_ik + row_k[j]), where the sum
+ *              saturates at UINT8_MAX
+ * In args:     row_k, d_ik, n
+ * In/out arg:  row_i
+ */
+void Relax_u8(uint8_t row_i[], const uint8_t row_k[], uint8_t d_ik,
+      int n) {
+   int j = 0;
+   unsigned temp;
+#  if defined(__AVX2__)
+   __m256i d = _mm256_set1_epi8((char) d_ik), sum;
+
+   for (; j + 32 <= n; j += 32) {
+      sum = _mm256_adds_epu8(d,
+            _mm256_loadu_si256((const __m256i*) (row_k + j)));
+      _mm256_storeu_si256((__m256i*) (row_i + j), _mm256_min_epu8(sum,
+            _mm256_loadu_si256((const __m256i*) (row_i + j))));
+   }
+#  endif
+
+   for (; j < n; j++) {
+      temp = d_ik + row_k[j];
+      if (temp > UINT8_MAX) temp = UINT8_MAX;
+      if (temp < row_i[j]) row_i[j] = temp;
+   }
+}  /* Relax_u8 */
+
+/*-------------------------------------------------------------------
+ * Function:    Floyd_u16
+ * Purpose:     Apply Floyd's algorithm to a matrix of 16-bit costs
+ * In arg:      n
+ * In/out arg:  mat:  UINT16_MAX is infinity
+ */
+void Floyd_u16(uint16_t mat[], int n) {
+   int int_city, city1, j, count, c;
+   int* cols = malloc(n*sizeof(int));
+   uint16_t *row_k, *row_i, d_ik;
+   unsigned temp;
+
+   for (int_city = 0; int_city < n; int_city++) {
+      row_k = mat + ((size_t) int_city)*n;
+      count = 0;
+      for (j = 0; j < n; j++)
+         if (row_k[j] != UINT16_MAX) cols[count++] = j;
+      for (city1 = 0; city1 < n; city1++) {
+         row_i = mat + ((size_t) city1)*n;
+         d_ik = row_i[int_city];
+         if (d_ik == UINT16_MAX) continue;
+         if (count < n/SPARSE_U16) {
+            /* The sums can't saturate if they're smaller than row_i[j] */
+            for (c = 0; c < count; c++) {
+               j = cols[c];
+               temp = d_ik + row_k[j];
+               if (temp < row_i[j]) row_i[j] = temp;
+            }
+         } else {
+            Relax_u16(row_i, row_k, d_ik, n);
+         }
+      }
+   }
+   free(cols);
+}  /* Floyd_u16 */
+
+/*-------------------------------------------------------------------
+ * Function:    Relax_u16
+ * Purpose:     row_i[j] = min(row_i[j], d_ik + row_k[j]), where the sum
+ *              saturates at UINT16_MAX
+ * In args:     row_k, d_ik, n
+ * In/out arg:  row_i
+ */
+void Relax_u16(uint16_t row_i[], const uint16_t row_k[], uint16_t d_ik,
+      int n) {
+   int j = 0;
+   unsigned temp;
+#  if defined(__AVX2__)
+   __m256i d = _mm256_set1_epi16((short) d_ik), sum;
+
+   for (; j + 16 <= n; j += 16) {
+      sum = _mm256_adds_epu16(d,
+            _mm256_loadu_si256((const __m256i*) (row_k + j)));
+      _mm256_storeu_si256((__m256i*) (row_i + j), _mm256_min_epu16(sum,
+            _mm256_loadu_si256((const __m256i*) (row_i + j))));
+   }
+#  endif
+
+   for (; j < n; j++) {
+      temp = d_ik + row_k[j];
+      if (temp > UINT16_MAX) temp = UINT16_MAX;
+      if (temp < row_i[j]) row_i[j] = temp;
+   }
+}  /* Relax_u16 */
@@ -0,0 +1,242 @@
+/* File:     floyd_bench.c
+ *
+ * Purpose:  Compare the time taken by Floyd's algorithm with and
+ *           without skipping the relaxations that can't change the
+ *           matrix, for graphs with a range of densities.
+ *
+ *           In iteration k, row i can only change if mat[i][k] is
+ *           finite, and entry (i, j) can only change if mat[k][j] is
+ *           finite.  So the pruned version skips row i if mat[i][k] is
+ *           infinite, and, if row k has few finite entries, it makes a
+ *           list of their columns and only updates those.  This is the
+ *           Floyd in floyd.c and mpi_floyd.c.
+ *
+ *           Three versions are timed:
+ *              - naive:  the original triple loop, which loads
+ *                mat[i][k] in every pass of the inner loop,
+ *              - hoisted:  the same loop as the pruned version, with
+ *                mat[i][k] and the row pointers loaded outside the
+ *                inner loop, but without the pruning,
+ *              - pruned.
+ *           The speedup is hoisted/pruned, so it only measures the
+ *           pruning.  naive/hoisted is the gain from the hoisting,
+ *           which lets the compiler vectorize the inner loop.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o floyd_bench floyd_bench.c
+ * Run:      ./floyd_bench <n> [density ...]
+ *              n:  the number of vertices
+ *              density:  the probability of an edge between two
+ *                 distinct vertices (default 0.001 0.01 0.1 0.5 0.9)
+ *
+ * Input:    None.  The matrix for each density is the same as the
+ *           output of ./gen_mat <n> <density>.
+ * Output:   For each density, the fraction of finite entries in the
+ *           solution, the times of the three versions, the speedup of
+ *           pruned over hoisted, and whether their results agree.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+
+#ifndef SPARSE_INT
+#define SPARSE_INT 4
+#endif
+
+const int INFINITY = 1000000;
+const int MAX_COST = 10;
+
+void Usage(char* prog_name);
+void Gen_matrix(int mat[], int n, double density);
+void Floyd(int mat[], int n);
+void Floyd_hoisted(int mat[], int n);
+void Floyd_pruned(int mat[], int n);
+double Finite_fraction(int mat[], int n);
+
+int main(int argc, char* argv[]) {
+   double default_densities[] = {0.001, 0.01, 0.1, 0.5, 0.9};
+   double *densities = default_densities, density;
+   int density_count = 5, n, d;
+   int *orig, *mat, *hoisted, *pruned;
+   double start, finish, elapsed, hoisted_elapsed, pruned_elapsed;
+
+   if (argc < 2) Usage(argv[0]);
+   n = strtol(argv[1], NULL, 10);
+   if (n <= 0) Usage(argv[0]);
+   if (argc > 2) {
+      density_count = argc - 2;
+      densities = malloc(density_count*sizeof(double));
+      for (d = 0; d < density_count; d++)
+         densities[d] = strtod(argv[d+2], NULL);
+   }
+   orig = malloc(((size_t) n)*n*sizeof(int));
+   mat = malloc(((size_t) n)*n*sizeof(int));
+   hoisted = malloc(((size_t) n)*n*sizeof(int));
+   pruned = malloc(((size_t) n)*n*sizeof(int));
+
+   printf("  density  reachable      naive    hoisted     pruned  speedup\n");
+   for (d = 0; d < density_count; d++) {
+      density = densities[d];
+      Gen_matrix(orig, n, density);
+      memcpy(mat, orig, ((size_t) n)*n*sizeof(int));
+      memcpy(hoisted, orig, ((size_t) n)*n*sizeof(int));
+      memcpy(pruned, orig, ((size_t) n)*n*sizeof(int));
+
+      GET_TIME(start);
+      Floyd(mat, n);
+      GET_TIME(finish);
+      elapsed = finish - start;
+
+      GET_TIME(start);
+      Floyd_hoisted(hoisted, n);
+      GET_TIME(finish);
+      hoisted_elapsed = finish - start;
+
+      GET_TIME(start);
+      Floyd_pruned(pruned, n);
+      GET_TIME(finish);
+      pruned_elapsed = finish - start;
+
+      printf("%9.4f  %9.4f  %9.3e  %9.3e  %9.3e  %7.2f%s\n", density,
+            Finite_fraction(mat, n), elapsed, hoisted_elapsed,
+            pruned_elapsed, hoisted_elapsed/pruned_elapsed,
+            memcmp(mat, hoisted, ((size_t) n)*n*sizeof(int)) == 0 &&
+            memcmp(mat, pruned, ((size_t) n)*n*sizeof(int)) == 0 ?
+            "" : "  RESULTS DIFFER");
+   }
+
+   if (densities != default_densities) free(densities);
+   free(orig);
+   free(mat);
+   free(hoisted);
+   free(pruned);
+   return 0;
+}  /* main */
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program and quit
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s <n> [density ...]\n", prog_name);
+   exit(0);
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:  Gen_matrix
+ * Purpose:   Generate the matrix that gen_mat.c generates for n and
+ *            density
+ * In args:   n, density
+ * Out arg:   mat
+ */
+void Gen_matrix(int mat[], int n, double density) {
+   int i, j;
+
+   srandom(1);
+   for (i = 0; i < n; i++)
+      for (j = 0; j < n; j++)
+         if (i == j)
+            mat[i*n + j] = 0;
+         else if (random() < density*((double) RAND_MAX + 1.0))
+            mat[i*n + j] = random() % (MAX_COST - 1) + 1;
+         else
+            mat[i*n + j] = INFINITY;
+}  /* Gen_matrix */
+
+/*-------------------------------------------------------------------
+ * Function:    Floyd
+ * Purpose:     Apply Floyd's algorithm to the matrix mat, relaxing
+ *              every entry in every iteration
+ * In arg:      n
+ * In/out arg:  mat
+ */
+void Floyd(int mat[], int n) {
+   int int_city, city1, city2, temp;
+
+   for (int_city = 0; int_city < n; int_city++)
+      for (city1 = 0; city1 < n; city1++)
+         for (city2 = 0; city2 < n; city2++) {
+            temp = mat[city1*n + int_city] + mat[int_city*n + city2];
+            if (temp < mat[city1*n+city2])
+               mat[city1*n + city2] = temp;
+         }
+}  /* Floyd */
+
+/*-------------------------------------------------------------------
+ * Function:    Floyd_hoisted
+ * Purpose:     Apply Floyd's algorithm to the matrix mat, relaxing
+ *              every entry in every iteration, with the loads of
+ *              mat[i][k] and the row pointers outside the inner loop
+ *              as in Floyd_pruned
+ * In arg:      n
+ * In/out arg:  mat
+ */
+void Floyd_hoisted(int mat[], int n) {
+   int int_city, city1, city2, temp, d_ik;
+   int *row_k, *row_i;
+
+   for (int_city = 0; int_city < n; int_city++) {
+      row_k = mat + int_city*n;
+      for (city1 = 0; city1 < n; city1++) {
+         row_i = mat + city1*n;
+         d_ik = row_i[int_city];
+         for (city2 = 0; city2 < n; city2++) {
+            temp = d_ik + row_k[city2];
+            if (temp < row_i[city2]) row_i[city2] = temp;
+         }
+      }
+   }
+}  /* Floyd_hoisted */
+
+/*-------------------------------------------------------------------
+ * Function:    Floyd_pruned
+ * Purpose:     Apply Floyd's algorithm to the matrix mat, skipping
+ *              rows i with mat[i][k] infinite, and using the list of
+ *              finite entries of row k if it's short
+ * In arg:      n
+ * In/out arg:  mat
+ */
+void Floyd_pruned(int mat[], int n) {
+   int int_city, city1, city2, temp, d_ik, count, c;
+   int *row_k, *row_i;
+   int* cols = malloc(n*sizeof(int));
+
+   for (int_city = 0; int_city < n; int_city++) {
+      row_k = mat + int_city*n;
+      count = 0;
+      for (city2 = 0; city2 < n; city2++)
+         if (row_k[city2] != INFINITY) cols[count++] = city2;
+      for (city1 = 0; city1 < n; city1++) {
+         row_i = mat + city1*n;
+         d_ik = row_i[int_city];
+         if (d_ik == INFINITY) continue;
+         if (count < n/SPARSE_INT) {
+            for (c = 0; c < count; c++) {
+               city2 = cols[c];
+               temp = d_ik + row_k[city2];
+               if (temp < row_i[city2]) row_i[city2] = temp;
+            }
+         } else {
+            for (city2 = 0; city2 < n; city2++) {
+               temp = d_ik + row_k[city2];
+               if (temp < row_i[city2]) row_i[city2] = temp;
+            }
+         }
+      }
+   }
+   free(cols);
+}  /* Floyd_pruned */
+
+/*-------------------------------------------------------------------
+ * Function:  Finite_fraction
+ * Purpose:   Return the fraction of the entries of mat that are finite
+ * In args:   mat, n
+ */
+double Finite_fraction(int mat[], int n) {
+   long i, count = 0;
+
+   for (i = 0; i < ((long) n)*n; i++)
+      if (mat[i] != INFINITY) count++;
+   return ((double) count)/(((double) n)*n);
+}  /* Finite_fraction */
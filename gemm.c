@@ -0,0 +1,196 @@
+/* File:     gemm.c
+ *
+ * Purpose:  Implement a serial, cache-blocked matrix-matrix multiply
+ *           C += A*B for doubles.  See gemm.h.
+ *
+ * Compile:  Compile and link with a program that uses Gemm, e.g.
+ *           gcc -g -Wall -O3 -march=native -o pth_mat_mat pth_mat_mat.c
+ *              gemm.c -lpthread
+ *
+ * Algorithm:
+ *    for jc = 0, NC, 2*NC, . . .      (columns of C and B)
+ *       for pc = 0, KC, 2*KC, . . .   (columns of A, rows of B)
+ *          pack B[pc:pc+KC, jc:jc+NC] into Bp by NR-column slivers
+ *          for ic = 0, MC, 2*MC, . . .   (rows of C and A)
+ *             pack A[ic:ic+MC, pc:pc+KC] into Ap by MR-row slivers
+ *             for each NR-column sliver of Bp
+ *                for each MR-row sliver of Ap
+ *                   C[MR x NR tile] += sliver of Ap * sliver of Bp
+ *
+ *    The packed panel of B (KC x NC) is intended to stay in the L3
+ *    cache, the packed panel of A (MC x KC) in the L2 cache, and a
+ *    sliver of B (KC x NR) in the L1 cache.  The MR x NR tile of C is
+ *    kept in registers while it's being updated.
+ *
+ * Notes:
+ * 1.  Slivers at the bottom and right edges of the matrices are padded
+ *     with zeroes when they're packed, so the micro-kernel always
+ *     computes a full MR x NR tile.  Only the entries that are actually
+ *     in C are added into C.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gemm.h"
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+static double* Alloc_panel(size_t count);
+static void Pack_A(int mc, int kc, const double A[], int lda, double Ap[]);
+static void Pack_B(int kc, int nc, const double B[], int ldb, double Bp[]);
+static void Micro_kernel(int kc, const double Ap[], const double Bp[],
+      double C[], int ldc, int mr, int nr);
+
+/*-------------------------------------------------------------------
+ * Function:    Gemm
+ * Purpose:     Compute C += A*B
+ * In args:     m, n, k:  C is m x n, A is m x k, B is k x n
+ *              A, lda, B, ldb
+ *              ldc
+ * In/out arg:  C
+ */
+void Gemm(int m, int n, int k, const double A[], int lda,
+      const double B[], int ldb, double C[], int ldc) {
+   int jc, pc, ic, jr, ir, nc, kc, mc;
+   double* Ap = Alloc_panel(GEMM_MC*GEMM_KC);
+   double* Bp = Alloc_panel(((GEMM_NC + GEMM_NR - 1)/GEMM_NR)*GEMM_NR
+         *GEMM_KC);
+
+   for (jc = 0; jc < n; jc += GEMM_NC) {
+      nc = (n - jc < GEMM_NC) ? n - jc : GEMM_NC;
+      for (pc = 0; pc < k; pc += GEMM_KC) {
+         kc = (k - pc < GEMM_KC) ? k - pc : GEMM_KC;
+         Pack_B(kc, nc, &B[((size_t) pc)*ldb + jc], ldb, Bp);
+         for (ic = 0; ic < m; ic += GEMM_MC) {
+            mc = (m - ic < GEMM_MC) ? m - ic : GEMM_MC;
+            Pack_A(mc, kc, &A[((size_t) ic)*lda + pc], lda, Ap);
+            for (jr = 0; jr < nc; jr += GEMM_NR)
+               for (ir = 0; ir < mc; ir += GEMM_MR)
+                  Micro_kernel(kc, &Ap[ir*kc], &Bp[jr*kc],
+                        &C[((size_t) ic + ir)*ldc + jc + jr], ldc,
+                        (mc - ir < GEMM_MR) ? mc - ir : GEMM_MR,
+                        (nc - jr < GEMM_NR) ? nc - jr : GEMM_NR);
+         }
+      }
+   }
+
+   free(Ap);
+   free(Bp);
+}  /* Gemm */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Cpu_ghz
+ * Purpose:     Get the clock rate of the cpu from /proc/cpuinfo
+ * Ret val:     The clock rate in GHz, or 0 if it's not available
+ */
+double Cpu_ghz(void) {
+   char line[256];
+   double mhz = 0.0;
+   FILE* fp = fopen("/proc/cpuinfo", "r");
+
+   if (fp == NULL) return 0.0;
+   while (fgets(line, sizeof(line), fp) != NULL)
+      if (sscanf(line, "cpu MHz : %lf", &mhz) == 1) break;
+   fclose(fp);
+   return mhz/1000.0;
+}  /* Cpu_ghz */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Alloc_panel
+ * Purpose:     Allocate a cache line aligned buffer for packing
+ */
+static double* Alloc_panel(size_t count) {
+   void* panel;
+
+   if (posix_memalign(&panel, 64, count*sizeof(double)) != 0) {
+      fprintf(stderr, "Can't allocate panel\n");
+      exit(-1);
+   }
+   return panel;
+}  /* Alloc_panel */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Pack_A
+ * Purpose:     Copy an mc x kc block of A into Ap so that each
+ *              MR-row sliver is stored by columns:  the MR entries
+ *              that the micro-kernel uses in one step are contiguous
+ * In args:     mc, kc, A, lda
+ * Out arg:     Ap
+ */
+static void Pack_A(int mc, int kc, const double A[], int lda, double Ap[]) {
+   int ir, p, i;
+
+   for (ir = 0; ir < mc; ir += GEMM_MR)
+      for (p = 0; p < kc; p++)
+         for (i = 0; i < GEMM_MR; i++)
+            *Ap++ = (ir + i < mc) ? A[((size_t) ir + i)*lda + p] : 0.0;
+}  /* Pack_A */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Pack_B
+ * Purpose:     Copy a kc x nc block of B into Bp so that each
+ *              NR-column sliver is stored by rows
+ * In args:     kc, nc, B, ldb
+ * Out arg:     Bp
+ */
+static void Pack_B(int kc, int nc, const double B[], int ldb, double Bp[]) {
+   int jr, p, j;
+
+   for (jr = 0; jr < nc; jr += GEMM_NR)
+      for (p = 0; p < kc; p++)
+         for (j = 0; j < GEMM_NR; j++)
+            *Bp++ = (jr + j < nc) ? B[((size_t) p)*ldb + jr + j] : 0.0;
+}  /* Pack_B */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Micro_kernel
+ * Purpose:     Add the product of an MR x kc sliver of Ap and a
+ *              kc x NR sliver of Bp into an mr x nr tile of C
+ * In args:     kc, Ap, Bp, ldc, mr, nr
+ * In/out arg:  C
+ */
+static void Micro_kernel(int kc, const double Ap[], const double Bp[],
+      double C[], int ldc, int mr, int nr) {
+   double tile[GEMM_MR*GEMM_NR];
+   int p, i, j;
+#  if defined(__AVX2__) && defined(__FMA__)
+   __m256d c[GEMM_MR][2], a, b0, b1;
+
+   for (i = 0; i < GEMM_MR; i++)
+      c[i][0] = c[i][1] = _mm256_setzero_pd();
+   for (p = 0; p < kc; p++) {
+      b0 = _mm256_load_pd(Bp);
+      b1 = _mm256_load_pd(Bp + 4);
+      for (i = 0; i < GEMM_MR; i++) {
+         a = _mm256_broadcast_sd(Ap + i);
+         c[i][0] = _mm256_fmadd_pd(a, b0, c[i][0]);
+         c[i][1] = _mm256_fmadd_pd(a, b1, c[i][1]);
+      }
+      Ap += GEMM_MR;
+      Bp += GEMM_NR;
+   }
+   for (i = 0; i < GEMM_MR; i++) {
+      _mm256_storeu_pd(&tile[i*GEMM_NR], c[i][0]);
+      _mm256_storeu_pd(&tile[i*GEMM_NR + 4], c[i][1]);
+   }
+#  else
+   memset(tile, 0, sizeof(tile));
+   for (p = 0; p < kc; p++) {
+      for (i = 0; i < GEMM_MR; i++)
+         for (j = 0; j < GEMM_NR; j++)
+            tile[i*GEMM_NR + j] += Ap[i]*Bp[j];
+      Ap += GEMM_MR;
+      Bp += GEMM_NR;
+   }
+#  endif
+
+   for (i = 0; i < mr; i++)
+      for (j = 0; j < nr; j++)
+         C[((size_t) i)*ldc + j] += tile[i*GEMM_NR + j];
+}  /* Micro_kernel */
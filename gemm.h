@@ -0,0 +1,45 @@
+/* File:     gemm.h
+ *
+ * Purpose:  Declare a serial, cache-blocked matrix-matrix multiply
+ *           C += A*B for doubles, in which A and B are copied ("packed")
+ *           into contiguous panels that are multiplied by a small
+ *           register-blocked micro-kernel.  The parallel programs
+ *           pth_mat_mat.c and mpi_mat_mat.c call Gemm on their blocks
+ *           of the matrices.
+ *
+ * Example:
+ *    #include "gemm.h"
+ *    . . .
+ *    // C is m x n, A is m x k, B is k x n, all stored by rows
+ *    Gemm(m, n, k, A, lda, B, ldb, C, ldc);
+ *
+ * Notes:
+ * 1.  Matrices are stored by rows:  the entry in row i and column j of
+ *     A is A[i*lda + j].  lda, ldb, ldc are the row strides.
+ * 2.  If the compiler targets AVX2 and FMA (e.g. gcc -O3 -march=native
+ *     or -mavx2 -mfma), the micro-kernel uses AVX2 fused multiply-adds.
+ *     Otherwise it uses plain C.
+ * 3.  GEMM_FLOPS_PER_CYCLE is the number of double precision flops a
+ *     core can start per cycle using the micro-kernel:  two 4-wide FMA
+ *     units give 16.  It's used to compute the theoretical peak.
+ */
+#ifndef _GEMM_H_
+#define _GEMM_H_
+
+#define GEMM_MR 6     /* Rows of C computed by micro-kernel    */
+#define GEMM_NR 8     /* Columns of C computed by micro-kernel */
+#define GEMM_MC 96    /* Rows of A in a packed panel           */
+#define GEMM_KC 256   /* Columns of A/rows of B in a panel     */
+#define GEMM_NC 2048  /* Columns of B in a packed panel        */
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define GEMM_FLOPS_PER_CYCLE 16
+#else
+#define GEMM_FLOPS_PER_CYCLE 2
+#endif
+
+void Gemm(int m, int n, int k, const double A[], int lda,
+      const double B[], int ldb, double C[], int ldc);
+double Cpu_ghz(void);
+
+#endif
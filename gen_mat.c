@@ -5,7 +5,10 @@
  * Output:   The number of vertices and the adjacency matrix
  *
  * Compile:  gcc -g -Wall -o gen_mat gen_mat.c
- * Run:      ./gen_mat <number of vertices>
+ * Run:      ./gen_mat <number of vertices> [density]
+ *              density:  the probability that there's an edge between
+ *                 two distinct vertices, 0 <= density <= 1.  (See
+ *                 note 5.)
  * 
  * Notes:
  * 1.  Max edge cost is MAX_COST - 1 
@@ -14,6 +17,9 @@
  * 4.  There's no guarantee that the graph is strongly connected:  there
  *     may be a pair of vertices i and j for which there's no path 
  *     i -> j.
+ * 5.  Without density, an edge is missing with probability 1/MAX_COST,
+ *     and the matrix is the same as before density was added.  With
+ *     density, the cost of an edge is uniform in 1 .. MAX_COST - 1.
  */
 
 #include <stdio.h>
@@ -26,16 +32,26 @@ void Usage(char* prog_name);
 
 int main(int argc, char* argv[]) {
    int n, i, j, val;
+   double density = -1.0;
 
-   if (argc != 2) Usage(argv[0]);
+   if (argc != 2 && argc != 3) Usage(argv[0]);
    n = strtol(argv[1], NULL, 10);
+   if (argc == 3) {
+      density = strtod(argv[2], NULL);
+      if (density < 0.0 || density > 1.0) Usage(argv[0]);
+   }
 
    printf("%d\n", n);
    for (i = 0; i < n; i++) {
       for (j = 0; j < n; j++)
          if (i == j)
             printf("0 ");
-         else {
+         else if (density >= 0.0) {
+            if (random() < density*((double) RAND_MAX + 1.0))
+               printf("%ld ", random() % (MAX_COST - 1) + 1);
+            else
+               printf("%d ", INFINITY);
+         } else {
             val = random() % MAX_COST + 1;
             if (val == MAX_COST)
                printf("%d ", INFINITY);
@@ -49,6 +65,8 @@ int main(int argc, char* argv[]) {
 }  /* main */
 
 void Usage(char* prog_name) {
-   fprintf(stderr, "usage:  %s <number of rows>\n", prog_name);
+   fprintf(stderr, "usage:  %s <number of rows> [density]\n", prog_name);
+   fprintf(stderr, "   density:  probability of an edge, 0 <= density"
+         " <= 1\n");
    exit(0);
 }  /* Usage */
\ No newline at end of file
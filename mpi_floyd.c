@@ -3,13 +3,28 @@
  *            the least cost path between each pair of vertices in a labelled
  *            digraph.
  * 
- * Compile:   mpicc -g -Wall -o mpi_floyd mpi_floyd.c
- * Run:       mpiexec -n <number of processes> ./mpi_floyd
+ * Compile:   mpicc -g -Wall -o mpi_floyd mpi_floyd.c par_output.c
+ *               ckpt.c -lpthread
+ * Run:       mpiexec -n <number of processes> ./mpi_floyd [out <file>]
+ *               [rma] [ckpt <every> <prefix>] [restart <prefix>]
+ *               [closure]
+ *               out <file>:  write the solution to file instead of
+ *                  stdout
+ *               rma:  distribute row k with one-sided communication
+ *                  instead of MPI_Bcast (see Floyd_rma)
+ *               ckpt <every> <prefix>:  checkpoint local_mat every
+ *                  <every> iterations to <prefix>.<rank>.<0|1>
+ *               restart <prefix>:  resume from the latest consistent
+ *                  checkpoint with prefix
+ *               closure:  only find which vertices can be reached
+ *                  from each vertex (see note 7).  Can't be combined
+ *                  with rma, ckpt or restart.
  *
  * Input:     n, the number of vertices
  *            mat, the adjacency matrix
  * Output:    mat, after being updated by floyd so that it contains the
- *            costs of the cheapest paths between all pairs of vertices.
+ *            costs of the cheapest paths between all pairs of vertices,
+ *            and the time taken by Floyd's algorithm.
  *
  * Notes:
  * 1.  n, the number of vertices should be evenly divisible by p, the
@@ -18,19 +33,82 @@
  *     diagonal, positive off the diagonal.  Infinity should be indicated
  *     by the constant INFINITY.  (See below.)
  * 3.  The matrix is distributed by block rows.
+ * 4.  Each process formats its own rows (see par_output.h).  When
+ *     the solution is written to a file, the processes write their
+ *     rows in parallel with MPI-IO.
+ * 5.  With rma, each process exposes local_mat in an MPI window, and
+ *     the processes read row k from its owner with MPI_Rget inside a
+ *     passive target epoch.  The owner of row k+1 updates that row
+ *     first in iteration k, and then marks it ready, so the other
+ *     processes can fetch it while they're computing with row k.
+ *     With a single process there's nothing to fetch, so rma is
+ *     ignored.
+ * 6.  A checkpoint after iteration k holds k+1 and each process' own
+ *     local_mat, and it's written by a background thread on each
+ *     process (see ckpt.h).  Before starting a checkpoint, every
+ *     process waits for its previous one to be written, and the
+ *     processes agree on whether all of them succeeded.  The newest
+ *     checkpoint that every process wrote is never overwritten, so on
+ *     a restart every process has it, and the processes restart from
+ *     the minimum of their latest steps.  The
+ *     input must still be entered on a restart:  n and the matrix are
+ *     read as usual, and the matrix is then replaced by the
+ *     checkpoint.  If there's no checkpoint, the program starts from
+ *     the beginning.
+ * 7.  With closure, the program computes the transitive closure with
+ *     Warshall's algorithm:  entry (i, j) of the solution is 1 if there
+ *     is a path from i to j, and 0 otherwise.  Each row is stored as a
+ *     bitset of 64-bit words, so the broadcast of row k sends n/8
+ *     bytes instead of 4n.  See also floyd.c.
+ * 8.  A row whose entry in column k is infinite can't change in
+ *     iteration k, so Floyd and Floyd_rma skip it.  Entry j of a row
+ *     can only change if entry j of row k is finite, so when row k has
+ *     few finite entries, Floyd makes a list of them and only updates
+ *     those.  This saves most of the work for sparse or disconnected
+ *     graphs (see floyd_bench.c).  "Few" is fewer than n/SPARSE;
+ *     compile with -DSPARSE=<d> to change the default of 4.
  */
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h> /* for debugging */
+#include <string.h>
+#include <stdint.h>
 #include <mpi.h>
+#include "par_output.h"
+#include "ckpt.h"
 
 const int INFINITY = 1000000;
 
+/* Floyd only relaxes the finite entries of row k if there are fewer
+ * than n/SPARSE of them (see note 8) */
+#ifndef SPARSE
+#define SPARSE 4
+#endif
+
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], char** out_file_p, int* rma_p,
+      int* every_p, char** ckpt_prefix_p, char** restart_prefix_p,
+      int* closure_p, int my_rank, MPI_Comm comm);
+int  Restart(int local_mat[], int n, char* prefix, int my_rank, int p,
+      MPI_Comm comm);
+void Checkpoint(ckpt_t* ck, int every, int global_k, int local_mat[],
+      int n, int my_rank, int p, MPI_Comm comm);
 void Read_matrix(int local_mat[], int n, int my_rank, int p, 
       MPI_Comm comm);
+void Format_matrix(int local_mat[], int n, int p, out_buf_t* out);
+void Write_matrix(int local_mat[], int n, int p, char* file_name,
+      MPI_Comm comm);
 void Print_matrix(int local_mat[], int n, int my_rank, int p, 
       MPI_Comm comm);
-void Floyd(int local_mat[], int n, int my_rank, int p, MPI_Comm comm);
+void Floyd(int local_mat[], int n, int first_k, int my_rank, int p,
+      MPI_Comm comm, ckpt_t* ck, int every);
+void Floyd_rma(int local_mat[], int n, int first_k, int my_rank, int p,
+      MPI_Comm comm, ckpt_t* ck, int every);
+void Floyd_closure(int local_mat[], int n, int my_rank, int p,
+      MPI_Comm comm);
+void Update_row(int local_mat[], int n, int local_i, int global_k,
+      const int row_k[]);
+void Set_flag(int value, int disp, MPI_Win flag_win, int my_rank);
+void Wait_flag(int target, int disp, int min_value, MPI_Win flag_win);
 int Owner(int k, int p, int n);
 void Copy_row(int local_mat[], int n, int p, int row_k[], int k);
 void Print_row(int local_mat[], int n, int my_rank, int i);
@@ -39,12 +117,17 @@ int main(int argc, char* argv[]) {
    int  n;
    int* local_mat;
    MPI_Comm comm;
-   int p, my_rank;
+   int p, my_rank, rma, every, closure, first_k = 0;
+   char *out_file, *ckpt_prefix, *restart_prefix;
+   double start, elapsed, max_elapsed;
+   ckpt_t ck;
 
    MPI_Init(&argc, &argv);
    comm = MPI_COMM_WORLD;
    MPI_Comm_size(comm, &p);
    MPI_Comm_rank(comm, &my_rank);
+   Get_args(argc, argv, &out_file, &rma, &every, &ckpt_prefix,
+         &restart_prefix, &closure, my_rank, comm);
 
    if (my_rank == 0) {
       printf("How many vertices?\n");
@@ -59,10 +142,34 @@ int main(int argc, char* argv[]) {
    Print_matrix(local_mat, n, my_rank, p, comm);
    if (my_rank == 0) printf("\n");
 
-   Floyd(local_mat, n, my_rank, p, comm);
+   if (restart_prefix != NULL)
+      first_k = Restart(local_mat, n, restart_prefix, my_rank, p, comm);
+   if (ckpt_prefix != NULL)
+      Ckpt_init(&ck, ckpt_prefix, my_rank, (first_k > 0 &&
+            strcmp(ckpt_prefix, restart_prefix) == 0) ? first_k : -1);
 
-   if (my_rank == 0) printf("The solution is:\n");
-   Print_matrix(local_mat, n, my_rank, p, comm);
+   MPI_Barrier(comm);
+   start = MPI_Wtime();
+   if (closure)
+      Floyd_closure(local_mat, n, my_rank, p, comm);
+   else if (rma && p > 1)
+      Floyd_rma(local_mat, n, first_k, my_rank, p, comm,
+            ckpt_prefix != NULL ? &ck : NULL, every);
+   else
+      Floyd(local_mat, n, first_k, my_rank, p, comm,
+            ckpt_prefix != NULL ? &ck : NULL, every);
+   elapsed = MPI_Wtime() - start;
+   if (ckpt_prefix != NULL) Ckpt_finalize(&ck);
+   MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+   if (out_file != NULL) {
+      Write_matrix(local_mat, n, p, out_file, comm);
+   } else {
+      if (my_rank == 0) printf("The solution is:\n");
+      Print_matrix(local_mat, n, my_rank, p, comm);
+   }
+   if (my_rank == 0)
+      printf("Elapsed time for Floyd = %e seconds\n", max_elapsed);
 
    free(local_mat);
    MPI_Finalize();
@@ -70,6 +177,81 @@ int main(int argc, char* argv[]) {
    return 0;
 }  /* main */
 
+/*---------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage:  mpiexec -n <p> %s [out <file>] [rma]\n",
+         prog_name);
+   fprintf(stderr, "           [ckpt <every> <prefix>] [restart <prefix>]"
+         " [closure]\n");
+   fprintf(stderr, "   out <file>:  write the solution to file\n");
+   fprintf(stderr, "   rma:  get row k with one-sided communication\n");
+   fprintf(stderr, "   ckpt <every> <prefix>:  checkpoint every <every>"
+         " iterations\n");
+   fprintf(stderr, "   restart <prefix>:  resume from the latest"
+         " checkpoint\n");
+   fprintf(stderr, "   closure:  only compute which vertices are"
+         " reachable\n");
+}  /* Usage */
+
+/*---------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get the optional command line arguments
+ * In args:   argc, argv, my_rank, comm
+ * Out args:  out_file_p:  the file for the solution, or NULL to print
+ *               it to stdout
+ *            rma_p:  1 if Floyd_rma should be used, 0 otherwise
+ *            every_p:  the number of iterations between checkpoints
+ *            ckpt_prefix_p:  the prefix of the checkpoint files, or
+ *               NULL if there are no checkpoints
+ *            restart_prefix_p:  the prefix of the checkpoint files to
+ *               restart from, or NULL
+ *            closure_p:  1 if only the transitive closure should be
+ *               computed, 0 otherwise
+ */
+void Get_args(int argc, char* argv[], char** out_file_p, int* rma_p,
+      int* every_p, char** ckpt_prefix_p, char** restart_prefix_p,
+      int* closure_p, int my_rank, MPI_Comm comm) {
+   int a = 1;
+
+   *out_file_p = NULL;
+   *rma_p = *closure_p = 0;
+   *every_p = 0;
+   *ckpt_prefix_p = *restart_prefix_p = NULL;
+   while (a < argc) {
+      if (strcmp(argv[a], "out") == 0 && a + 1 < argc) {
+         *out_file_p = argv[a+1];
+         a += 2;
+      } else if (strcmp(argv[a], "rma") == 0) {
+         *rma_p = 1;
+         a++;
+      } else if (strcmp(argv[a], "ckpt") == 0 && a + 2 < argc &&
+            (*every_p = strtol(argv[a+1], NULL, 10)) > 0) {
+         *ckpt_prefix_p = argv[a+2];
+         a += 3;
+      } else if (strcmp(argv[a], "restart") == 0 && a + 1 < argc) {
+         *restart_prefix_p = argv[a+1];
+         a += 2;
+      } else if (strcmp(argv[a], "closure") == 0) {
+         *closure_p = 1;
+         a++;
+      } else {
+         if (my_rank == 0) Usage(argv[0]);
+         MPI_Finalize();
+         exit(0);
+      }
+   }
+   if (*closure_p && (*rma_p || *ckpt_prefix_p != NULL ||
+            *restart_prefix_p != NULL)) {
+      if (my_rank == 0) Usage(argv[0]);
+      MPI_Finalize();
+      exit(0);
+   }
+}  /* Get_args */
+
 /*---------------------------------------------------------------------
  * Function:  Read_matrix
  * Purpose:   Read in the local_matrix on process 0 and scatter it using a 
@@ -106,80 +288,413 @@ void Read_matrix(int local_mat[], int n, int my_rank, int p,
  * In args:   All
  */
 void Print_row(int local_mat[], int n, int my_rank, int i){
-   char char_int[100];
-   char char_row[1000];
-   int j, offset = 0;
+   out_buf_t out;
+   int j;
 
+   Out_init(&out);
+   Out_str(&out, "Proc ");
+   Out_int(&out, my_rank);
+   Out_str(&out, " > row ");
+   Out_int(&out, i);
+   Out_str(&out, " = ");
    for (j = 0; j < n; j++) {
-      if (local_mat[i*n + j] == INFINITY)
-         sprintf(char_int, "i ");
-      else
-         sprintf(char_int, "%d ", local_mat[i*n + j]);
-      sprintf(char_row + offset, "%s", char_int);
-      offset += strlen(char_int);
+      if (local_mat[i*n + j] == INFINITY) {
+         Out_str(&out, "i ");
+      } else {
+         Out_int(&out, local_mat[i*n + j]);
+         Out_char(&out, ' ');
+      }
    }  
-   printf("Proc %d > row %d = %s\n", my_rank, i, char_row);
+   Out_char(&out, '\n');
+   Out_print(&out, stdout);
+   Out_free(&out);
 }  /* Print_row */
 
+/*---------------------------------------------------------------------
+ * Function:  Format_matrix
+ * Purpose:   Append the rows of local_mat to out, one row per line
+ * In args:   local_mat, n, p
+ * In/out:    out
+ */
+void Format_matrix(int local_mat[], int n, int p, out_buf_t* out) {
+   int i, j;
+
+   for (i = 0; i < n/p; i++) {
+      for (j = 0; j < n; j++)
+         if (local_mat[i*n+j] == INFINITY) {
+            Out_str(out, "i ");
+         } else {
+            Out_int(out, local_mat[i*n+j]);
+            Out_char(out, ' ');
+         }
+      Out_char(out, '\n');
+   }
+}  /* Format_matrix */
+
 /*---------------------------------------------------------------------
  * Function:  Print_matrix
- * Purpose:   Gather the distributed matrix onto process 0 and print it.
+ * Purpose:   Format the local rows on each process, and gather the
+ *            text onto process 0, which prints it.
  * In args:   All
  */
 void Print_matrix(int local_mat[], int n, int my_rank, int p, 
       MPI_Comm comm) {
-   int i, j;
-   int* temp_mat = NULL;
+   out_buf_t out;
 
-   if (my_rank == 0) {
-      temp_mat = malloc(n*n*sizeof(int));
-      MPI_Gather(local_mat, n*n/p, MPI_INT, 
-                 temp_mat, n*n/p, MPI_INT, 0, comm);
-      for (i = 0; i < n; i++) {
-         for (j = 0; j < n; j++)
-            if (temp_mat[i*n+j] == INFINITY)
-               printf("i ");
-            else
-               printf("%d ", temp_mat[i*n+j]);
-         printf("\n");
-      }
-      free(temp_mat);
-   } else {
-      MPI_Gather(local_mat, n*n/p, MPI_INT, 
-                 temp_mat, n*n/p, MPI_INT, 0, comm);
-   }
+   Out_init(&out);
+   Format_matrix(local_mat, n, p, &out);
+   Out_print_ordered(&out, stdout, comm);
+   Out_free(&out);
 }  /* Print_matrix */
 
+/*---------------------------------------------------------------------
+ * Function:  Write_matrix
+ * Purpose:   Format the local rows on each process, and write them to
+ *            file_name in parallel.
+ * In args:   All
+ */
+void Write_matrix(int local_mat[], int n, int p, char* file_name,
+      MPI_Comm comm) {
+   out_buf_t out;
+   int my_rank;
+
+   Out_init(&out);
+   Format_matrix(local_mat, n, p, &out);
+   if (Out_write_ordered(&out, file_name, comm) != MPI_SUCCESS) {
+      MPI_Comm_rank(comm, &my_rank);
+      if (my_rank == 0)
+         fprintf(stderr, "Can't write %s\n", file_name);
+   }
+   Out_free(&out);
+}  /* Write_matrix */
+
 /*---------------------------------------------------------------------
  * Function:    Floyd
  * Purpose:     Implement a distributed version of Floyd's algorithm for
  *              finding the shortest path between all pairs of vertices.
  *              The adjacency matrix is distributed by block rows.
- * In args:     All except local_mat
- * In/out arg:  local_mat:  on input the adjacency matrix.  On output
- *              the matrix of lowests costs between all pairs of
- *              vertices
+ * In args:     first_k:  the first iteration, 0 unless restarting
+ *              ck:  the checkpoint state, or NULL for no checkpoints
+ *              every:  the number of iterations between checkpoints
+ *              n, my_rank, p, comm
+ * In/out arg:  local_mat:  on input the adjacency matrix, or the
+ *              matrix after iteration first_k-1.  On output the matrix
+ *              of lowests costs between all pairs of vertices
  */
-void Floyd(int local_mat[], int n, int my_rank, int p, MPI_Comm comm) {
-   int global_k, local_i, global_j, temp;
+void Floyd(int local_mat[], int n, int first_k, int my_rank, int p,
+      MPI_Comm comm, ckpt_t* ck, int every) {
+   int global_k, local_i, global_j, temp, d_ik, count, c;
    int root;
    int* row_k = malloc(n*sizeof(int));
+   int* cols = malloc(n*sizeof(int));
+   int* row_i;
 
-   for (global_k = 0; global_k < n; global_k++) {
+   for (global_k = first_k; global_k < n; global_k++) {
       root = Owner(global_k, p, n);
       if (my_rank == root)
          Copy_row(local_mat, n, p, row_k, global_k);
       MPI_Bcast(row_k, n, MPI_INT, root, comm);
-      for (local_i = 0; local_i < n/p; local_i++)
-         for (global_j = 0; global_j < n; global_j++) {
-               temp = local_mat[local_i*n + global_k] + row_k[global_j];
-               if (temp < local_mat[local_i*n+global_j])
-                  local_mat[local_i*n + global_j] = temp;
+      count = 0;
+      for (global_j = 0; global_j < n; global_j++)
+         if (row_k[global_j] != INFINITY) cols[count++] = global_j;
+      for (local_i = 0; local_i < n/p; local_i++) {
+         row_i = local_mat + local_i*n;
+         d_ik = row_i[global_k];
+         if (d_ik == INFINITY) continue;
+         if (count < n/SPARSE) {
+            for (c = 0; c < count; c++) {
+               global_j = cols[c];
+               temp = d_ik + row_k[global_j];
+               if (temp < row_i[global_j]) row_i[global_j] = temp;
+            }
+         } else {
+            for (global_j = 0; global_j < n; global_j++) {
+               temp = d_ik + row_k[global_j];
+               if (temp < row_i[global_j]) row_i[global_j] = temp;
+            }
          }
+      }
+      Checkpoint(ck, every, global_k, local_mat, n, my_rank, p, comm);
    }
    free(row_k);
+   free(cols);
 }  /* Floyd */
 
+/*---------------------------------------------------------------------
+ * Function:    Floyd_rma
+ * Purpose:     Implement Floyd's algorithm with the rows of the
+ *              distributed matrix fetched by one-sided communication
+ *              instead of broadcast
+ * In args:     All except local_mat:  see Floyd
+ * In/out arg:  local_mat:  on input the adjacency matrix, or the
+ *              matrix after iteration first_k-1.  On output the matrix
+ *              of lowests costs between all pairs of vertices
+ *
+ * Notes:
+ * 1.  Each process exposes local_mat in win, and an array of ints in
+ *     flag_win:  flags[0] is the largest global row k owned by the
+ *     process that's ready to be used as row k, and flags[1 + local_k]
+ *     counts the processes that have finished fetching local row
+ *     local_k.  All access is inside one MPI_Win_lock_all epoch.
+ * 2.  Row k+1 is ready once it has been updated with row k.  So in
+ *     iteration k, the owner of row k+1 updates it before the rest of
+ *     its rows and sets its ready flag.  The other processes start an
+ *     MPI_Rget of row k+1 before computing with row k, and wait for it
+ *     afterwards.  If row k+1 isn't ready when a process is about to
+ *     compute, it computes first, and fetches row k+1 afterwards.
+ * 3.  Row k doesn't change in iteration k (the diagonal is 0), but the
+ *     owner changes it in iteration k+1.  So before it starts
+ *     iteration k+1, the owner waits until the other p-1 processes
+ *     have finished fetching row k.
+ */
+void Floyd_rma(int local_mat[], int n, int first_k, int my_rank, int p,
+      MPI_Comm comm, ckpt_t* ck, int every) {
+   int global_k, local_i, local_n = n/p, root, next_root, ready, one = 1;
+   int* flags;
+   int *row_k, *next_buf, *other_buf, *swap;
+   MPI_Win win, flag_win;
+   MPI_Request req;
+
+   flags = calloc(1 + local_n, sizeof(int));
+   root = Owner(first_k, p, n);
+   flags[0] = (my_rank == root) ? first_k : -1;
+   other_buf = malloc(n*sizeof(int));
+   next_buf = malloc(n*sizeof(int));
+   MPI_Win_create(local_mat, ((MPI_Aint) n)*local_n*sizeof(int),
+         sizeof(int), MPI_INFO_NULL, comm, &win);
+   MPI_Win_create(flags, (1 + local_n)*sizeof(int), sizeof(int),
+         MPI_INFO_NULL, comm, &flag_win);
+   MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+   MPI_Win_lock_all(MPI_MODE_NOCHECK, flag_win);
+
+   /* Row first_k */
+   if (my_rank == root) {
+      row_k = local_mat + (first_k % local_n)*n;
+   } else {
+      Wait_flag(root, 0, first_k, flag_win);
+      MPI_Get(other_buf, n, MPI_INT, root, ((MPI_Aint) first_k % local_n)*n,
+            n, MPI_INT, win);
+      MPI_Win_flush(root, win);
+      MPI_Accumulate(&one, 1, MPI_INT, root, 1 + first_k % local_n, 1,
+            MPI_INT, MPI_SUM, flag_win);
+      MPI_Win_flush(root, flag_win);
+      row_k = other_buf;
+   }
+
+   for (global_k = first_k; global_k < n; global_k++) {
+      /* Row global_k-1 changes in this iteration, so wait until
+       * everyone has fetched it */
+      if (global_k > first_k && Owner(global_k-1, p, n) == my_rank)
+         Wait_flag(my_rank, 1 + (global_k-1) % local_n, p-1, flag_win);
+
+      req = MPI_REQUEST_NULL;
+      next_root = (global_k + 1 < n) ? Owner(global_k+1, p, n) : -1;
+      if (next_root == my_rank) {
+         /* Finish row global_k+1 first, and tell everyone */
+         Update_row(local_mat, n, (global_k+1) % local_n, global_k, row_k);
+         MPI_Win_sync(win);
+         Set_flag(global_k+1, 0, flag_win, my_rank);
+      } else if (next_root >= 0) {
+         MPI_Fetch_and_op(NULL, &ready, MPI_INT, next_root, 0, MPI_NO_OP,
+               flag_win);
+         MPI_Win_flush(next_root, flag_win);
+         if (ready >= global_k+1)
+            MPI_Rget(next_buf, n, MPI_INT, next_root,
+                  ((MPI_Aint) (global_k+1) % local_n)*n, n, MPI_INT, win,
+                  &req);
+      }
+
+      for (local_i = 0; local_i < local_n; local_i++)
+         if (next_root != my_rank || local_i != (global_k+1) % local_n)
+            Update_row(local_mat, n, local_i, global_k, row_k);
+
+      if (next_root == my_rank) {
+         row_k = local_mat + ((global_k+1) % local_n)*n;
+      } else if (next_root >= 0) {
+         if (req == MPI_REQUEST_NULL) {
+            Wait_flag(next_root, 0, global_k+1, flag_win);
+            MPI_Rget(next_buf, n, MPI_INT, next_root,
+                  ((MPI_Aint) (global_k+1) % local_n)*n, n, MPI_INT, win,
+                  &req);
+         }
+         MPI_Wait(&req, MPI_STATUS_IGNORE);
+         MPI_Accumulate(&one, 1, MPI_INT, next_root,
+               1 + (global_k+1) % local_n, 1, MPI_INT, MPI_SUM, flag_win);
+         MPI_Win_flush(next_root, flag_win);
+         swap = next_buf;
+         next_buf = other_buf;
+         other_buf = swap;
+         row_k = other_buf;
+      }
+      Checkpoint(ck, every, global_k, local_mat, n, my_rank, p, comm);
+   }
+
+   MPI_Win_unlock_all(flag_win);
+   MPI_Win_unlock_all(win);
+   MPI_Win_free(&flag_win);
+   MPI_Win_free(&win);
+   free(flags);
+   free(other_buf);
+   free(next_buf);
+}  /* Floyd_rma */
+
+/*---------------------------------------------------------------------
+ * Function:    Floyd_closure
+ * Purpose:     Compute the transitive closure of the distributed
+ *              matrix with Warshall's algorithm, broadcasting row k as
+ *              a bitset
+ * In args:     n, my_rank, p, comm
+ * In/out arg:  local_mat:  on input the adjacency matrix.  On output
+ *              entry (i, j) is 1 if there's a path from i to j, and 0
+ *              otherwise.
+ */
+void Floyd_closure(int local_mat[], int n, int my_rank, int p,
+      MPI_Comm comm) {
+   int words = (n + 63)/64, local_n = n/p, global_k, local_i, j, w, root;
+   uint64_t *local_bits, *row_k, *row_i, mask;
+
+   local_bits = calloc(((size_t) local_n)*words, sizeof(uint64_t));
+   row_k = malloc(words*sizeof(uint64_t));
+   for (local_i = 0; local_i < local_n; local_i++)
+      for (j = 0; j < n; j++)
+         if (local_mat[local_i*n + j] != INFINITY)
+            local_bits[((size_t) local_i)*words + j/64] |=
+               ((uint64_t) 1) << (j % 64);
+
+   for (global_k = 0; global_k < n; global_k++) {
+      root = Owner(global_k, p, n);
+      if (my_rank == root)
+         memcpy(row_k, local_bits + ((size_t) (global_k % local_n))*words,
+               words*sizeof(uint64_t));
+      MPI_Bcast(row_k, words, MPI_UINT64_T, root, comm);
+      mask = ((uint64_t) 1) << (global_k % 64);
+      for (local_i = 0; local_i < local_n; local_i++) {
+         row_i = local_bits + ((size_t) local_i)*words;
+         if (row_i[global_k/64] & mask)
+            for (w = 0; w < words; w++)
+               row_i[w] |= row_k[w];
+      }
+   }
+
+   for (local_i = 0; local_i < local_n; local_i++)
+      for (j = 0; j < n; j++)
+         local_mat[local_i*n + j] =
+            (local_bits[((size_t) local_i)*words + j/64] >> (j % 64)) & 1;
+   free(local_bits);
+   free(row_k);
+}  /* Floyd_closure */
+
+/*---------------------------------------------------------------------
+ * Function:    Restart
+ * Purpose:     Load the latest checkpoint that every process has
+ * In args:     n, prefix, my_rank, p, comm
+ * Out arg:     local_mat:  unchanged if there's no checkpoint
+ * Ret val:     The iteration to start from:  the step of the
+ *              checkpoint, or 0 if there's no checkpoint
+ */
+int Restart(int local_mat[], int n, char* prefix, int my_rank, int p,
+      MPI_Comm comm) {
+   size_t size = ((size_t) n)*(n/p)*sizeof(int);
+   long step;
+   int ok;
+
+   step = Ckpt_latest(prefix, my_rank, size);
+   MPI_Allreduce(MPI_IN_PLACE, &step, 1, MPI_LONG, MPI_MIN, comm);
+   if (step <= 0) {
+      if (my_rank == 0)
+         printf("No checkpoint with prefix %s, starting from iteration 0\n",
+               prefix);
+      return 0;
+   }
+
+   ok = (Ckpt_load(prefix, my_rank, step, local_mat, size) == 0);
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (!ok) {
+      /* local_mat may be partly overwritten */
+      if (my_rank == 0)
+         fprintf(stderr, "Checkpoint %ld with prefix %s is damaged\n",
+               step, prefix);
+      MPI_Finalize();
+      exit(-1);
+   }
+   if (my_rank == 0) printf("Restarting from iteration %ld\n", step);
+   return step;
+}  /* Restart */
+
+/*---------------------------------------------------------------------
+ * Function:    Checkpoint
+ * Purpose:     If a checkpoint is due after iteration global_k, wait
+ *              for the previous one, and start writing local_mat
+ * In args:     every, global_k, local_mat, n, my_rank, p, comm
+ * In/out arg:  ck:  NULL if there are no checkpoints
+ */
+void Checkpoint(ckpt_t* ck, int every, int global_k, int local_mat[],
+      int n, int my_rank, int p, MPI_Comm comm) {
+   int ok;
+
+   if (ck == NULL || (global_k + 1) % every != 0 || global_k + 1 == n)
+      return;
+
+   /* If the previous checkpoint is complete on every process, it's
+    * the one to keep.  Otherwise keep the one that was kept before:
+    * it's the newest that every process is sure to have. */
+   ok = (Ckpt_wait(ck) == 0);
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (ok)
+      Ckpt_keep(ck, Ckpt_last_step(ck));
+   else if (my_rank == 0)
+      fprintf(stderr, "A checkpoint before iteration %d wasn't written\n",
+            global_k + 1);
+
+   Ckpt_save(ck, global_k + 1, local_mat, ((size_t) n)*(n/p)*sizeof(int));
+}  /* Checkpoint */
+
+/*---------------------------------------------------------------------
+ * Function:    Update_row
+ * Purpose:     Update local row local_i using global row k.  If the
+ *              row's entry in column k is infinite, it can't change.
+ * In args:     n, local_i, global_k, row_k
+ * In/out arg:  local_mat
+ */
+void Update_row(int local_mat[], int n, int local_i, int global_k,
+      const int row_k[]) {
+   int global_j, temp, d_ik = local_mat[local_i*n + global_k];
+   int* row_i = local_mat + local_i*n;
+
+   if (d_ik == INFINITY) return;
+   for (global_j = 0; global_j < n; global_j++) {
+      temp = d_ik + row_k[global_j];
+      if (temp < row_i[global_j]) row_i[global_j] = temp;
+   }
+}  /* Update_row */
+
+/*---------------------------------------------------------------------
+ * Function:  Set_flag
+ * Purpose:   Atomically set entry disp of this process' flags
+ * In args:   value, disp, flag_win, my_rank
+ */
+void Set_flag(int value, int disp, MPI_Win flag_win, int my_rank) {
+   MPI_Accumulate(&value, 1, MPI_INT, my_rank, disp, 1, MPI_INT,
+         MPI_REPLACE, flag_win);
+   MPI_Win_flush(my_rank, flag_win);
+}  /* Set_flag */
+
+/*---------------------------------------------------------------------
+ * Function:  Wait_flag
+ * Purpose:   Wait until entry disp of the flags on process target is
+ *            at least min_value
+ * In args:   target, disp, min_value, flag_win
+ */
+void Wait_flag(int target, int disp, int min_value, MPI_Win flag_win) {
+   int value;
+
+   do {
+      MPI_Fetch_and_op(NULL, &value, MPI_INT, target, disp, MPI_NO_OP,
+            flag_win);
+      MPI_Win_flush(target, flag_win);
+   } while (value < min_value);
+}  /* Wait_flag */
+
 /*---------------------------------------------------------------------
  * Function:  Owner
  * Purpose:   Return rank of process that owns global row k
@@ -0,0 +1,270 @@
+/* File:     mpi_mat_mat.c
+ *
+ * Purpose:  Compute a parallel matrix-matrix product C = A*B using
+ *           SUMMA (the Scalable Universal Matrix Multiplication
+ *           Algorithm).  The processes form a q x q grid, and each
+ *           of A, B, and C is distributed by blocks:  process (r, c)
+ *           is assigned block (r, c) of each matrix.  There are q
+ *           stages.  During stage s, the processes in column s of the
+ *           grid broadcast their blocks of A across their grid rows,
+ *           the processes in row s broadcast their blocks of B down
+ *           their grid columns, and each process multiplies the two
+ *           blocks it received and adds the product into its block of C.
+ *           The local products are computed by the Gemm in gemm.c.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_mat_mat mpi_mat_mat.c
+ *              gemm.c -lm
+ * Run:      mpiexec -n <p> ./mpi_mat_mat <m> <n> <k> [c]
+ *              C is m x n, A is m x k, B is k x n
+ *              c:  check the product against the triple loop on
+ *                  process 0
+ *
+ * Input:    None.  The entries of A and B are computed from their
+ *           subscripts.
+ * Output:   Elapsed time, GFLOP/s, and the GFLOP/s as a percentage of
+ *           the theoretical peak.  If c is on the command line, the
+ *           maximum difference between C and the triple loop product.
+ *
+ * Notes:
+ * 1.  p should be a perfect square, p = q*q, and q should evenly
+ *     divide m, n, and k.
+ * 2.  The theoretical peak is p*(clock rate)*GEMM_FLOPS_PER_CYCLE.
+ *     It assumes that each process runs on its own core.
+ * 3.  The check gathers C onto process 0, so it should only be used
+ *     for small matrices.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "gemm.h"
+
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], int* m_p, int* n_p, int* k_p,
+      int* check_p, int my_rank, int q, MPI_Comm comm);
+double Entry(int i, int j, int which);
+void Gen_block(double local_M[], int local_rows, int local_cols,
+      int my_row, int my_col, int which);
+void Summa(double local_A[], double local_B[], double local_C[],
+      int local_m, int local_n, int local_k, int my_row, int my_col,
+      int q, MPI_Comm row_comm, MPI_Comm col_comm);
+double Check_product(double local_C[], int m, int n, int k, int q,
+      int my_rank, MPI_Comm grid_comm);
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int p, my_rank, q, m, n, k, check;
+   int local_m, local_n, local_k;
+   int dims[2], periods[2] = {0, 0}, coords[2], keep[2];
+   double *local_A, *local_B, *local_C;
+   double start, finish, elapsed, loc_elapsed, gflops, ghz, max_diff;
+   MPI_Comm grid_comm, row_comm, col_comm;
+
+   MPI_Init(&argc, &argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &p);
+   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+
+   q = (int) (sqrt((double) p) + 0.5);
+   Get_args(argc, argv, &m, &n, &k, &check, my_rank, q, MPI_COMM_WORLD);
+
+   /* Build the q x q grid and its row and column communicators */
+   dims[0] = dims[1] = q;
+   MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 1, &grid_comm);
+   MPI_Comm_rank(grid_comm, &my_rank);
+   MPI_Cart_coords(grid_comm, my_rank, 2, coords);
+   keep[0] = 0; keep[1] = 1;
+   MPI_Cart_sub(grid_comm, keep, &row_comm);
+   keep[0] = 1; keep[1] = 0;
+   MPI_Cart_sub(grid_comm, keep, &col_comm);
+
+   local_m = m/q;
+   local_n = n/q;
+   local_k = k/q;
+   local_A = malloc(((size_t) local_m)*local_k*sizeof(double));
+   local_B = malloc(((size_t) local_k)*local_n*sizeof(double));
+   local_C = malloc(((size_t) local_m)*local_n*sizeof(double));
+   Gen_block(local_A, local_m, local_k, coords[0], coords[1], 0);
+   Gen_block(local_B, local_k, local_n, coords[0], coords[1], 1);
+
+   MPI_Barrier(grid_comm);
+   start = MPI_Wtime();
+   Summa(local_A, local_B, local_C, local_m, local_n, local_k,
+         coords[0], coords[1], q, row_comm, col_comm);
+   finish = MPI_Wtime();
+   loc_elapsed = finish - start;
+   MPI_Reduce(&loc_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0,
+         grid_comm);
+
+   if (my_rank == 0) {
+      gflops = 2.0*m*n*k/elapsed/1.0e9;
+      printf("Elapsed time = %e seconds\n", elapsed);
+      printf("GFLOP/s = %.2f", gflops);
+      ghz = Cpu_ghz();
+      if (ghz > 0.0)
+         printf(" (%.1f%% of peak %.2f GFLOP/s)", 100.0*gflops/
+               (p*ghz*GEMM_FLOPS_PER_CYCLE), p*ghz*GEMM_FLOPS_PER_CYCLE);
+      printf("\n");
+   }
+
+   if (check) {
+      max_diff = Check_product(local_C, m, n, k, q, my_rank, grid_comm);
+      if (my_rank == 0)
+         printf("Max difference from triple loop = %e\n", max_diff);
+   }
+
+   free(local_A);
+   free(local_B);
+   free(local_C);
+   MPI_Comm_free(&row_comm);
+   MPI_Comm_free(&col_comm);
+   MPI_Comm_free(&grid_comm);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: mpiexec -n <p> %s <m> <n> <k> [c]\n", prog_name);
+   fprintf(stderr, "   p should be a perfect square q*q\n");
+   fprintf(stderr, "   C is m x n, A is m x k, B is k x n\n");
+   fprintf(stderr, "   q should evenly divide m, n, and k\n");
+   fprintf(stderr, "   c:  check the product on process 0\n");
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check the command line args on process 0 and
+ *              broadcast them.  If there's an error, quit.
+ * In args:     argc, argv, my_rank, q, comm
+ * Out args:    m_p, n_p, k_p, check_p
+ */
+void Get_args(int argc, char* argv[], int* m_p, int* n_p, int* k_p,
+      int* check_p, int my_rank, int q, MPI_Comm comm) {
+   int p, args[4];
+
+   MPI_Comm_size(comm, &p);
+   if (my_rank == 0) {
+      args[0] = -1;
+      if (q*q == p && (argc == 4 || (argc == 5 && argv[4][0] == 'c'))) {
+         args[0] = strtol(argv[1], NULL, 10);
+         args[1] = strtol(argv[2], NULL, 10);
+         args[2] = strtol(argv[3], NULL, 10);
+         args[3] = (argc == 5);
+         if (args[0] <= 0 || args[1] <= 0 || args[2] <= 0 ||
+               args[0] % q != 0 || args[1] % q != 0 || args[2] % q != 0)
+            args[0] = -1;
+      }
+      if (args[0] < 0) Usage(argv[0]);
+   }
+   MPI_Bcast(args, 4, MPI_INT, 0, comm);
+   if (args[0] < 0) {
+      MPI_Finalize();
+      exit(0);
+   }
+   *m_p = args[0];
+   *n_p = args[1];
+   *k_p = args[2];
+   *check_p = args[3];
+}  /* Get_args */
+
+/*-------------------------------------------------------------------
+ * Function:    Entry
+ * Purpose:     Compute the entry in row i and column j of A
+ *              (which = 0) or B (which = 1)
+ */
+double Entry(int i, int j, int which) {
+   return ((i*131 + j*17 + which*7) % 97)/97.0;
+}  /* Entry */
+
+/*-------------------------------------------------------------------
+ * Function:    Gen_block
+ * Purpose:     Fill in block (my_row, my_col) of A or B
+ * In args:     local_rows, local_cols, my_row, my_col, which
+ * Out arg:     local_M
+ */
+void Gen_block(double local_M[], int local_rows, int local_cols,
+      int my_row, int my_col, int which) {
+   int i, j;
+
+   for (i = 0; i < local_rows; i++)
+      for (j = 0; j < local_cols; j++)
+         local_M[i*local_cols + j] = Entry(my_row*local_rows + i,
+               my_col*local_cols + j, which);
+}  /* Gen_block */
+
+/*-------------------------------------------------------------------
+ * Function:    Summa
+ * Purpose:     Compute the local block of C = A*B
+ * In args:     local_A, local_B, local_m, local_n, local_k, my_row,
+ *              my_col, q, row_comm, col_comm
+ * Out arg:     local_C
+ */
+void Summa(double local_A[], double local_B[], double local_C[],
+      int local_m, int local_n, int local_k, int my_row, int my_col,
+      int q, MPI_Comm row_comm, MPI_Comm col_comm) {
+   int stage;
+   double* A_bcast = malloc(((size_t) local_m)*local_k*sizeof(double));
+   double* B_bcast = malloc(((size_t) local_k)*local_n*sizeof(double));
+   double *A_use, *B_use;
+
+   memset(local_C, 0, ((size_t) local_m)*local_n*sizeof(double));
+   for (stage = 0; stage < q; stage++) {
+      /* In row_comm the rank is the grid column, in col_comm the row */
+      A_use = (my_col == stage) ? local_A : A_bcast;
+      MPI_Bcast(A_use, local_m*local_k, MPI_DOUBLE, stage, row_comm);
+      B_use = (my_row == stage) ? local_B : B_bcast;
+      MPI_Bcast(B_use, local_k*local_n, MPI_DOUBLE, stage, col_comm);
+      Gemm(local_m, local_n, local_k, A_use, local_k, B_use, local_n,
+            local_C, local_n);
+   }
+
+   free(A_bcast);
+   free(B_bcast);
+}  /* Summa */
+
+/*-------------------------------------------------------------------
+ * Function:    Check_product
+ * Purpose:     Gather the blocks of C onto process 0 and compare them
+ *              with the triple loop product
+ * Ret val:     On process 0, the largest difference.  Other
+ *              processes return 0.
+ */
+double Check_product(double local_C[], int m, int n, int k, int q,
+      int my_rank, MPI_Comm grid_comm) {
+   int local_m = m/q, local_n = n/q;
+   int proc, coords[2], i, j, l, gi, gj;
+   double* block;
+   double sum, diff, max_diff = 0.0;
+
+   if (my_rank != 0) {
+      MPI_Send(local_C, local_m*local_n, MPI_DOUBLE, 0, 0, grid_comm);
+      return 0.0;
+   }
+
+   block = malloc(((size_t) local_m)*local_n*sizeof(double));
+   for (proc = 0; proc < q*q; proc++) {
+      if (proc == 0)
+         memcpy(block, local_C, ((size_t) local_m)*local_n*sizeof(double));
+      else
+         MPI_Recv(block, local_m*local_n, MPI_DOUBLE, proc, 0, grid_comm,
+               MPI_STATUS_IGNORE);
+      MPI_Cart_coords(grid_comm, proc, 2, coords);
+      for (i = 0; i < local_m; i++)
+         for (j = 0; j < local_n; j++) {
+            gi = coords[0]*local_m + i;
+            gj = coords[1]*local_n + j;
+            sum = 0.0;
+            for (l = 0; l < k; l++)
+               sum += Entry(gi, l, 0)*Entry(l, gj, 1);
+            diff = fabs(sum - block[i*local_n + j]);
+            if (diff > max_diff) max_diff = diff;
+         }
+   }
+   free(block);
+   return max_diff;
+}  /* Check_product */
@@ -4,11 +4,16 @@
  * Input:    n:  integer > = 2 
  * Output:   Sorted list of primes between 2 and n.
  *
- * Compile:  mpicc -g -Wall -o mpi_primes mpi_primes.c -lm
+ * Compile:  mpicc -g -Wall -o mpi_primes mpi_primes.c par_output.c
+ *              -lm
  * Usage:    mpiexec -n <p> ./mpi_primes <n>
  *           p:  number of MPI processes
  *           n:  max int to test for primality
  *
+ * Note:     Compile with -DTRACE and link with trace.c and -lpthread to
+ *           get a timeline of the search and of the sends, receives
+ *           and merges in Merge_lists in trace.<rank>.json (see
+ *           trace.h).  A process is idle after its send.
  */
 
 #include <stdio.h>
@@ -16,8 +21,8 @@
 #include <mpi.h>
 #include <string.h>
 #include <math.h>
-
-const int STRING_MAX = 100000;
+#include "par_output.h"
+#include "trace.h"
 
 void Usage(char prog[]);
 int Get_n(int argc, char* argv[], int my_rank, int p, MPI_Comm comm);
@@ -37,6 +42,7 @@ int main(int argc, char* argv[]) {
    comm = MPI_COMM_WORLD;
    MPI_Comm_size(comm, &p);
    MPI_Comm_rank(comm, &my_rank);
+   TRACE_PROCESS(my_rank);
 
    n = Get_n(argc, argv, my_rank, p, comm);
    local_n = n/(2*p)+2;
@@ -48,6 +54,7 @@ int main(int argc, char* argv[]) {
 
    inc = 2*p;
 
+   TRACE_BEGIN("find primes", n);
    for (i = 2*my_rank + 3; i <= n; i += inc) {
       if (Is_prime(i)) {
          my_primes[my_prime_count++] = i;
@@ -57,6 +64,7 @@ int main(int argc, char* argv[]) {
 #        endif
       }
    }
+   TRACE_END("find primes");
 
    Print_list("After search primes are", my_primes, my_prime_count, my_rank);
 
@@ -136,15 +144,21 @@ int Is_prime(int i) {
 void Print_primes(int my_primes[], int my_prime_count, int my_rank, int p, MPI_Comm comm) {
    int* primes;
    int primes_count, i;
+   out_buf_t out;
 
    Merge_lists(my_primes, my_prime_count, &primes, &primes_count,
          my_rank, p, comm);
 
    if (my_rank == 0) {
-      printf("The primes are:\n");
-      for (i = 0; i < primes_count; i++)
-         printf("%d ", primes[i]);
-      printf("\n");
+      Out_init(&out);
+      Out_str(&out, "The primes are:\n");
+      for (i = 0; i < primes_count; i++) {
+         Out_int(&out, primes[i]);
+         Out_char(&out, ' ');
+      }
+      Out_char(&out, '\n');
+      Out_print(&out, stdout);
+      Out_free(&out);
       free(primes);
    }
    
@@ -170,7 +184,9 @@ void Merge_lists(int my_slist[], int my_count, int** list_p, int* size_p, int my
    int *recv_counts = malloc(p*sizeof(int));
    MPI_Status status;  
    int recv_count=0;     
+   TRACE_BEGIN("allgather", my_count);
    MPI_Allgather(&my_count, 1, MPI_INT, counts, 1, MPI_INT, comm);
+   TRACE_END("allgather");
    Compute_list_sizes(counts, recv_counts, p);
    my_size = counts[my_rank];
 
@@ -194,17 +210,23 @@ void Merge_lists(int my_slist[], int my_count, int** list_p, int* size_p, int my
       partner = my_rank ^ bitmask;
       if (my_rank < partner && counts[partner] > 0) {
          if (partner < p) {
+            TRACE_BEGIN("recv", partner);
             MPI_Recv(recv_list, counts[partner], MPI_INT,
                partner, 0, comm, &status);
+            TRACE_END("recv");
             recv_count = counts[partner];
+            TRACE_BEGIN("merge", partner);
             Merge(&my_list, &curr_size, recv_list, recv_count,
                   &temp);
+            TRACE_END("merge");
             Print_list("After merge", my_list, curr_size, my_rank);
          }
          bitmask <<= 1;
       } 
       else {
+         TRACE_BEGIN("send", partner);
          MPI_Send(my_list, my_size, MPI_INT, partner, 0, comm);
+         TRACE_END("send");
          done = 1;
       }
    }
@@ -294,24 +316,30 @@ void Compute_list_sizes(int prime_counts[], int recv_counts[], int p) {
  * Purpose:   Convert a list of ints to a single string before
  *            printing.  This should make it less likely that the
  *            output is interrupted by another process.  This is
- *            mainly intended for debugging purposes.
+ *            mainly intended for debugging purposes.  There's no
+ *            limit on the length of the string (see par_output.h).
  * In args:   title:  list's title
  *            list:  the ints to be printed
  *            n:  the number of ints
  *            my_rank:  the usual MPI variable
  */
 void Print_list(char* title, int list[], int n, int my_rank) {
-   char string[STRING_MAX];
-   char* s_p;
+   out_buf_t out;
    int i;
 
-   sprintf(string, "Proc %d %s > ", my_rank, title);
-   s_p = string + strlen(string);
+   Out_init(&out);
+   Out_str(&out, "Proc ");
+   Out_int(&out, my_rank);
+   Out_char(&out, ' ');
+   Out_str(&out, title);
+   Out_str(&out, " > ");
    for (i = 0; i < n; i++) {
-      sprintf(s_p, "%d ", list[i]);
-      s_p = string + strlen(string);
+      Out_int(&out, list[i]);
+      Out_char(&out, ' ');
    }
+   Out_char(&out, '\n');
 
-   printf("%s\n", string);
+   Out_print(&out, stdout);
    fflush(stdout);
+   Out_free(&out);
 }  /* Print_list */
\ No newline at end of file
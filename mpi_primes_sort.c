@@ -4,7 +4,8 @@
  * Input:    n:  integer >= 2 (from command line)
  * Output:   Sorted list of primes between 2 and n,
  *
- * Compile:  mpicc -g -Wall -o mpi_primes_sort mpi_primes_sort.c -lm
+ * Compile:  mpicc -g -Wall -o mpi_primes_sort mpi_primes_sort.c
+ *              par_output.c -lm
  * Usage:    mpiexec -n <p> ./mpi_primes_sort <n>
  *           p:  number of MPI processes
  *           n:  max int to test for primality
@@ -18,8 +19,7 @@
 #include <string.h>
 #include <math.h>
 #include <mpi.h>
-
-const int STRING_MAX = 1000;
+#include "par_output.h"
 
 int Get_n(int argc, char* argv[], int my_rank, int p, MPI_Comm comm);
 int Is_prime(int i);
@@ -128,15 +128,21 @@ void Print_primes(int my_primes[], int my_prime_count, int my_rank,
       int p, MPI_Comm comm) {
    int* all_primes;
    int all_primes_count, i;
+   out_buf_t out;
 
    Merge_lists(my_primes, my_prime_count, &all_primes, &all_primes_count,
          my_rank, p, comm);
 
    if (my_rank == 0) {
-      printf("The primes are\n");
-      for (i = 0; i < all_primes_count; i++)
-         printf("%d ", all_primes[i]);
-      printf("\n");
+      Out_init(&out);
+      Out_str(&out, "The primes are\n");
+      for (i = 0; i < all_primes_count; i++) {
+         Out_int(&out, all_primes[i]);
+         Out_char(&out, ' ');
+      }
+      Out_char(&out, '\n');
+      Out_print(&out, stdout);
+      Out_free(&out);
       free(all_primes);
    }
    
@@ -328,26 +334,30 @@ void Compute_list_sizes(int prime_counts[], int recv_counts[], int p) {
  * Purpose:   Convert a list of ints to a single string before
  *            printing.  This should make it less likely that the
  *            output is interrupted by another process.  This is
- *            mainly intended for debugging purposes.
+ *            mainly intended for debugging purposes.  There's no
+ *            limit on the length of the string (see par_output.h).
  * In args:   title:  title of list
  *            list:  the ints to be printed
  *            n:  the number of ints
  *            my_rank:  the usual MPI variable
  */
 void Print_list(char* title, int list[], int n, int my_rank) {
-   char string[STRING_MAX];
-   char* s_p;
+   out_buf_t out;
    int i;
 
-   sprintf(string, "Proc %d %s > ", my_rank, title);
-   // Pointer arithmetic:  make s_p point to the character strlen(string)
-   // into string; i.e., make it point at the `\0'
-   s_p = string + strlen(string);
+   Out_init(&out);
+   Out_str(&out, "Proc ");
+   Out_int(&out, my_rank);
+   Out_char(&out, ' ');
+   Out_str(&out, title);
+   Out_str(&out, " > ");
    for (i = 0; i < n; i++) {
-      sprintf(s_p, "%d ", list[i]);
-      s_p = string + strlen(string);
+      Out_int(&out, list[i]);
+      Out_char(&out, ' ');
    }
+   Out_char(&out, '\n');
 
-   printf("%s\n", string);
+   Out_print(&out, stdout);
    fflush(stdout);
+   Out_free(&out);
 }  /* Print_list */
\ No newline at end of file
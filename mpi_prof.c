@@ -0,0 +1,586 @@
+/* File:     mpi_prof.c
+ *
+ * Purpose:  A communication profiler for MPI programs that uses the
+ *           MPI profiling interface (PMPI).  Each MPI function below
+ *           records its call site, the number of calls, the number of
+ *           bytes sent and received, and the time spent inside MPI,
+ *           and then calls the real function, PMPI_<name>.  When the
+ *           program calls MPI_Finalize, the records from all the
+ *           processes are gathered onto process 0, which prints
+ *
+ *              - for each process, the total time in MPI and the
+ *                percentage of the time between MPI_Init and
+ *                MPI_Finalize that it represents, and
+ *              - for each call site, the calls, bytes, and the total,
+ *                minimum, and maximum time (over the processes) spent
+ *                in MPI and waiting in collectives.
+ *
+ * Compile:  No changes to a program are needed.  Compile mpi_prof.c and
+ *           link it in before the MPI library, e.g.,
+ *              mpicc -g -Wall -c mpi_prof.c
+ *              mpicc -g -Wall -rdynamic -o mpi_floyd mpi_floyd.c
+ *                 mpi_prof.o -ldl
+ *           or build a shared library and preload it:
+ *              mpicc -g -Wall -fPIC -shared -o libmpi_prof.so mpi_prof.c
+ *                 -ldl
+ *              mpiexec -n 4 -x LD_PRELOAD=./libmpi_prof.so ./mpi_floyd
+ *
+ * Output:   The report is printed to stderr by process 0.
+ *
+ * Notes:
+ * 1.  The call site is the return address of the MPI call.  It's
+ *     printed as function+offset when the function's name can be found
+ *     (link with -rdynamic), and otherwise as file+offset, which can be
+ *     converted to a line with addr2line -e <file> <offset>.
+ * 2.  Wait time is a proxy for load imbalance:  before each collective,
+ *     the profiler calls PMPI_Barrier on the collective's communicator
+ *     and records the time spent in it as wait time.  The time in the
+ *     collective itself doesn't include it.  Set the environment
+ *     variable MPI_PROF_NO_WAIT to turn this off.
+ * 3.  Bytes are counted from the counts and datatypes in the calls.
+ *     For MPI_Recv they're the size of the message actually received.
+ *     For MPI_Irecv they're the size of the receive buffer.  For the
+ *     collectives they're the bytes this process contributes and
+ *     receives, e.g. the root of an MPI_Scatter sends p*sendcount
+ *     elements.
+ * 4.  Only the functions used by the programs in this directory (and
+ *     a few more) are profiled.  Other MPI functions work, but their
+ *     time isn't recorded.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <mpi.h>
+
+#define SITE_LEN 96
+
+typedef enum {SEND, RECV, SENDRECV, ISEND, IRECV, WAIT, WAITALL, BARRIER,
+   BCAST, SCATTER, SCATTERV, GATHER, GATHERV, ALLGATHER, ALLGATHERV,
+   REDUCE, ALLREDUCE, SCAN, EXSCAN, ALLTOALL, ALLTOALLV, OP_COUNT} op_t;
+
+static const char* op_names[OP_COUNT] = {"Send", "Recv", "Sendrecv",
+   "Isend", "Irecv", "Wait", "Waitall", "Barrier", "Bcast", "Scatter",
+   "Scatterv", "Gather", "Gatherv", "Allgather", "Allgatherv", "Reduce",
+   "Allreduce", "Scan", "Exscan", "Alltoall", "Alltoallv"};
+
+/* The statistics for one call site on one process */
+typedef struct {
+   int    op;
+   void*  addr;            /* Return address, only used locally */
+   char   site[SITE_LEN];  /* Filled in at MPI_Finalize        */
+   int    rank;
+   long   calls;
+   double bytes_sent, bytes_recv;
+   double time, wait;
+} site_t;
+
+static site_t* sites = NULL;
+static int     site_count = 0, site_max = 0;
+static int     measure_wait = 1;
+static double  init_time;
+
+static site_t* Find_site(op_t op, void* addr);
+static void    Name_site(site_t* site);
+static double  Bytes(int count, MPI_Datatype type);
+static double  Wait_time(MPI_Comm comm);
+static void    Report(void);
+
+/*-------------------------------------------------------------------
+ * Function:   Find_site
+ * Purpose:    Return the record for op called from addr, creating
+ *             it if necessary
+ * Note:       The number of distinct call sites in a program is
+ *             small, so a linear search is fast enough:  the most
+ *             recently used site is checked first.
+ */
+static site_t* Find_site(op_t op, void* addr) {
+   static int last = 0;
+   int s;
+
+   if (last < site_count && sites[last].addr == addr && sites[last].op == op)
+      return &sites[last];
+   for (s = 0; s < site_count; s++)
+      if (sites[s].addr == addr && sites[s].op == op) {
+         last = s;
+         return &sites[s];
+      }
+
+   if (site_count == site_max) {
+      site_max = (site_max == 0) ? 64 : 2*site_max;
+      sites = realloc(sites, site_max*sizeof(site_t));
+   }
+   memset(&sites[site_count], 0, sizeof(site_t));
+   sites[site_count].op = op;
+   sites[site_count].addr = addr;
+   last = site_count;
+   return &sites[site_count++];
+}  /* Find_site */
+
+/*-------------------------------------------------------------------
+ * Function:   Name_site
+ * Purpose:    Convert the return address of a site to a string
+ */
+static void Name_site(site_t* site) {
+   Dl_info info;
+   const char* file;
+
+   if (dladdr(site->addr, &info) == 0 || info.dli_fname == NULL) {
+      snprintf(site->site, SITE_LEN, "%p", site->addr);
+   } else if (info.dli_sname != NULL) {
+      snprintf(site->site, SITE_LEN, "%s+0x%lx", info.dli_sname,
+            (unsigned long) ((char*) site->addr - (char*) info.dli_saddr));
+   } else {
+      file = strrchr(info.dli_fname, '/');
+      file = (file == NULL) ? info.dli_fname : file + 1;
+      snprintf(site->site, SITE_LEN, "%s+0x%lx", file,
+            (unsigned long) ((char*) site->addr - (char*) info.dli_fbase));
+   }
+}  /* Name_site */
+
+/*-------------------------------------------------------------------
+ * Function:   Bytes
+ * Purpose:    Return the number of bytes in count elements of type
+ */
+static double Bytes(int count, MPI_Datatype type) {
+   int size;
+
+   PMPI_Type_size(type, &size);
+   return ((double) count)*size;
+}  /* Bytes */
+
+/*-------------------------------------------------------------------
+ * Function:   Wait_time
+ * Purpose:    If wait times are being measured, call PMPI_Barrier on
+ *             comm and return the time spent in it
+ */
+static double Wait_time(MPI_Comm comm) {
+   double start;
+
+   if (!measure_wait) return 0.0;
+   start = PMPI_Wtime();
+   PMPI_Barrier(comm);
+   return PMPI_Wtime() - start;
+}  /* Wait_time */
+
+/* Record a call that took time secs and waited wait secs */
+#define RECORD(op, sent, recvd, secs, wait_secs) { \
+   site_t* s = Find_site(op, __builtin_return_address(0)); \
+   s->calls++; \
+   s->bytes_sent += (sent); \
+   s->bytes_recv += (recvd); \
+   s->time += (secs); \
+   s->wait += (wait_secs); \
+}
+
+/*===================================================================
+ * Initialization and finalization
+ */
+int MPI_Init(int* argc_p, char*** argv_p) {
+   int rv = PMPI_Init(argc_p, argv_p);
+
+   measure_wait = (getenv("MPI_PROF_NO_WAIT") == NULL);
+   init_time = PMPI_Wtime();
+   return rv;
+}  /* MPI_Init */
+
+int MPI_Init_thread(int* argc_p, char*** argv_p, int required,
+      int* provided_p) {
+   int rv = PMPI_Init_thread(argc_p, argv_p, required, provided_p);
+
+   measure_wait = (getenv("MPI_PROF_NO_WAIT") == NULL);
+   init_time = PMPI_Wtime();
+   return rv;
+}  /* MPI_Init_thread */
+
+int MPI_Finalize(void) {
+   Report();
+   free(sites);
+   return PMPI_Finalize();
+}  /* MPI_Finalize */
+
+/*===================================================================
+ * Point-to-point
+ */
+int MPI_Send(const void* buf, int count, MPI_Datatype type, int dest,
+      int tag, MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Send(buf, count, type, dest, tag, comm);
+
+   RECORD(SEND, Bytes(count, type), 0, PMPI_Wtime() - start, 0);
+   return rv;
+}  /* MPI_Send */
+
+int MPI_Recv(void* buf, int count, MPI_Datatype type, int source,
+      int tag, MPI_Comm comm, MPI_Status* status_p) {
+   MPI_Status status;
+   double start = PMPI_Wtime();
+   int rv, received;
+
+   rv = PMPI_Recv(buf, count, type, source, tag, comm, &status);
+   PMPI_Get_count(&status, MPI_BYTE, &received);
+   RECORD(RECV, 0, received, PMPI_Wtime() - start, 0);
+   if (status_p != MPI_STATUS_IGNORE) *status_p = status;
+   return rv;
+}  /* MPI_Recv */
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      int dest, int sendtag, void* recvbuf, int recvcount,
+      MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm,
+      MPI_Status* status_p) {
+   MPI_Status status;
+   double start = PMPI_Wtime();
+   int rv, received;
+
+   rv = PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag,
+         recvbuf, recvcount, recvtype, source, recvtag, comm, &status);
+   PMPI_Get_count(&status, MPI_BYTE, &received);
+   RECORD(SENDRECV, Bytes(sendcount, sendtype), received,
+         PMPI_Wtime() - start, 0);
+   if (status_p != MPI_STATUS_IGNORE) *status_p = status;
+   return rv;
+}  /* MPI_Sendrecv */
+
+int MPI_Isend(const void* buf, int count, MPI_Datatype type, int dest,
+      int tag, MPI_Comm comm, MPI_Request* request_p) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Isend(buf, count, type, dest, tag, comm, request_p);
+
+   RECORD(ISEND, Bytes(count, type), 0, PMPI_Wtime() - start, 0);
+   return rv;
+}  /* MPI_Isend */
+
+int MPI_Irecv(void* buf, int count, MPI_Datatype type, int source,
+      int tag, MPI_Comm comm, MPI_Request* request_p) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Irecv(buf, count, type, source, tag, comm, request_p);
+
+   RECORD(IRECV, 0, Bytes(count, type), PMPI_Wtime() - start, 0);
+   return rv;
+}  /* MPI_Irecv */
+
+int MPI_Wait(MPI_Request* request_p, MPI_Status* status_p) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Wait(request_p, status_p);
+
+   RECORD(WAIT, 0, 0, PMPI_Wtime() - start, 0);
+   return rv;
+}  /* MPI_Wait */
+
+int MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[]) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Waitall(count, requests, statuses);
+
+   RECORD(WAITALL, 0, 0, PMPI_Wtime() - start, 0);
+   return rv;
+}  /* MPI_Waitall */
+
+/*===================================================================
+ * Collectives
+ */
+int MPI_Barrier(MPI_Comm comm) {
+   double start = PMPI_Wtime();
+   int rv = PMPI_Barrier(comm);
+   double elapsed = PMPI_Wtime() - start;
+
+   RECORD(BARRIER, 0, 0, 0, elapsed);
+   return rv;
+}  /* MPI_Barrier */
+
+int MPI_Bcast(void* buf, int count, MPI_Datatype type, int root,
+      MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Bcast(buf, count, type, root, comm);
+   int my_rank;
+
+   PMPI_Comm_rank(comm, &my_rank);
+   if (my_rank == root) {
+      RECORD(BCAST, Bytes(count, type), 0, PMPI_Wtime() - start, wait);
+   } else {
+      RECORD(BCAST, 0, Bytes(count, type), PMPI_Wtime() - start, wait);
+   }
+   return rv;
+}  /* MPI_Bcast */
+
+int MPI_Scatter(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+      MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+         recvtype, root, comm);
+   int my_rank, p;
+
+   PMPI_Comm_rank(comm, &my_rank);
+   PMPI_Comm_size(comm, &p);
+   RECORD(SCATTER, (my_rank == root) ? p*Bytes(sendcount, sendtype) : 0,
+         Bytes(recvcount, recvtype), PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Scatter */
+
+int MPI_Scatterv(const void* sendbuf, const int sendcounts[],
+      const int displs[], MPI_Datatype sendtype, void* recvbuf,
+      int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf,
+         recvcount, recvtype, root, comm);
+   int my_rank, p, q;
+   double sent = 0.0;
+
+   PMPI_Comm_rank(comm, &my_rank);
+   PMPI_Comm_size(comm, &p);
+   if (my_rank == root)
+      for (q = 0; q < p; q++)
+         sent += Bytes(sendcounts[q], sendtype);
+   RECORD(SCATTERV, sent, Bytes(recvcount, recvtype), PMPI_Wtime() - start,
+         wait);
+   return rv;
+}  /* MPI_Scatterv */
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+      MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+         recvtype, root, comm);
+   int my_rank, p;
+
+   PMPI_Comm_rank(comm, &my_rank);
+   PMPI_Comm_size(comm, &p);
+   RECORD(GATHER, Bytes(sendcount, sendtype),
+         (my_rank == root) ? p*Bytes(recvcount, recvtype) : 0,
+         PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Gather */
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, const int recvcounts[], const int displs[],
+      MPI_Datatype recvtype, int root, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+         displs, recvtype, root, comm);
+   int my_rank, p, q;
+   double recvd = 0.0;
+
+   PMPI_Comm_rank(comm, &my_rank);
+   PMPI_Comm_size(comm, &p);
+   if (my_rank == root)
+      for (q = 0; q < p; q++)
+         recvd += Bytes(recvcounts[q], recvtype);
+   RECORD(GATHERV, Bytes(sendcount, sendtype), recvd, PMPI_Wtime() - start,
+         wait);
+   return rv;
+}  /* MPI_Gatherv */
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf,
+         recvcount, recvtype, comm);
+   int p;
+
+   PMPI_Comm_size(comm, &p);
+   RECORD(ALLGATHER, Bytes(sendcount, sendtype),
+         p*Bytes(recvcount, recvtype), PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Allgather */
+
+int MPI_Allgatherv(const void* sendbuf, int sendcount,
+      MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+      const int displs[], MPI_Datatype recvtype, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf,
+         recvcounts, displs, recvtype, comm);
+   int p, q;
+   double recvd = 0.0;
+
+   PMPI_Comm_size(comm, &p);
+   for (q = 0; q < p; q++)
+      recvd += Bytes(recvcounts[q], recvtype);
+   RECORD(ALLGATHERV, Bytes(sendcount, sendtype), recvd,
+         PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Allgatherv */
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Reduce(sendbuf, recvbuf, count, type, op, root, comm);
+   int my_rank;
+
+   PMPI_Comm_rank(comm, &my_rank);
+   RECORD(REDUCE, Bytes(count, type),
+         (my_rank == root) ? Bytes(count, type) : 0,
+         PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Reduce */
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Allreduce(sendbuf, recvbuf, count, type, op, comm);
+
+   RECORD(ALLREDUCE, Bytes(count, type), Bytes(count, type),
+         PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Allreduce */
+
+int MPI_Scan(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Scan(sendbuf, recvbuf, count, type, op, comm);
+
+   RECORD(SCAN, Bytes(count, type), Bytes(count, type),
+         PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Scan */
+
+int MPI_Exscan(const void* sendbuf, void* recvbuf, int count,
+      MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Exscan(sendbuf, recvbuf, count, type, op, comm);
+
+   RECORD(EXSCAN, Bytes(count, type), Bytes(count, type),
+         PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Exscan */
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+      void* recvbuf, int recvcount, MPI_Datatype recvtype, MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf,
+         recvcount, recvtype, comm);
+   int p;
+
+   PMPI_Comm_size(comm, &p);
+   RECORD(ALLTOALL, p*Bytes(sendcount, sendtype),
+         p*Bytes(recvcount, recvtype), PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Alltoall */
+
+int MPI_Alltoallv(const void* sendbuf, const int sendcounts[],
+      const int sdispls[], MPI_Datatype sendtype, void* recvbuf,
+      const int recvcounts[], const int rdispls[], MPI_Datatype recvtype,
+      MPI_Comm comm) {
+   double wait = Wait_time(comm), start = PMPI_Wtime();
+   int rv = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype,
+         recvbuf, recvcounts, rdispls, recvtype, comm);
+   int p, q;
+   double sent = 0.0, recvd = 0.0;
+
+   PMPI_Comm_size(comm, &p);
+   for (q = 0; q < p; q++) {
+      sent += Bytes(sendcounts[q], sendtype);
+      recvd += Bytes(recvcounts[q], recvtype);
+   }
+   RECORD(ALLTOALLV, sent, recvd, PMPI_Wtime() - start, wait);
+   return rv;
+}  /* MPI_Alltoallv */
+
+/*===================================================================
+ * Report
+ */
+
+/*-------------------------------------------------------------------
+ * Function:   Report
+ * Purpose:    Gather the sites from all the processes onto process 0
+ *             and print the report
+ */
+static void Report(void) {
+   double finish = PMPI_Wtime(), elapsed = finish - init_time, mpi_time;
+   int my_rank, p, q, s, t, total_count = 0;
+   int *counts = NULL, *displs = NULL;
+   site_t *all = NULL, *merged;
+   double *rank_mpi = NULL, *rank_elapsed = NULL;
+   double *min_time, *max_time;
+   int merged_count;
+
+   PMPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+   PMPI_Comm_size(MPI_COMM_WORLD, &p);
+
+   mpi_time = 0.0;
+   for (s = 0; s < site_count; s++) {
+      Name_site(&sites[s]);
+      sites[s].rank = my_rank;
+      mpi_time += sites[s].time + sites[s].wait;
+   }
+
+   /* Gather the per-process times and the sites as bytes */
+   if (my_rank == 0) {
+      counts = malloc(p*sizeof(int));
+      displs = malloc(p*sizeof(int));
+      rank_mpi = malloc(p*sizeof(double));
+      rank_elapsed = malloc(p*sizeof(double));
+   }
+   PMPI_Gather(&mpi_time, 1, MPI_DOUBLE, rank_mpi, 1, MPI_DOUBLE, 0,
+         MPI_COMM_WORLD);
+   PMPI_Gather(&elapsed, 1, MPI_DOUBLE, rank_elapsed, 1, MPI_DOUBLE, 0,
+         MPI_COMM_WORLD);
+   t = site_count*sizeof(site_t);
+   PMPI_Gather(&t, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+   if (my_rank == 0) {
+      for (q = 0; q < p; q++) {
+         displs[q] = total_count;
+         total_count += counts[q];
+      }
+      all = malloc(total_count + 1);
+   }
+   PMPI_Gatherv(sites, t, MPI_BYTE, all, counts, displs, MPI_BYTE, 0,
+         MPI_COMM_WORLD);
+   if (my_rank != 0) return;
+
+   fprintf(stderr, "\n===== MPI profile (%d processes) =====\n", p);
+   fprintf(stderr, "%-8s %12s %12s %8s\n", "Process", "Elapsed", "MPI",
+         "MPI %");
+   for (q = 0; q < p; q++)
+      fprintf(stderr, "%-8d %12.4e %12.4e %8.2f\n", q, rank_elapsed[q],
+            rank_mpi[q], 100.0*rank_mpi[q]/rank_elapsed[q]);
+
+   /* Merge the sites with the same op and name */
+   total_count /= sizeof(site_t);
+   merged = malloc((total_count + 1)*sizeof(site_t));
+   min_time = malloc((total_count + 1)*sizeof(double));
+   max_time = malloc((total_count + 1)*sizeof(double));
+   merged_count = 0;
+   for (s = 0; s < total_count; s++) {
+      for (t = 0; t < merged_count; t++)
+         if (merged[t].op == all[s].op &&
+               strcmp(merged[t].site, all[s].site) == 0)
+            break;
+      if (t == merged_count) {
+         merged[t] = all[s];
+         merged[t].rank = 1;  /* Number of processes */
+         min_time[t] = max_time[t] = all[s].time;
+         merged_count++;
+      } else {
+         merged[t].rank++;
+         merged[t].calls += all[s].calls;
+         merged[t].bytes_sent += all[s].bytes_sent;
+         merged[t].bytes_recv += all[s].bytes_recv;
+         merged[t].time += all[s].time;
+         merged[t].wait += all[s].wait;
+         if (all[s].time < min_time[t]) min_time[t] = all[s].time;
+         if (all[s].time > max_time[t]) max_time[t] = all[s].time;
+      }
+   }
+
+   fprintf(stderr, "\n%-10s %-28s %5s %9s %11s %11s %11s %11s %11s %11s\n",
+         "Call", "Site", "Procs", "Calls", "Bytes sent", "Bytes recv",
+         "Time", "Min time", "Max time", "Wait");
+   for (t = 0; t < merged_count; t++)
+      fprintf(stderr,
+            "%-10s %-28s %5d %9ld %11.4e %11.4e %11.4e %11.4e %11.4e %11.4e\n",
+            op_names[merged[t].op], merged[t].site, merged[t].rank,
+            merged[t].calls, merged[t].bytes_sent, merged[t].bytes_recv,
+            merged[t].time, min_time[t], max_time[t], merged[t].wait);
+   fprintf(stderr, "\n");
+
+   free(merged);
+   free(min_time);
+   free(max_time);
+   free(all);
+   free(counts);
+   free(displs);
+   free(rank_mpi);
+   free(rank_elapsed);
+}  /* Report */
@@ -0,0 +1,526 @@
+/*
+ * File:     mpi_pth_odd_even.c
+ * Purpose:  Implement a hybrid MPI + Pthreads odd-even transposition
+ *           sort of an array of nonnegative ints.  This is the same
+ *           algorithm as parallel_odd_even.c, but each process uses a
+ *           team of threads, so the program can be run with one
+ *           process per node (or socket) instead of one per core.
+ *           Since the number of phases is the number of processes,
+ *           this cuts the number of phases, while the threads keep
+ *           the cores busy:
+ *
+ *           - Local sort:  each thread sorts a block of the local list
+ *             with Hybrid_sort (see sort_net.h), and then the sorted
+ *             blocks are merged in log2(thread_count) rounds.
+ *           - Merge-split:  the main thread exchanges the local list
+ *             with the partner, and the threads merge the two lists in
+ *             parallel:  each thread computes a block of the local_n
+ *             elements kept by the process.
+ *
+ *           Each parallel merge divides the output among the threads
+ *           by blocks.  A thread finds where its block starts in each
+ *           of the two input lists by binary search (the "co-ranks" of
+ *           the first element of its block), and then merges its block
+ *           independently of the other threads.
+ * Input:
+ *    A:     elements of array (optional)
+ * Output:
+ *    A:     elements of A after sorting
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_pth_odd_even
+ *              mpi_pth_odd_even.c sort_net.c -lpthread
+ * Run:
+ *    mpiexec -n <p> mpi_pth_odd_even <thread_count> <g|i> <global_n>
+ *          [sorts]
+ *       - p: the number of processes
+ *       - thread_count: the number of threads in each process
+ *       - g: generate random, distributed list
+ *       - i: user will input list on process 0
+ *       - global_n: number of elements in global list
+ *       - sorts: number of times to sort a copy of the list
+ *         (default 1)
+ *
+ * Notes:
+ * 1.  global_n must be evenly divisible by p
+ * 2.  The program uses MPI_THREAD_FUNNELED:  the main thread is thread
+ *     0 of the team, and it makes all of the MPI calls.
+ * 3.  The lists are generated the same way as in parallel_odd_even.c,
+ *     so with the same p the two programs sort the same list.
+ * 4.  As in parallel_odd_even.c, the merge-splits write into a spare
+ *     buffer that trades places with the local list, and the buffers
+ *     are allocated once.  The elapsed time is the total over the
+ *     sorts.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <mpi.h>
+#include "sort_net.h"
+
+// const int RMAX = 1000000000;
+const int RMAX = 100;
+
+/* Global variables:  shared by the threads in a process */
+int      thread_count;
+int      local_n, sorts;
+int      my_rank, p;
+int      even_partner;  /* phase is even or left-looking */
+int      odd_partner;   /* phase is odd or right-looking */
+int     *input;         /* The unsorted local list                */
+int     *local_A;       /* The process' sublist                   */
+int     *temp_B;        /* The sublist received from the partner  */
+int     *temp_C;        /* The result of a merge                  */
+double   elapsed;
+MPI_Comm comm;
+pthread_barrier_t barrier;
+
+/* Local functions */
+void Usage(char* program);
+void Generate_list(int local_A[], int local_n, int my_rank);
+void Get_block(long my_thread, int total, int* my_first_p,
+         int* my_last_p);
+int  Run_first(int r);
+int  Co_rank(int k, int A[], int m, int B[], int n);
+void Merge(int A[], int m, int B[], int n, int C[], int count);
+void Par_merge(int A[], int m, int B[], int n, int C[], int out_first,
+         int out_last, long my_thread);
+void Local_sort(long my_thread);
+void Merge_split(int keep_low, long my_thread);
+void Swap_lists(void);
+void* Pth_sort(void* thread);
+
+/* Functions involving communication */
+void Get_args(int argc, char* argv[], int* global_n_p, char* gi_p);
+void Print_global_list(int local_A[]);
+void Read_list(int local_A[]);
+
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int provided, global_n;
+   long thread;
+   char g_i;
+   pthread_t* thread_handles;
+
+   MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &p);
+   MPI_Comm_rank(comm, &my_rank);
+   if (provided < MPI_THREAD_FUNNELED) {
+      if (my_rank == 0)
+         fprintf(stderr, "MPI doesn't provide MPI_THREAD_FUNNELED\n");
+      MPI_Finalize();
+      exit(-1);
+   }
+
+   Get_args(argc, argv, &global_n, &g_i);
+   input = (int*) malloc(local_n*sizeof(int));
+   local_A = (int*) malloc(local_n*sizeof(int));
+   temp_B = (int*) malloc(local_n*sizeof(int));
+   temp_C = (int*) malloc(local_n*sizeof(int));
+   if (g_i == 'g') {
+      Generate_list(input, local_n, my_rank);
+   } else {
+      Read_list(input);
+   }
+
+   /* Find partners:  negative rank => do nothing during phase */
+   if (my_rank % 2 != 0) {
+      even_partner = my_rank - 1;
+      odd_partner = my_rank + 1;
+      if (odd_partner == p)
+         odd_partner = -1;  // Idle during odd phase
+   } else {
+      even_partner = my_rank + 1;
+      if (even_partner == p)
+         even_partner = -1;  // Idle during even phase
+      odd_partner = my_rank-1;
+   }
+
+   /* The main thread is thread 0 */
+   pthread_barrier_init(&barrier, NULL, thread_count);
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   for (thread = 1; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL, Pth_sort,
+            (void*) thread);
+   Pth_sort((void*) 0);
+   for (thread = 1; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+
+   if (my_rank == 0) {
+      printf("Elapsed time = %e seconds\n", elapsed);
+      if (sorts > 1)
+         printf("Time per sort = %e seconds\n", elapsed/sorts);
+   }
+   Print_global_list(local_A);
+
+   pthread_barrier_destroy(&barrier);
+   free(thread_handles);
+   free(input);
+   free(local_A);
+   free(temp_B);
+   free(temp_C);
+   MPI_Finalize();
+
+   return 0;
+}  /* main */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Generate_list
+ * Purpose:    Fill list with random ints
+ * Input Args: local_n, my_rank
+ * Output Arg: local_A
+ */
+void Generate_list(int local_A[], int local_n, int my_rank) {
+   int i;
+
+   srandom(my_rank+1);
+   for (i = 0; i < local_n; i++)
+      local_A[i] = random() % RMAX;
+}  /* Generate_list */
+
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print command line to start program
+ * In arg:    program:  name of executable
+ * Note:      Purely local, run only by process 0;
+ */
+void Usage(char* program) {
+   fprintf(stderr, "usage:  mpirun -np <p> %s <thread_count> <g|i> "
+         "<global_n> [sorts]\n", program);
+   fprintf(stderr, "   - p: the number of processes \n");
+   fprintf(stderr, "   - thread_count: the number of threads in each "
+         "process\n");
+   fprintf(stderr, "   - g: generate random, distributed list\n");
+   fprintf(stderr, "   - i: user will input list on process 0\n");
+   fprintf(stderr, "   - global_n: number of elements in global list");
+   fprintf(stderr, " (must be evenly divisible by p)\n");
+   fprintf(stderr, "   - sorts: number of times to sort the list\n");
+   fflush(stderr);
+}  /* Usage */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check command line arguments
+ * Input args:  argc, argv
+ * Output args: global_n_p, gi_p
+ * Out globals: thread_count, local_n, sorts
+ */
+void Get_args(int argc, char* argv[], int* global_n_p, char* gi_p) {
+   int args[3];
+
+   if (my_rank == 0) {
+      if (argc != 4 && argc != 5) {
+         Usage(argv[0]);
+         *global_n_p = -1;  /* Bad args, quit */
+      } else {
+         thread_count = strtol(argv[1], NULL, 10);
+         *gi_p = argv[2][0];
+         *global_n_p = strtol(argv[3], NULL, 10);
+         sorts = (argc == 5) ? strtol(argv[4], NULL, 10) : 1;
+         if (thread_count < 1 || (*gi_p != 'g' && *gi_p != 'i') ||
+               *global_n_p % p != 0 || sorts < 1) {
+            Usage(argv[0]);
+            *global_n_p = -1;
+         }
+      }
+      args[0] = *global_n_p;
+      args[1] = thread_count;
+      args[2] = sorts;
+   }  /* my_rank == 0 */
+
+   MPI_Bcast(gi_p, 1, MPI_CHAR, 0, comm);
+   MPI_Bcast(args, 3, MPI_INT, 0, comm);
+   *global_n_p = args[0];
+   thread_count = args[1];
+   sorts = args[2];
+
+   if (*global_n_p <= 0) {
+      MPI_Finalize();
+      exit(-1);
+   }
+
+   local_n = *global_n_p/p;
+}  /* Get_args */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Read_list
+ * Purpose:    process 0 reads the list from stdin and scatters it
+ *             to the other processes.
+ * In globals: local_n, my_rank, p, comm
+ * Out arg:    local_A
+ */
+void Read_list(int local_A[]) {
+   int i;
+   int *temp = NULL;
+
+   if (my_rank == 0) {
+      temp = (int*) malloc(p*local_n*sizeof(int));
+      printf("Enter the elements of the list\n");
+      for (i = 0; i < p*local_n; i++)
+         scanf("%d", &temp[i]);
+   }
+
+   MPI_Scatter(temp, local_n, MPI_INT, local_A, local_n, MPI_INT,
+       0, comm);
+
+   if (my_rank == 0)
+      free(temp);
+}  /* Read_list */
+
+
+/*-------------------------------------------------------------------
+ * Function:   Print_global_list
+ * Purpose:    Gather the local lists onto process 0 and print them
+ * In arg:     local_A
+ * In globals: local_n, my_rank, p, comm
+ */
+void Print_global_list(int local_A[]) {
+   int* A = NULL;
+   int i, n;
+
+   if (my_rank == 0) {
+      n = p*local_n;
+      A = (int*) malloc(n*sizeof(int));
+      MPI_Gather(local_A, local_n, MPI_INT, A, local_n, MPI_INT, 0,
+            comm);
+      printf("Global list:\n");
+      for (i = 0; i < n; i++)
+         printf("%d ", A[i]);
+      printf("\n\n");
+      free(A);
+   } else {
+      MPI_Gather(local_A, local_n, MPI_INT, A, local_n, MPI_INT, 0,
+            comm);
+   }
+}  /* Print_global_list */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Get_block
+ * Purpose:     Find the block of 0, 1, ..., total-1 assigned to a
+ *              thread
+ * In args:     my_thread, total
+ * Out args:    my_first_p, my_last_p:  the thread's block is
+ *              my_first <= i < my_last
+ * In global:   thread_count
+ */
+void Get_block(long my_thread, int total, int* my_first_p, int* my_last_p) {
+   *my_first_p = (int) (((long) total)*my_thread/thread_count);
+   *my_last_p = (int) (((long) total)*(my_thread + 1)/thread_count);
+}  /* Get_block */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Run_first
+ * Purpose:     Return the first element of thread r's block of the
+ *              local list, or local_n if r >= thread_count
+ * In arg:      r
+ * In globals:  local_n, thread_count
+ */
+int Run_first(int r) {
+   int first, last;
+
+   if (r >= thread_count) return local_n;
+   Get_block(r, local_n, &first, &last);
+   return first;
+}  /* Run_first */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Co_rank
+ * Purpose:     Find how many of the first k elements of the merge of
+ *              the sorted lists A and B come from A.  When an element
+ *              of A is equal to an element of B, the element of A
+ *              comes first.
+ * In args:     k, A, m, B, n:  A has m elements, B has n, and
+ *              0 <= k <= m + n
+ * Ret val:     i, so that the first k elements of the merge are
+ *              A[0..i-1] and B[0..k-i-1]
+ */
+int Co_rank(int k, int A[], int m, int B[], int n) {
+   int lo = (k - n > 0) ? k - n : 0;
+   int hi = (k < m) ? k : m;
+   int mid;
+
+   /* Find the smallest i with B[k-i-1] < A[i] */
+   while (lo < hi) {
+      mid = lo + (hi - lo)/2;
+      if (B[k-mid-1] >= A[mid])
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}  /* Co_rank */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Merge
+ * Purpose:     Store the first count elements of the merge of the
+ *              sorted lists A and B in C
+ * In args:     A, m, B, n, count:  count <= m + n
+ * Out arg:     C
+ */
+void Merge(int A[], int m, int B[], int n, int C[], int count) {
+   int ai = 0, bi = 0, ci;
+
+   for (ci = 0; ci < count; ci++)
+      if (bi >= n || (ai < m && A[ai] <= B[bi]))
+         C[ci] = A[ai++];
+      else
+         C[ci] = B[bi++];
+}  /* Merge */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Par_merge
+ * Purpose:     Store elements out_first, ..., out_last-1 of the merge
+ *              of the sorted lists A and B in C[0], ...,
+ *              C[out_last-out_first-1].  Each thread computes a block
+ *              of the elements.
+ * In args:     A, m, B, n, out_first, out_last, my_thread
+ * Out arg:     C
+ * In global:   thread_count
+ */
+void Par_merge(int A[], int m, int B[], int n, int C[], int out_first,
+      int out_last, long my_thread) {
+   int my_first, my_last, i_first, i_last;
+
+   Get_block(my_thread, out_last - out_first, &my_first, &my_last);
+   if (my_first == my_last) return;
+   i_first = Co_rank(out_first + my_first, A, m, B, n);
+   i_last = Co_rank(out_first + my_last, A, m, B, n);
+   Merge(A + i_first, i_last - i_first,
+         B + (out_first + my_first - i_first),
+         (out_first + my_last - i_last) - (out_first + my_first - i_first),
+         C + my_first, my_last - my_first);
+}  /* Par_merge */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Swap_lists
+ * Purpose:     Make the merged list the local list.  Called by one
+ *              thread between barriers.
+ * In/out globals: local_A, temp_C
+ */
+void Swap_lists(void) {
+   int* swap = local_A;
+
+   local_A = temp_C;
+   temp_C = swap;
+}  /* Swap_lists */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Local_sort
+ * Purpose:     Sort local_A.  Each thread sorts a block with
+ *              Hybrid_sort, and then pairs of sorted runs are merged
+ *              by all the threads until there's one run.
+ * In arg:      my_thread
+ * In/out globals: local_A, temp_C
+ */
+void Local_sort(long my_thread) {
+   int my_first, my_last, width, r, first, mid, last;
+
+   Get_block(my_thread, local_n, &my_first, &my_last);
+   Hybrid_sort(local_A + my_first, my_last - my_first);
+   pthread_barrier_wait(&barrier);
+
+   /* Run r is the block of local_A sorted by thread r */
+   for (width = 1; width < thread_count; width *= 2) {
+      for (r = 0; r < thread_count; r += 2*width) {
+         first = Run_first(r);
+         mid = Run_first(r + width);
+         last = Run_first(r + 2*width);
+         if (r + width < thread_count) {
+            Par_merge(local_A + first, mid - first, local_A + mid,
+                  last - mid, temp_C + first, 0, last - first, my_thread);
+         } else if (my_thread == 0) {
+            /* No partner:  copy the run */
+            memcpy(temp_C + first, local_A + first,
+                  (local_n - first)*sizeof(int));
+         }
+      }
+      pthread_barrier_wait(&barrier);
+      if (my_thread == 0) Swap_lists();
+      pthread_barrier_wait(&barrier);
+   }
+}  /* Local_sort */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Merge_split
+ * Purpose:     Store the smallest (keep_low != 0) or the largest
+ *              local_n elements of local_A and temp_B in temp_C.  The
+ *              threads each compute a block.
+ * In args:     keep_low, my_thread
+ * In globals:  local_A, temp_B, local_n
+ * Out global:  temp_C
+ */
+void Merge_split(int keep_low, long my_thread) {
+   if (keep_low)
+      Par_merge(local_A, local_n, temp_B, local_n, temp_C, 0, local_n,
+            my_thread);
+   else
+      Par_merge(local_A, local_n, temp_B, local_n, temp_C, local_n,
+            2*local_n, my_thread);
+}  /* Merge_split */
+
+
+/*-------------------------------------------------------------------
+ * Function:    Pth_sort
+ * Purpose:     Thread function:  sort the list sorts times with
+ *              odd-even transposition sort.  Thread 0 is the main
+ *              thread, and it makes all the MPI calls.
+ * In arg:      thread:  the thread's rank in the team
+ * Globals:     all
+ */
+void* Pth_sort(void* thread) {
+   long my_thread = (long) thread;
+   int s, phase, partner, keep_low;
+   double start = 0.0;
+   MPI_Status status;
+
+   if (my_thread == 0) elapsed = 0.0;
+   for (s = 0; s < sorts; s++) {
+      if (my_thread == 0) {
+         memcpy(local_A, input, local_n*sizeof(int));
+         MPI_Barrier(comm);
+         start = MPI_Wtime();
+      }
+      pthread_barrier_wait(&barrier);
+
+      Local_sort(my_thread);
+
+      for (phase = 0; phase < p; phase++) {
+         if (phase % 2 == 0) {  /* Even phase, odd process <-> rank-1 */
+            partner = even_partner;
+            keep_low = (my_rank % 2 == 0);
+         } else { /* Odd phase, odd process <-> rank+1 */
+            partner = odd_partner;
+            keep_low = (my_rank % 2 != 0);
+         }
+         if (partner < 0) continue;
+
+         if (my_thread == 0)
+            MPI_Sendrecv(local_A, local_n, MPI_INT, partner, 0,
+               temp_B, local_n, MPI_INT, partner, 0, comm, &status);
+         pthread_barrier_wait(&barrier);
+         Merge_split(keep_low, my_thread);
+         pthread_barrier_wait(&barrier);
+         /* The other threads don't use local_A until the next barrier */
+         if (my_thread == 0) Swap_lists();
+      }
+
+      if (my_thread == 0) elapsed += MPI_Wtime() - start;
+      pthread_barrier_wait(&barrier);
+   }
+
+   return NULL;
+}  /* Pth_sort */
@@ -0,0 +1,687 @@
+/* File:     mpi_sssp.c
+ *
+ * Purpose:  Find the costs of the shortest paths from one vertex to
+ *           every vertex of a digraph with the delta-stepping
+ *           algorithm, using MPI and Pthreads.  For a single source
+ *           this does much less work than Floyd's algorithm in
+ *           mpi_floyd.c, which finds the costs for every pair of
+ *           vertices.
+ *
+ *           The vertices are distributed by blocks among the processes,
+ *           and each process stores the edges leaving its vertices in
+ *           compressed sparse row (CSR) format.  Within a process, each
+ *           thread owns a block of the process' vertices, and keeps its
+ *           own buckets:  bucket b holds the vertices whose tentative
+ *           cost d satisfies b*delta <= d < (b+1)*delta.  The buckets
+ *           are processed in order:
+ *
+ *           - Light phase:  the vertices in the current bucket are
+ *             removed, and their edges with cost <= delta ("light"
+ *             edges) are relaxed.  This can put vertices back in the
+ *             current bucket, so the phase is repeated until the
+ *             bucket is empty on every thread of every process.
+ *           - Heavy phase:  the edges with cost > delta leaving the
+ *             vertices removed from the bucket are relaxed.  They
+ *             can't add vertices to the current bucket.
+ *
+ *           A relaxation of an edge u -> v is a request (v, cost(u) +
+ *           cost(u, v)) sent to the thread that owns v.  The threads
+ *           sort their requests by destination, and the main thread
+ *           exchanges them with a single MPI_Alltoallv.  Then each
+ *           thread applies the requests for its vertices, so the costs
+ *           and buckets don't need locks or atomics.
+ *
+ * Compile:  mpicc -g -Wall -O2 -o mpi_sssp mpi_sssp.c -lpthread
+ * Run:      mpiexec -n <p> ./mpi_sssp <thread_count> <source> [delta]
+ *              thread_count:  the number of threads in each process
+ *              source:  the vertex the paths start at
+ *              delta:  the width of a bucket (default:  see note 3)
+ *
+ * Input:    n, the number of vertices
+ *           mat, the adjacency matrix, in the format used by floyd.c
+ *              and mpi_floyd.c
+ * Output:   The costs of the shortest paths from source to each vertex:
+ *           the same as row source of the output of mpi_floyd.  The
+ *           time taken by the algorithm.
+ *
+ * Notes:
+ * 1.  n, the number of vertices, should be evenly divisible by p.
+ * 2.  Edge costs must be positive, and INFINITY means there's no edge.
+ * 3.  With small delta, fewer vertices are relaxed more than once, but
+ *     there are more buckets, and each bucket costs at least two
+ *     exchanges.  The default is max_cost/2 (at least 1), where
+ *     max_cost is the largest edge cost.
+ * 4.  The program uses MPI_THREAD_FUNNELED:  the main thread is thread
+ *     0 of the team, and it makes all of the MPI calls.
+ * 5.  The buckets are circular:  no tentative cost can be more than
+ *     max_cost past the current bucket, so max_cost/delta + 2 buckets
+ *     are enough.  A vertex isn't removed from its old bucket when
+ *     its cost drops.  Entries that no longer match the vertex's
+ *     cost are skipped.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <mpi.h>
+
+const int INFINITY = 1000000;
+
+typedef struct {
+   int* list;
+   int  count, capacity;
+} vec_t;
+
+typedef struct {
+   int vertex;   /* Global vertex    */
+   int cost;     /* Tentative cost   */
+} req_t;         /* Same layout as MPI_2INT */
+
+typedef struct {
+   req_t* list;
+   int    count, capacity;
+} req_vec_t;
+
+typedef struct {
+   int        first, last;  /* The thread's block of local vertices   */
+   vec_t*     buckets;      /* bucket_count circular buckets          */
+   vec_t      frontier;     /* Vertices being relaxed                 */
+   vec_t      settled;      /* Vertices removed from current bucket   */
+   req_vec_t* out;          /* Requests for each thread of each process */
+   int*       out_offset;   /* Where out[d] goes in send_buf          */
+   int        min_bucket;
+   int        more;
+} thread_data_t;
+
+/* Global variables:  shared by the threads in a process */
+int      thread_count, n, local_n, my_rank, p, source, delta;
+int      bucket_count, cur_bucket, more;
+int     *row_ptr, *col, *cost;   /* Local CSR:  edges of local vertices */
+int     *dist;                   /* Tentative costs of local vertices   */
+int     *relaxed;                /* Cost when last relaxed, or -1       */
+char    *is_settled;
+thread_data_t* threads;
+req_t   *send_buf, *recv_buf;
+int      send_cap, recv_cap;
+int     *send_slot_counts, *recv_slot_counts;
+int     *send_counts, *send_displs, *recv_counts, *recv_displs;
+double   elapsed;
+MPI_Comm comm;
+pthread_barrier_t barrier;
+
+/* Local functions */
+void Usage(char* prog_name);
+void Get_block(long my_thread, int total, int* my_first_p,
+      int* my_last_p);
+int  Slot(int v);
+void Push(vec_t* vec, int x);
+void Push_req(req_vec_t* vec, int v, int c);
+void Relax_edges(long my_thread, int lv, int light);
+void Relax(long my_thread, int v, int c);
+int  Valid(int lv, int b);
+int  Min_bucket(long my_thread, int from);
+void Take_bucket(long my_thread, int b);
+void Init_threads(int max_cost);
+void Free_threads(void);
+void* Pth_sssp(void* thread);
+
+/* Functions involving communication */
+void Get_args(int argc, char* argv[]);
+int  Read_graph(void);
+void Exchange(long my_thread);
+void Print_dist(void);
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int provided, max_cost, i;
+   long thread;
+   pthread_t* thread_handles;
+
+   MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &p);
+   MPI_Comm_rank(comm, &my_rank);
+   if (provided < MPI_THREAD_FUNNELED) {
+      if (my_rank == 0)
+         fprintf(stderr, "MPI doesn't provide MPI_THREAD_FUNNELED\n");
+      MPI_Finalize();
+      exit(-1);
+   }
+   Get_args(argc, argv);
+
+   max_cost = Read_graph();
+   if (delta <= 0) delta = (max_cost/2 > 0) ? max_cost/2 : 1;
+   dist = malloc(local_n*sizeof(int));
+   relaxed = malloc(local_n*sizeof(int));
+   is_settled = calloc(local_n, sizeof(char));
+   for (i = 0; i < local_n; i++) {
+      dist[i] = INT_MAX;
+      relaxed[i] = -1;
+   }
+   Init_threads(max_cost);
+
+   /* The main thread is thread 0 */
+   pthread_barrier_init(&barrier, NULL, thread_count);
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   for (thread = 1; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL, Pth_sssp,
+            (void*) thread);
+   Pth_sssp((void*) 0);
+   for (thread = 1; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+
+   Print_dist();
+   if (my_rank == 0)
+      printf("Elapsed time for SSSP = %e seconds\n", elapsed);
+
+   pthread_barrier_destroy(&barrier);
+   free(thread_handles);
+   Free_threads();
+   free(row_ptr);
+   free(col);
+   free(cost);
+   free(dist);
+   free(relaxed);
+   free(is_settled);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage:  mpiexec -n <p> %s <thread_count> <source>"
+         " [delta]\n", prog_name);
+   fprintf(stderr, "   thread_count:  the number of threads in each"
+         " process\n");
+   fprintf(stderr, "   source:  the vertex the paths start at\n");
+   fprintf(stderr, "   delta:  the width of a bucket\n");
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check the command line arguments on process 0,
+ *              and broadcast them
+ * In args:     argc, argv
+ * Out globals: thread_count, source, delta (0 for the default)
+ */
+void Get_args(int argc, char* argv[]) {
+   int args[3] = {-1, 0, 0};
+
+   if (my_rank == 0) {
+      if (argc == 3 || argc == 4) {
+         args[0] = strtol(argv[1], NULL, 10);
+         args[1] = strtol(argv[2], NULL, 10);
+         args[2] = (argc == 4) ? strtol(argv[3], NULL, 10) : 0;
+      }
+      if (args[0] <= 0 || args[1] < 0 || args[2] < 0) {
+         Usage(argv[0]);
+         args[0] = -1;
+      }
+   }
+   MPI_Bcast(args, 3, MPI_INT, 0, comm);
+   if (args[0] <= 0) {
+      MPI_Finalize();
+      exit(-1);
+   }
+   thread_count = args[0];
+   source = args[1];
+   delta = args[2];
+}  /* Get_args */
+
+/*-------------------------------------------------------------------
+ * Function:    Read_graph
+ * Purpose:     Read the adjacency matrix on process 0, send each
+ *              process its block of rows, and store the edges of the
+ *              local vertices in CSR format
+ * Out globals: n, local_n, row_ptr, col, cost
+ * Ret val:     The largest edge cost on any process
+ * Note:        Process 0 stores its own block of rows and one other
+ *              block, not the whole matrix.
+ */
+int Read_graph(void) {
+   int *rows, *temp = NULL;
+   int q, i, j, edges = 0, max_cost = 1, c;
+
+   if (my_rank == 0) {
+      printf("How many vertices?\n");
+      if (scanf("%d", &n) != 1) n = -1;
+   }
+   MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+   if (n <= 0 || n % p != 0 || source >= n) {
+      if (my_rank == 0)
+         fprintf(stderr, "n must be positive and divisible by p, and "
+               "source must be less than n\n");
+      MPI_Finalize();
+      exit(-1);
+   }
+   local_n = n/p;
+   rows = malloc(((size_t) local_n)*n*sizeof(int));
+
+   if (my_rank == 0) {
+      printf("Enter the matrix\n");
+      for (i = 0; i < local_n*n; i++)
+         scanf("%d", &rows[i]);
+      if (p > 1) temp = malloc(((size_t) local_n)*n*sizeof(int));
+      for (q = 1; q < p; q++) {
+         for (i = 0; i < local_n*n; i++)
+            scanf("%d", &temp[i]);
+         MPI_Send(temp, local_n*n, MPI_INT, q, 0, comm);
+      }
+      free(temp);
+   } else {
+      MPI_Recv(rows, local_n*n, MPI_INT, 0, 0, comm, MPI_STATUS_IGNORE);
+   }
+
+   row_ptr = malloc((local_n + 1)*sizeof(int));
+   for (i = 0; i < local_n*n; i++)
+      if (rows[i] != INFINITY && i % n != my_rank*local_n + i/n) edges++;
+   col = malloc(edges*sizeof(int));
+   cost = malloc(edges*sizeof(int));
+   edges = 0;
+   for (i = 0; i < local_n; i++) {
+      row_ptr[i] = edges;
+      for (j = 0; j < n; j++) {
+         c = rows[i*n + j];
+         if (c != INFINITY && j != my_rank*local_n + i) {
+            col[edges] = j;
+            cost[edges] = c;
+            if (c > max_cost) max_cost = c;
+            edges++;
+         }
+      }
+   }
+   row_ptr[local_n] = edges;
+   free(rows);
+
+   MPI_Allreduce(MPI_IN_PLACE, &max_cost, 1, MPI_INT, MPI_MAX, comm);
+   return max_cost;
+}  /* Read_graph */
+
+/*-------------------------------------------------------------------
+ * Function:    Get_block
+ * Purpose:     Find the block of 0, 1, ..., total-1 assigned to a
+ *              thread
+ * In args:     my_thread, total
+ * Out args:    my_first_p, my_last_p:  the thread's block is
+ *              my_first <= i < my_last
+ * In global:   thread_count
+ */
+void Get_block(long my_thread, int total, int* my_first_p,
+      int* my_last_p) {
+   *my_first_p = (int) (((long) total)*my_thread/thread_count);
+   *my_last_p = (int) (((long) total)*(my_thread + 1)/thread_count);
+}  /* Get_block */
+
+/*-------------------------------------------------------------------
+ * Function:    Slot
+ * Purpose:     Return q*thread_count + t, where process q owns global
+ *              vertex v and its thread t owns v (see Get_block)
+ * In arg:      v
+ * In globals:  local_n, thread_count
+ */
+int Slot(int v) {
+   int q = v/local_n, lv = v % local_n;
+
+   return q*thread_count +
+      (int) ((((long) lv + 1)*thread_count - 1)/local_n);
+}  /* Slot */
+
+/*-------------------------------------------------------------------
+ * Function:    Push
+ * Purpose:     Append x to vec, making it bigger if necessary
+ * In arg:      x
+ * In/out arg:  vec
+ */
+void Push(vec_t* vec, int x) {
+   if (vec->count == vec->capacity) {
+      vec->capacity = (vec->capacity == 0) ? 16 : 2*vec->capacity;
+      vec->list = realloc(vec->list, vec->capacity*sizeof(int));
+   }
+   vec->list[vec->count++] = x;
+}  /* Push */
+
+/*-------------------------------------------------------------------
+ * Function:    Push_req
+ * Purpose:     Append the request (v, c) to vec, making it bigger if
+ *              necessary
+ * In args:     v, c
+ * In/out arg:  vec
+ */
+void Push_req(req_vec_t* vec, int v, int c) {
+   if (vec->count == vec->capacity) {
+      vec->capacity = (vec->capacity == 0) ? 16 : 2*vec->capacity;
+      vec->list = realloc(vec->list, vec->capacity*sizeof(req_t));
+   }
+   vec->list[vec->count].vertex = v;
+   vec->list[vec->count].cost = c;
+   vec->count++;
+}  /* Push_req */
+
+/*-------------------------------------------------------------------
+ * Function:    Init_threads
+ * Purpose:     Allocate and initialize the data of the threads and the
+ *              buffers for the exchanges
+ * In arg:      max_cost:  the largest edge cost
+ * In globals:  thread_count, local_n, p, delta
+ * Out globals: bucket_count, cur_bucket, threads, and the counts and
+ *              buffers used by Exchange
+ */
+void Init_threads(int max_cost) {
+   int t, slots = p*thread_count;
+
+   bucket_count = max_cost/delta + 2;
+   cur_bucket = 0;
+   threads = calloc(thread_count, sizeof(thread_data_t));
+   for (t = 0; t < thread_count; t++) {
+      Get_block(t, local_n, &threads[t].first, &threads[t].last);
+      threads[t].buckets = calloc(bucket_count, sizeof(vec_t));
+      threads[t].out = calloc(slots, sizeof(req_vec_t));
+      threads[t].out_offset = malloc(slots*sizeof(int));
+   }
+   send_slot_counts = malloc(slots*sizeof(int));
+   recv_slot_counts = malloc(slots*sizeof(int));
+   send_counts = malloc(p*sizeof(int));
+   send_displs = malloc(p*sizeof(int));
+   recv_counts = malloc(p*sizeof(int));
+   recv_displs = malloc(p*sizeof(int));
+   send_buf = recv_buf = NULL;
+   send_cap = recv_cap = 0;
+}  /* Init_threads */
+
+/*-------------------------------------------------------------------
+ * Function:    Free_threads
+ * Purpose:     Free the storage allocated by Init_threads
+ */
+void Free_threads(void) {
+   int t, b, d;
+
+   for (t = 0; t < thread_count; t++) {
+      for (b = 0; b < bucket_count; b++)
+         free(threads[t].buckets[b].list);
+      for (d = 0; d < p*thread_count; d++)
+         free(threads[t].out[d].list);
+      free(threads[t].buckets);
+      free(threads[t].out);
+      free(threads[t].out_offset);
+      free(threads[t].frontier.list);
+      free(threads[t].settled.list);
+   }
+   free(threads);
+   free(send_slot_counts);
+   free(recv_slot_counts);
+   free(send_counts);
+   free(send_displs);
+   free(recv_counts);
+   free(recv_displs);
+   free(send_buf);
+   free(recv_buf);
+}  /* Free_threads */
+
+/*-------------------------------------------------------------------
+ * Function:    Relax_edges
+ * Purpose:     Make a request for each light (light = 1) or heavy
+ *              (light = 0) edge leaving local vertex lv
+ * In args:     my_thread, lv, light
+ * In globals:  row_ptr, col, cost, dist, delta
+ * In/out global:  threads[my_thread].out
+ */
+void Relax_edges(long my_thread, int lv, int light) {
+   int e, d = dist[lv];
+   req_vec_t* out = threads[my_thread].out;
+
+   for (e = row_ptr[lv]; e < row_ptr[lv+1]; e++)
+      if ((cost[e] <= delta) == light)
+         Push_req(&out[Slot(col[e])], col[e], d + cost[e]);
+}  /* Relax_edges */
+
+/*-------------------------------------------------------------------
+ * Function:    Relax
+ * Purpose:     Apply the request (v, c):  if c is less than the
+ *              tentative cost of v, make it v's cost, and put v in
+ *              the bucket for c
+ * In args:     my_thread:  the owner of v
+ *              v:  a global vertex owned by this process
+ *              c
+ * In/out globals:  dist, threads[my_thread].buckets
+ */
+void Relax(long my_thread, int v, int c) {
+   int lv = v - my_rank*local_n;
+
+   if (c < dist[lv]) {
+      dist[lv] = c;
+      Push(&threads[my_thread].buckets[(c/delta) % bucket_count], lv);
+   }
+}  /* Relax */
+
+/*-------------------------------------------------------------------
+ * Function:    Valid
+ * Purpose:     Return 1 if an entry for local vertex lv in bucket b
+ *              still needs to be relaxed:  lv's cost is in bucket b,
+ *              and lv hasn't been relaxed with this cost
+ * In args:     lv, b
+ */
+int Valid(int lv, int b) {
+   return dist[lv]/delta == b && relaxed[lv] != dist[lv];
+}  /* Valid */
+
+/*-------------------------------------------------------------------
+ * Function:    Min_bucket
+ * Purpose:     Find the thread's first bucket b >= from with an entry
+ *              that needs to be relaxed.  Entries that don't are
+ *              removed from the buckets that are searched.
+ * In args:     my_thread, from
+ * In/out global:  threads[my_thread].buckets
+ * Ret val:     b, or INT_MAX if all the thread's buckets are empty
+ */
+int Min_bucket(long my_thread, int from) {
+   int b, i, count;
+   vec_t* bucket;
+
+   for (b = from; b < from + bucket_count; b++) {
+      bucket = &threads[my_thread].buckets[b % bucket_count];
+      count = 0;
+      for (i = 0; i < bucket->count; i++)
+         if (Valid(bucket->list[i], b))
+            bucket->list[count++] = bucket->list[i];
+      bucket->count = count;
+      if (count > 0) return b;
+   }
+   return INT_MAX;
+}  /* Min_bucket */
+
+/*-------------------------------------------------------------------
+ * Function:    Take_bucket
+ * Purpose:     Empty bucket b of the thread into its frontier, and add
+ *              the vertices to its settled list
+ * In args:     my_thread, b
+ * In/out globals:  threads[my_thread], relaxed, is_settled
+ */
+void Take_bucket(long my_thread, int b) {
+   thread_data_t* td = &threads[my_thread];
+   vec_t* bucket = &td->buckets[b % bucket_count];
+   int i, lv;
+
+   td->frontier.count = 0;
+   for (i = 0; i < bucket->count; i++) {
+      lv = bucket->list[i];
+      if (!Valid(lv, b)) continue;
+      relaxed[lv] = dist[lv];
+      Push(&td->frontier, lv);
+      if (!is_settled[lv]) {
+         is_settled[lv] = 1;
+         Push(&td->settled, lv);
+      }
+   }
+   bucket->count = 0;
+}  /* Take_bucket */
+
+/*-------------------------------------------------------------------
+ * Function:    Exchange
+ * Purpose:     Send the requests made by all the threads to the
+ *              threads that own the vertices, and apply the requests
+ *              received by this thread
+ * In arg:      my_thread
+ * In/out globals:  threads, and the counts and buffers for the
+ *              exchange
+ * Note:        The send buffer holds the requests for slot 0 (thread
+ *              0 of process 0) from threads 0, 1, . . ., then the
+ *              requests for slot 1, and so on.  So the requests for a
+ *              process are contiguous, and, after the MPI_Alltoallv,
+ *              the requests for a thread from each process are
+ *              contiguous.
+ */
+void Exchange(long my_thread) {
+   thread_data_t* td = &threads[my_thread];
+   int slots = p*thread_count, d, t, q, offset, first, i;
+
+   pthread_barrier_wait(&barrier);
+   if (my_thread == 0) {
+      offset = 0;
+      for (d = 0; d < slots; d++) {
+         send_slot_counts[d] = 0;
+         for (t = 0; t < thread_count; t++) {
+            threads[t].out_offset[d] = offset;
+            offset += threads[t].out[d].count;
+            send_slot_counts[d] += threads[t].out[d].count;
+         }
+      }
+      MPI_Alltoall(send_slot_counts, thread_count, MPI_INT,
+            recv_slot_counts, thread_count, MPI_INT, comm);
+      for (q = 0; q < p; q++) {
+         send_counts[q] = recv_counts[q] = 0;
+         for (t = 0; t < thread_count; t++) {
+            send_counts[q] += send_slot_counts[q*thread_count + t];
+            recv_counts[q] += recv_slot_counts[q*thread_count + t];
+         }
+         send_displs[q] = (q == 0) ? 0 : send_displs[q-1] + send_counts[q-1];
+         recv_displs[q] = (q == 0) ? 0 : recv_displs[q-1] + recv_counts[q-1];
+      }
+      if (offset > send_cap) {
+         send_cap = 2*offset;
+         send_buf = realloc(send_buf, send_cap*sizeof(req_t));
+      }
+      if (recv_displs[p-1] + recv_counts[p-1] > recv_cap) {
+         recv_cap = 2*(recv_displs[p-1] + recv_counts[p-1]);
+         recv_buf = realloc(recv_buf, recv_cap*sizeof(req_t));
+      }
+   }
+   pthread_barrier_wait(&barrier);
+
+   for (d = 0; d < slots; d++) {
+      memcpy(send_buf + td->out_offset[d], td->out[d].list,
+            td->out[d].count*sizeof(req_t));
+      td->out[d].count = 0;
+   }
+   pthread_barrier_wait(&barrier);
+
+   if (my_thread == 0)
+      MPI_Alltoallv(send_buf, send_counts, send_displs, MPI_2INT,
+            recv_buf, recv_counts, recv_displs, MPI_2INT, comm);
+   pthread_barrier_wait(&barrier);
+
+   for (q = 0; q < p; q++) {
+      first = recv_displs[q];
+      for (t = 0; t < my_thread; t++)
+         first += recv_slot_counts[q*thread_count + t];
+      for (i = 0; i < recv_slot_counts[q*thread_count + my_thread]; i++)
+         Relax(my_thread, recv_buf[first + i].vertex,
+               recv_buf[first + i].cost);
+   }
+}  /* Exchange */
+
+/*-------------------------------------------------------------------
+ * Function:    Pth_sssp
+ * Purpose:     Thread function:  run delta-stepping from source
+ * In arg:      thread:  the thread's rank in the team
+ * In/out globals:  everything used by the functions above
+ * Out global:  elapsed (thread 0 of process 0)
+ */
+void* Pth_sssp(void* thread) {
+   long my_thread = (long) thread;
+   thread_data_t* td = &threads[my_thread];
+   int b, t, i;
+   double start = 0.0, my_elapsed;
+
+   if (my_thread == 0) {
+      MPI_Barrier(comm);
+      start = MPI_Wtime();
+   }
+   if (Slot(source) == my_rank*thread_count + my_thread)
+      Relax(my_thread, source, 0);
+
+   while (1) {
+      td->min_bucket = Min_bucket(my_thread, cur_bucket);
+      pthread_barrier_wait(&barrier);
+      if (my_thread == 0) {
+         b = INT_MAX;
+         for (t = 0; t < thread_count; t++)
+            if (threads[t].min_bucket < b) b = threads[t].min_bucket;
+         MPI_Allreduce(MPI_IN_PLACE, &b, 1, MPI_INT, MPI_MIN, comm);
+         cur_bucket = b;
+      }
+      pthread_barrier_wait(&barrier);
+      b = cur_bucket;
+      if (b == INT_MAX) break;
+
+      /* Light phase */
+      do {
+         Take_bucket(my_thread, b);
+         for (i = 0; i < td->frontier.count; i++)
+            Relax_edges(my_thread, td->frontier.list[i], 1);
+         Exchange(my_thread);
+         td->more = (Min_bucket(my_thread, b) == b);
+         pthread_barrier_wait(&barrier);
+         if (my_thread == 0) {
+            more = 0;
+            for (t = 0; t < thread_count; t++)
+               more = more || threads[t].more;
+            MPI_Allreduce(MPI_IN_PLACE, &more, 1, MPI_INT, MPI_MAX, comm);
+         }
+         pthread_barrier_wait(&barrier);
+      } while (more);
+
+      /* Heavy phase */
+      for (i = 0; i < td->settled.count; i++) {
+         Relax_edges(my_thread, td->settled.list[i], 0);
+         is_settled[td->settled.list[i]] = 0;
+      }
+      td->settled.count = 0;
+      Exchange(my_thread);
+   }
+
+   if (my_thread == 0) {
+      my_elapsed = MPI_Wtime() - start;
+      MPI_Reduce(&my_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+   }
+   return NULL;
+}  /* Pth_sssp */
+
+/*-------------------------------------------------------------------
+ * Function:    Print_dist
+ * Purpose:     Gather the costs onto process 0 and print them in the
+ *              format of a row of the output of floyd.c
+ * In globals:  dist, n, local_n, source, my_rank, comm
+ */
+void Print_dist(void) {
+   int* all = NULL;
+   int v;
+
+   if (my_rank == 0) all = malloc(n*sizeof(int));
+   MPI_Gather(dist, local_n, MPI_INT, all, local_n, MPI_INT, 0, comm);
+   if (my_rank == 0) {
+      printf("The costs of the shortest paths from vertex %d are:\n",
+            source);
+      for (v = 0; v < n; v++)
+         if (all[v] == INT_MAX)
+            printf("i ");
+         else
+            printf("%d ", all[v]);
+      printf("\n");
+      free(all);
+   }
+}  /* Print_dist */
@@ -0,0 +1,250 @@
+/* File:     mpi_transpose.c
+ *
+ * Purpose:  Transpose an m x n matrix of doubles that's distributed
+ *           by block rows among p processes, so that the n x m result
+ *           is also distributed by block rows, and report the
+ *           bandwidth.
+ *
+ *           The local block of rows on process r is split into p tiles
+ *           of local_m x local_n:  tile q holds the columns owned by
+ *           process q in the transpose.  Each process transposes its
+ *           whole block into a send buffer with one call to the
+ *           threaded cache-oblivious transpose in transpose.c:  the
+ *           transposed tiles are stored contiguously, in order.  Then
+ *           a single MPI_Alltoall sends tile q to process q.  A derived
+ *           datatype describes where a received tile goes in the local
+ *           block of the transpose, so the tiles are received in place
+ *           without unpacking.
+ *
+ * Compile:  mpicc -g -Wall -O3 -march=native -o mpi_transpose
+ *              mpi_transpose.c transpose.c -lpthread
+ * Run:      mpiexec -n <p> ./mpi_transpose <m> <n> [thread_count]
+ *              A is m x n.  p should evenly divide m and n.
+ *              thread_count:  the number of threads each process uses
+ *                 for the local transposes (default 1)
+ *
+ * Input:    None.  Entry (i, j) of A is i*n + j.
+ * Output:   The best time over REPS transposes and the bandwidth, the
+ *           time for an MPI_Alltoall of the same amount of data, and
+ *           whether the transpose is correct.
+ *
+ * Notes:
+ * 1.  The bandwidth counts reading A and writing its transpose once:
+ *     2*m*n*sizeof(double) bytes.
+ * 2.  The time for the MPI_Alltoall alone is a lower bound on the time
+ *     for the transpose:  the difference is the cost of the local
+ *     transposes and of receiving into the strided datatype.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "transpose.h"
+
+#define REPS 10
+
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], int* m_p, int* n_p,
+      int* thread_count_p, int my_rank, int p, MPI_Comm comm);
+void Gen_block(double local_A[], int local_m, int n, int my_rank);
+MPI_Datatype Tile_type(int local_m, int local_n, int m);
+void Mpi_transpose(double local_A[], double local_B[], double send_buf[],
+      int m, int n, int thread_count, MPI_Datatype tile_t,
+      MPI_Comm comm);
+int  Check(double local_B[], int m, int n, int local_n, int my_rank);
+double Max_time(double elapsed, MPI_Comm comm);
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int p, my_rank, m, n, thread_count, local_m, local_n, rep, ok;
+   double *local_A, *local_B, *send_buf;
+   double start, elapsed, best, a2a_best;
+   MPI_Datatype tile_t;
+   MPI_Comm comm;
+
+   MPI_Init(&argc, &argv);
+   comm = MPI_COMM_WORLD;
+   MPI_Comm_size(comm, &p);
+   MPI_Comm_rank(comm, &my_rank);
+   Get_args(argc, argv, &m, &n, &thread_count, my_rank, p, comm);
+   local_m = m/p;
+   local_n = n/p;
+
+   local_A = malloc(((size_t) local_m)*n*sizeof(double));
+   local_B = malloc(((size_t) local_n)*m*sizeof(double));
+   send_buf = malloc(((size_t) local_m)*n*sizeof(double));
+   Gen_block(local_A, local_m, n, my_rank);
+   tile_t = Tile_type(local_m, local_n, m);
+
+   best = a2a_best = 1.0e30;
+   for (rep = 0; rep < REPS; rep++) {
+      MPI_Barrier(comm);
+      start = MPI_Wtime();
+      Mpi_transpose(local_A, local_B, send_buf, m, n, thread_count,
+            tile_t, comm);
+      elapsed = Max_time(MPI_Wtime() - start, comm);
+      if (elapsed < best) best = elapsed;
+   }
+   ok = Check(local_B, m, n, local_n, my_rank);
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+
+   /* local_A isn't needed any more, so it's the receive buffer */
+   for (rep = 0; rep < REPS; rep++) {
+      MPI_Barrier(comm);
+      start = MPI_Wtime();
+      MPI_Alltoall(send_buf, local_m*local_n, MPI_DOUBLE,
+            local_A, local_m*local_n, MPI_DOUBLE, comm);
+      elapsed = Max_time(MPI_Wtime() - start, comm);
+      if (elapsed < a2a_best) a2a_best = elapsed;
+   }
+
+   if (my_rank == 0) {
+      printf("Transpose:      %e seconds, %.2f GB/s\n", best,
+            2.0*m*n*sizeof(double)/best/1.0e9);
+      printf("Alltoall alone: %e seconds\n", a2a_best);
+      printf("The transpose is %s\n", ok ? "correct" : "NOT correct");
+   }
+
+   MPI_Type_free(&tile_t);
+   free(local_A);
+   free(local_B);
+   free(send_buf);
+   MPI_Finalize();
+   return 0;
+}  /* main */
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage:  mpiexec -n <p> %s <m> <n> [thread_count]\n",
+         prog_name);
+   fprintf(stderr, "   A is m x n.  p should evenly divide m and n\n");
+   fprintf(stderr, "   thread_count:  threads for the local transposes\n");
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:  Get_args
+ * Purpose:   Get and check the command line arguments
+ * In args:   argc, argv, my_rank, p, comm
+ * Out args:  m_p, n_p, thread_count_p
+ */
+void Get_args(int argc, char* argv[], int* m_p, int* n_p,
+      int* thread_count_p, int my_rank, int p, MPI_Comm comm) {
+   if (argc != 3 && argc != 4) {
+      if (my_rank == 0) Usage(argv[0]);
+      MPI_Finalize();
+      exit(0);
+   }
+   *m_p = strtol(argv[1], NULL, 10);
+   *n_p = strtol(argv[2], NULL, 10);
+   *thread_count_p = (argc == 4) ? strtol(argv[3], NULL, 10) : 1;
+   if (*m_p <= 0 || *n_p <= 0 || *m_p % p != 0 || *n_p % p != 0 ||
+         *thread_count_p <= 0) {
+      if (my_rank == 0) Usage(argv[0]);
+      MPI_Finalize();
+      exit(0);
+   }
+}  /* Get_args */
+
+/*-------------------------------------------------------------------
+ * Function:  Gen_block
+ * Purpose:   Set entry (i, j) of this process' block of rows of A to
+ *            i*n + j, where i is the global row
+ * In args:   local_m, n, my_rank
+ * Out arg:   local_A
+ */
+void Gen_block(double local_A[], int local_m, int n, int my_rank) {
+   int local_i, j;
+   size_t i;
+
+   for (local_i = 0; local_i < local_m; local_i++) {
+      i = ((size_t) my_rank)*local_m + local_i;
+      for (j = 0; j < n; j++)
+         local_A[((size_t) local_i)*n + j] = i*n + j;
+   }
+}  /* Gen_block */
+
+/*-------------------------------------------------------------------
+ * Function:  Tile_type
+ * Purpose:   Build the datatype of a received tile:  local_n rows of
+ *            local_m doubles with stride m, the local_n x local_m
+ *            block of the transpose received from one process.  The
+ *            extent is resized to local_m doubles, so the tile from
+ *            process q starts in column q*local_m.
+ * In args:   local_m, local_n, m
+ * Ret val:   The committed datatype
+ */
+MPI_Datatype Tile_type(int local_m, int local_n, int m) {
+   MPI_Datatype vect_t, tile_t;
+
+   MPI_Type_vector(local_n, local_m, m, MPI_DOUBLE, &vect_t);
+   MPI_Type_create_resized(vect_t, 0, local_m*sizeof(double), &tile_t);
+   MPI_Type_commit(&tile_t);
+   MPI_Type_free(&vect_t);
+   return tile_t;
+}  /* Tile_type */
+
+/*-------------------------------------------------------------------
+ * Function:  Mpi_transpose
+ * Purpose:   Transpose the m x n matrix A distributed by block rows
+ *            into the n x m matrix B distributed by block rows
+ * In args:   local_A:  this process' local_m x n block of rows of A
+ *            m, n, thread_count
+ *            tile_t:  the datatype built by Tile_type
+ *            comm
+ * Out arg:   local_B:  this process' local_n x m block of rows of B
+ * Scratch:   send_buf:  storage for local_m*n doubles
+ */
+void Mpi_transpose(double local_A[], double local_B[], double send_buf[],
+      int m, int n, int thread_count, MPI_Datatype tile_t,
+      MPI_Comm comm) {
+   int p, local_m, local_n;
+   size_t tile_size;
+
+   MPI_Comm_size(comm, &p);
+   local_m = m/p;
+   local_n = n/p;
+   tile_size = ((size_t) local_m)*local_n;
+
+   /* Tile q of A, transposed, is rows q*local_n, ..., (q+1)*local_n - 1
+    * of the n x local_m transpose of local_A.  So a single threaded
+    * transpose stores the tiles contiguously in send_buf */
+   Pth_transpose_double(local_m, n, local_A, n, send_buf, local_m,
+         thread_count);
+
+   MPI_Alltoall(send_buf, tile_size, MPI_DOUBLE, local_B, 1, tile_t,
+         comm);
+}  /* Mpi_transpose */
+
+/*-------------------------------------------------------------------
+ * Function:  Check
+ * Purpose:   Check that entry (j, i) of B is i*n + j
+ * In args:   local_B, m, n, local_n, my_rank
+ * Ret val:   1 if this process' block of B is correct, 0 otherwise
+ */
+int Check(double local_B[], int m, int n, int local_n, int my_rank) {
+   int local_j, i;
+   size_t j;
+
+   for (local_j = 0; local_j < local_n; local_j++) {
+      j = ((size_t) my_rank)*local_n + local_j;
+      for (i = 0; i < m; i++)
+         if (local_B[((size_t) local_j)*m + i] != ((size_t) i)*n + j)
+            return 0;
+   }
+   return 1;
+}  /* Check */
+
+/*-------------------------------------------------------------------
+ * Function:  Max_time
+ * Purpose:   Return the maximum of the elapsed times on the processes
+ */
+double Max_time(double elapsed, MPI_Comm comm) {
+   double max_elapsed;
+
+   MPI_Allreduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, comm);
+   return max_elapsed;
+}  /* Max_time */
@@ -0,0 +1,313 @@
+/* File:     mpi_triplets.c
+ *
+ * Purpose:  Implement the MPI datatype for element_t and the
+ *           redistribution of triplets declared in mpi_triplets.h
+ *
+ * Compile:  Link with a program that uses mpi_triplets.h, and with
+ *           triplets.c.  Needs -lpthread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include "mpi_triplets.h"
+
+static int  Count_by_owner(const int rows[], long count, int m, int p,
+      int send_counts[]);
+static int* Index_by_owner(const int rows[], long count, int m, int p,
+      const int send_counts[], int* first);
+static long Exchange_counts(const int send_counts[], int recv_counts[],
+      int rdispls[], int p, MPI_Comm comm);
+
+/*-------------------------------------------------------------------
+ * Function:   Element_type
+ * Purpose:    Build and commit an MPI datatype that matches element_t
+ * Ret val:    The datatype.  Free it with MPI_Type_free.
+ * Note:       The displacements of the members are found with
+ *             MPI_Get_address, so any padding between the members is
+ *             skipped.  The extent is then resized to sizeof(element_t)
+ *             so that the padding at the end of the struct is skipped
+ *             too, and consecutive elements of an array line up.
+ */
+MPI_Datatype Element_type(void) {
+   element_t elt = {0.0, 0, 0};
+   int          blocklens[3] = {1, 1, 1};
+   MPI_Datatype types[3] = {MPI_DOUBLE, MPI_INT, MPI_INT};
+   MPI_Aint     displs[3], base;
+   MPI_Datatype tmp_type, elt_type;
+   int i;
+
+   MPI_Get_address(&elt, &base);
+   MPI_Get_address(&elt.value, &displs[0]);
+   MPI_Get_address(&elt.row, &displs[1]);
+   MPI_Get_address(&elt.col, &displs[2]);
+   for (i = 0; i < 3; i++)
+      displs[i] -= base;
+
+   MPI_Type_create_struct(3, blocklens, displs, types, &tmp_type);
+   MPI_Type_create_resized(tmp_type, 0, sizeof(element_t), &elt_type);
+   MPI_Type_commit(&elt_type);
+   MPI_Type_free(&tmp_type);
+
+   return elt_type;
+}  /* Element_type */
+
+/*-------------------------------------------------------------------
+ * Function:   Row_owner
+ * Purpose:    Return the rank of the process that owns row:  the
+ *             first m % p processes own m/p + 1 rows, the others own
+ *             m/p rows
+ */
+int Row_owner(int row, int m, int p) {
+   int quotient = m/p, remainder = m % p;
+   int split = remainder*(quotient + 1);
+
+   if (row < split)
+      return row/(quotient + 1);
+   else
+      return remainder + (row - split)/quotient;
+}  /* Row_owner */
+
+/*-------------------------------------------------------------------
+ * Function:   Count_by_owner
+ * Purpose:    Count the triplets going to each process
+ * Out arg:    send_counts
+ * Ret val:    1 if the triplets are grouped by owner in increasing
+ *             order of rank, 0 otherwise
+ */
+static int Count_by_owner(const int rows[], long count, int m, int p,
+      int send_counts[]) {
+   long i;
+   int q, owner, prev = 0, grouped = 1;
+
+   for (q = 0; q < p; q++)
+      send_counts[q] = 0;
+   for (i = 0; i < count; i++) {
+      owner = Row_owner(rows[i], m, p);
+      send_counts[owner]++;
+      if (owner < prev) grouped = 0;
+      prev = owner;
+   }
+   return grouped;
+}  /* Count_by_owner */
+
+/*-------------------------------------------------------------------
+ * Function:   Index_by_owner
+ * Purpose:    List the subscripts of the triplets going to each
+ *             process:  the subscripts of the triplets going to q are
+ *             in idx[first[q]], . . ., idx[first[q] + send_counts[q]-1]
+ * Out arg:    first
+ * Ret val:    idx.  The caller should free it.
+ */
+static int* Index_by_owner(const int rows[], long count, int m, int p,
+      const int send_counts[], int* first) {
+   int* idx = malloc((count + 1)*sizeof(int));
+   int* next = malloc(p*sizeof(int));
+   long i;
+   int q;
+
+   first[0] = 0;
+   for (q = 1; q < p; q++)
+      first[q] = first[q-1] + send_counts[q-1];
+   for (q = 0; q < p; q++)
+      next[q] = first[q];
+   for (i = 0; i < count; i++)
+      idx[next[Row_owner(rows[i], m, p)]++] = i;
+
+   free(next);
+   return idx;
+}  /* Index_by_owner */
+
+/*-------------------------------------------------------------------
+ * Function:   Exchange_counts
+ * Purpose:    Tell each process how many triplets it will receive from
+ *             each process, and find where they'll be stored
+ * Out args:   recv_counts, rdispls
+ * Ret val:    The total number of triplets received
+ */
+static long Exchange_counts(const int send_counts[], int recv_counts[],
+      int rdispls[], int p, MPI_Comm comm) {
+   long total = 0;
+   int q;
+
+   MPI_Alltoall((void*) send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+         comm);
+   for (q = 0; q < p; q++) {
+      rdispls[q] = total;
+      total += recv_counts[q];
+   }
+   return total;
+}  /* Exchange_counts */
+
+/*-------------------------------------------------------------------
+ * Function:   Redistribute_aos
+ * Purpose:    Send each element in elts to the process that owns its
+ *             row
+ * In args:    elts, count, m, comm
+ * Out args:   recv_p:  the elements received by this process.  The
+ *                caller should free it.
+ *             recv_count_p:  the number of elements received
+ */
+void Redistribute_aos(element_t elts[], long count, int m,
+      element_t** recv_p, long* recv_count_p, MPI_Comm comm) {
+   MPI_Datatype elt_type = Element_type();
+   MPI_Datatype *send_types, *recv_types;
+   int *send_counts, *recv_counts, *sdispls, *rdispls, *ones, *zeros;
+   int *rows, *idx, p, q, grouped;
+   long i, total;
+
+   MPI_Comm_size(comm, &p);
+   send_counts = malloc(p*sizeof(int));
+   recv_counts = malloc(p*sizeof(int));
+   sdispls = malloc(p*sizeof(int));
+   rdispls = malloc(p*sizeof(int));
+
+   rows = malloc((count + 1)*sizeof(int));
+   for (i = 0; i < count; i++)
+      rows[i] = elts[i].row;
+   grouped = Count_by_owner(rows, count, m, p, send_counts);
+   MPI_Allreduce(MPI_IN_PLACE, &grouped, 1, MPI_INT, MPI_MIN, comm);
+   total = Exchange_counts(send_counts, recv_counts, rdispls, p, comm);
+   *recv_p = malloc((total + 1)*sizeof(element_t));
+   *recv_count_p = total;
+
+   if (grouped) {
+      sdispls[0] = 0;
+      for (q = 1; q < p; q++)
+         sdispls[q] = sdispls[q-1] + send_counts[q-1];
+      MPI_Alltoallv(elts, send_counts, sdispls, elt_type,
+            *recv_p, recv_counts, rdispls, elt_type, comm);
+   } else {
+      /* Send one indexed type to each process */
+      idx = Index_by_owner(rows, count, m, p, send_counts, sdispls);
+      send_types = malloc(p*sizeof(MPI_Datatype));
+      recv_types = malloc(p*sizeof(MPI_Datatype));
+      ones = malloc(p*sizeof(int));
+      zeros = malloc(p*sizeof(int));
+      for (q = 0; q < p; q++) {
+         MPI_Type_create_indexed_block(send_counts[q], 1, idx + sdispls[q],
+               elt_type, &send_types[q]);
+         MPI_Type_commit(&send_types[q]);
+         recv_types[q] = elt_type;
+         ones[q] = 1;
+         zeros[q] = 0;
+         rdispls[q] *= sizeof(element_t);  /* Bytes */
+      }
+      MPI_Alltoallw(elts, ones, zeros, send_types,
+            *recv_p, recv_counts, rdispls, recv_types, comm);
+      for (q = 0; q < p; q++)
+         MPI_Type_free(&send_types[q]);
+      free(send_types);
+      free(recv_types);
+      free(ones);
+      free(zeros);
+      free(idx);
+   }
+
+   MPI_Type_free(&elt_type);
+   free(rows);
+   free(send_counts);
+   free(recv_counts);
+   free(sdispls);
+   free(rdispls);
+}  /* Redistribute_aos */
+
+/*-------------------------------------------------------------------
+ * Function:   Redistribute_soa
+ * Purpose:    Send each triplet in trip to the process that owns its
+ *             row
+ * In args:    trip, m, comm
+ * Out arg:    recv:  the triplets received by this process.  It's
+ *                initialized by this function.  Free it with
+ *                Trip_free.
+ * Note:       In the ungrouped case, each send type is a struct of
+ *             three indexed types, one for each of the arrays in trip,
+ *             with absolute addresses, and each receive type is a
+ *             struct of three contiguous blocks in the arrays of recv.
+ *             So a single MPI_Alltoallw (from and to MPI_BOTTOM) moves
+ *             all three arrays.
+ */
+void Redistribute_soa(triplets_t* trip, int m, triplets_t* recv,
+      MPI_Comm comm) {
+   MPI_Datatype *send_types, *recv_types, member_types[3];
+   MPI_Datatype base_types[3] = {MPI_INT, MPI_INT, MPI_DOUBLE};
+   MPI_Aint addrs[3];
+   int *send_counts, *recv_counts, *sdispls, *rdispls, *ones, *zeros;
+   int *idx, blocklens[3], p, q, grouped, j;
+   long total;
+
+   MPI_Comm_size(comm, &p);
+   send_counts = malloc(p*sizeof(int));
+   recv_counts = malloc(p*sizeof(int));
+   sdispls = malloc(p*sizeof(int));
+   rdispls = malloc(p*sizeof(int));
+
+   grouped = Count_by_owner(trip->rows, trip->count, m, p, send_counts);
+   MPI_Allreduce(MPI_IN_PLACE, &grouped, 1, MPI_INT, MPI_MIN, comm);
+   total = Exchange_counts(send_counts, recv_counts, rdispls, p, comm);
+   Trip_init(recv, total);
+   recv->count = total;
+
+   if (grouped) {
+      sdispls[0] = 0;
+      for (q = 1; q < p; q++)
+         sdispls[q] = sdispls[q-1] + send_counts[q-1];
+      MPI_Alltoallv(trip->rows, send_counts, sdispls, MPI_INT,
+            recv->rows, recv_counts, rdispls, MPI_INT, comm);
+      MPI_Alltoallv(trip->cols, send_counts, sdispls, MPI_INT,
+            recv->cols, recv_counts, rdispls, MPI_INT, comm);
+      MPI_Alltoallv(trip->values, send_counts, sdispls, MPI_DOUBLE,
+            recv->values, recv_counts, rdispls, MPI_DOUBLE, comm);
+   } else {
+      idx = Index_by_owner(trip->rows, trip->count, m, p, send_counts,
+            sdispls);
+      send_types = malloc(p*sizeof(MPI_Datatype));
+      recv_types = malloc(p*sizeof(MPI_Datatype));
+      ones = malloc(p*sizeof(int));
+      zeros = malloc(p*sizeof(int));
+      for (q = 0; q < p; q++) {
+         /* The triplets going to q */
+         for (j = 0; j < 3; j++) {
+            MPI_Type_create_indexed_block(send_counts[q], 1,
+                  idx + sdispls[q], base_types[j], &member_types[j]);
+            blocklens[j] = 1;
+         }
+         MPI_Get_address(trip->rows, &addrs[0]);
+         MPI_Get_address(trip->cols, &addrs[1]);
+         MPI_Get_address(trip->values, &addrs[2]);
+         MPI_Type_create_struct(3, blocklens, addrs, member_types,
+               &send_types[q]);
+         MPI_Type_commit(&send_types[q]);
+         for (j = 0; j < 3; j++)
+            MPI_Type_free(&member_types[j]);
+
+         /* The triplets coming from q */
+         for (j = 0; j < 3; j++)
+            blocklens[j] = recv_counts[q];
+         MPI_Get_address(recv->rows + rdispls[q], &addrs[0]);
+         MPI_Get_address(recv->cols + rdispls[q], &addrs[1]);
+         MPI_Get_address(recv->values + rdispls[q], &addrs[2]);
+         MPI_Type_create_struct(3, blocklens, addrs, base_types,
+               &recv_types[q]);
+         MPI_Type_commit(&recv_types[q]);
+
+         ones[q] = 1;
+         zeros[q] = 0;
+      }
+      MPI_Alltoallw(MPI_BOTTOM, ones, zeros, send_types,
+            MPI_BOTTOM, ones, zeros, recv_types, comm);
+      for (q = 0; q < p; q++) {
+         MPI_Type_free(&send_types[q]);
+         MPI_Type_free(&recv_types[q]);
+      }
+      free(send_types);
+      free(recv_types);
+      free(ones);
+      free(zeros);
+      free(idx);
+   }
+
+   free(send_counts);
+   free(recv_counts);
+   free(sdispls);
+   free(rdispls);
+}  /* Redistribute_soa */
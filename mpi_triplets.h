@@ -0,0 +1,43 @@
+/* File:     mpi_triplets.h
+ *
+ * Purpose:  Send element_t's and triplets_t's (see triplets.h) with MPI
+ *           without copying them into a send buffer first.
+ *
+ *           Element_type builds an MPI derived datatype that matches
+ *           the layout of an element_t, including the padding, so an
+ *           array of element_t's can be sent or received directly.
+ *
+ *           Redistribute_aos and Redistribute_soa send each triplet of
+ *           a distributed sparse matrix to the process that owns its
+ *           row:  the rows are distributed by blocks.  If the triplets
+ *           on a process are already grouped by owner, they're sent
+ *           with MPI_Alltoallv.  Otherwise each process builds, for each
+ *           destination, an indexed datatype that picks out the
+ *           triplets that go there, and they're sent with
+ *           MPI_Alltoallw.  Either way, the triplets go straight from
+ *           the caller's arrays to MPI.
+ *
+ * Compile:  Link with mpi_triplets.c and triplets.c.  Needs -lpthread.
+ *
+ * Notes:
+ * 1.  The received triplets are stored in the order of the sending
+ *     processes, and in the order they were stored on each sender.
+ * 2.  The receive displacements of MPI_Alltoallw are ints counting
+ *     bytes, so in the ungrouped case Redistribute_aos can't receive
+ *     more than 2GB of elements on a process.  Redistribute_soa uses
+ *     absolute addresses, so it doesn't have this limit.
+ */
+#ifndef _MPI_TRIPLETS_H_
+#define _MPI_TRIPLETS_H_
+
+#include <mpi.h>
+#include "triplets.h"
+
+MPI_Datatype Element_type(void);
+int  Row_owner(int row, int m, int p);
+void Redistribute_aos(element_t elts[], long count, int m,
+      element_t** recv_p, long* recv_count_p, MPI_Comm comm);
+void Redistribute_soa(triplets_t* trip, int m, triplets_t* recv,
+      MPI_Comm comm);
+
+#endif
@@ -0,0 +1,223 @@
+/* File:     par_output.c
+ *
+ * Purpose:  Implement the output buffers and ordered writers declared
+ *           in par_output.h
+ *
+ * Compile:  Link with a program that uses par_output.h.  Compile with
+ *           mpicc, or with gcc and -DNO_MPI for a serial program.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "par_output.h"
+
+/* MPI_File_write_at_all takes an int count, so long buffers are written
+ * in pieces of at most this many chars */
+#define OUT_MAX_WRITE (1 << 30)
+
+/* "00" "01" . . . "99":  the two digit strings */
+static const char digit_pairs[201] =
+   "00010203040506070809"
+   "10111213141516171819"
+   "20212223242526272829"
+   "30313233343536373839"
+   "40414243444546474849"
+   "50515253545556575859"
+   "60616263646566676869"
+   "70717273747576777879"
+   "80818283848586878889"
+   "90919293949596979899";
+
+/*-------------------------------------------------------------------
+ * Function:   Out_init
+ * Purpose:    Initialize an empty buffer
+ */
+void Out_init(out_buf_t* out) {
+   out->text = NULL;
+   out->len = out->max = 0;
+}  /* Out_init */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_free
+ * Purpose:    Free the storage used by a buffer and make it empty
+ */
+void Out_free(out_buf_t* out) {
+   free(out->text);
+   Out_init(out);
+}  /* Out_free */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_clear
+ * Purpose:    Make a buffer empty, but keep its storage
+ */
+void Out_clear(out_buf_t* out) {
+   out->len = 0;
+}  /* Out_clear */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_reserve
+ * Purpose:    Make sure there's room for extra more chars in a buffer
+ * Note:       The storage at least doubles each time it grows, so
+ *             appending n chars takes O(n) time.
+ */
+void Out_reserve(out_buf_t* out, long extra) {
+   long new_max;
+
+   if (out->len + extra <= out->max) return;
+   new_max = (out->max == 0) ? 256 : 2*out->max;
+   while (new_max < out->len + extra)
+      new_max *= 2;
+   out->text = realloc(out->text, new_max);
+   if (out->text == NULL) {
+      fprintf(stderr, "Out_reserve:  can't allocate %ld chars\n", new_max);
+      exit(-1);
+   }
+   out->max = new_max;
+}  /* Out_reserve */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_char
+ * Purpose:    Append a char to a buffer
+ */
+void Out_char(out_buf_t* out, char c) {
+   Out_reserve(out, 1);
+   out->text[out->len++] = c;
+}  /* Out_char */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_str
+ * Purpose:    Append a string (without its '\0') to a buffer
+ */
+void Out_str(out_buf_t* out, const char* s) {
+   long s_len = strlen(s);
+
+   Out_reserve(out, s_len);
+   memcpy(out->text + out->len, s, s_len);
+   out->len += s_len;
+}  /* Out_str */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_int
+ * Purpose:    Append the decimal representation of x to a buffer
+ * Note:       The digits are generated from the right, two at a time,
+ *             into a local array, and then copied into the buffer.
+ */
+void Out_int(out_buf_t* out, long x) {
+   char digits[24];
+   char* d_p = digits + sizeof(digits);
+   unsigned long u = (x < 0) ? -(unsigned long) x : (unsigned long) x;
+   int pair, count;
+
+   while (u >= 100) {
+      pair = 2*(u % 100);
+      u /= 100;
+      *--d_p = digit_pairs[pair + 1];
+      *--d_p = digit_pairs[pair];
+   }
+   if (u >= 10) {
+      pair = 2*u;
+      *--d_p = digit_pairs[pair + 1];
+      *--d_p = digit_pairs[pair];
+   } else {
+      *--d_p = '0' + u;
+   }
+   if (x < 0) *--d_p = '-';
+
+   count = digits + sizeof(digits) - d_p;
+   Out_reserve(out, count);
+   memcpy(out->text + out->len, d_p, count);
+   out->len += count;
+}  /* Out_int */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_print
+ * Purpose:    Write the contents of a buffer to fp and make the
+ *             buffer empty
+ */
+void Out_print(out_buf_t* out, FILE* fp) {
+   fwrite(out->text, 1, out->len, fp);
+   Out_clear(out);
+}  /* Out_print */
+
+#ifndef NO_MPI
+/*-------------------------------------------------------------------
+ * Function:   Out_write_ordered
+ * Purpose:    Write the buffers of all the processes in comm to the
+ *             file file_name:  the text of process 0, followed by the
+ *             text of process 1, etc.  The file is replaced.
+ * Ret val:    MPI_SUCCESS, or the error code returned by MPI_File_open
+ * Note:       Collective:  all the processes in comm must call it, even
+ *             if their buffers are empty.
+ */
+int Out_write_ordered(out_buf_t* out, const char* file_name,
+      MPI_Comm comm) {
+   long long my_len = out->len, offset = 0, total, done;
+   long my_pieces, max_pieces, piece;
+   int my_rank, count, rv;
+   MPI_File fh;
+
+   MPI_Comm_rank(comm, &my_rank);
+   MPI_Exscan(&my_len, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (my_rank == 0) offset = 0;  /* Exscan doesn't set it on 0 */
+   MPI_Allreduce(&my_len, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+
+   /* Everyone must make the same number of calls to write_at_all */
+   my_pieces = (my_len + OUT_MAX_WRITE - 1)/OUT_MAX_WRITE;
+   MPI_Allreduce(&my_pieces, &max_pieces, 1, MPI_LONG, MPI_MAX, comm);
+
+   rv = MPI_File_open(comm, (char*) file_name,
+         MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+   if (rv != MPI_SUCCESS) return rv;
+   MPI_File_set_size(fh, total);
+
+   done = 0;
+   for (piece = 0; piece < max_pieces; piece++) {
+      count = (my_len - done < OUT_MAX_WRITE) ? my_len - done :
+         OUT_MAX_WRITE;
+      MPI_File_write_at_all(fh, offset + done, out->text + done, count,
+            MPI_CHAR, MPI_STATUS_IGNORE);
+      done += count;
+   }
+   MPI_File_close(&fh);
+
+   return MPI_SUCCESS;
+}  /* Out_write_ordered */
+
+/*-------------------------------------------------------------------
+ * Function:   Out_print_ordered
+ * Purpose:    Gather the buffers of all the processes in comm onto
+ *             process 0, and have process 0 write them to fp in rank
+ *             order.  The buffers are made empty.
+ * Note:       Collective.  Use Out_write_ordered for output that is
+ *             too large for process 0's memory.
+ */
+void Out_print_ordered(out_buf_t* out, FILE* fp, MPI_Comm comm) {
+   int my_rank, p, q, my_len = out->len;
+   int *lens = NULL, *displs = NULL;
+   char* all_text = NULL;
+
+   MPI_Comm_rank(comm, &my_rank);
+   MPI_Comm_size(comm, &p);
+   if (my_rank == 0) {
+      lens = malloc(p*sizeof(int));
+      displs = malloc(p*sizeof(int));
+   }
+   MPI_Gather(&my_len, 1, MPI_INT, lens, 1, MPI_INT, 0, comm);
+   if (my_rank == 0) {
+      displs[0] = 0;
+      for (q = 1; q < p; q++)
+         displs[q] = displs[q-1] + lens[q-1];
+      all_text = malloc(displs[p-1] + lens[p-1] + 1);
+   }
+   MPI_Gatherv(out->text, my_len, MPI_CHAR, all_text, lens, displs,
+         MPI_CHAR, 0, comm);
+   if (my_rank == 0) {
+      fwrite(all_text, 1, displs[p-1] + lens[p-1], fp);
+      fflush(fp);
+      free(all_text);
+      free(lens);
+      free(displs);
+   }
+   Out_clear(out);
+}  /* Out_print_ordered */
+#endif
@@ -0,0 +1,66 @@
+/* File:     par_output.h
+ *
+ * Purpose:  Build output text in growable buffers and write the
+ *           buffers of all the processes in rank order.
+ *
+ *           Integers are converted to decimal without sprintf, two
+ *           digits at a time, and text is appended at the end of the
+ *           buffer without searching for it with strlen, so the cost
+ *           of building a line is linear in its length, and there's no
+ *           limit on the length.
+ *
+ *           Out_write_ordered writes the buffers of all the processes
+ *           in a communicator to a file:  each process finds the offset
+ *           of its text with MPI_Exscan, and all the processes write
+ *           their text at the same time with MPI_File_write_at_all.
+ *           Out_print_ordered gathers the buffers onto process 0 and
+ *           writes them to a stream, e.g., stdout.
+ *
+ * Compile:  Link with par_output.c.  A serial program that only uses
+ *           the buffer functions should compile both files with
+ *           -DNO_MPI.
+ *
+ * Example:
+ *    out_buf_t out;
+ *    . . .
+ *    Out_init(&out);
+ *    for (i = 0; i < local_n; i++) {
+ *       for (j = 0; j < n; j++) {
+ *          Out_int(&out, local_mat[i*n + j]);
+ *          Out_char(&out, ' ');
+ *       }
+ *       Out_char(&out, '\n');
+ *    }
+ *    Out_write_ordered(&out, "mat.txt", comm);
+ *    Out_free(&out);
+ */
+#ifndef _PAR_OUTPUT_H_
+#define _PAR_OUTPUT_H_
+
+#include <stdio.h>
+#ifndef NO_MPI
+#include <mpi.h>
+#endif
+
+typedef struct {
+   char* text;     /* Not null-terminated */
+   long  len;      /* Number of chars in text */
+   long  max;      /* Number of chars allocated */
+} out_buf_t;
+
+void Out_init(out_buf_t* out);
+void Out_free(out_buf_t* out);
+void Out_clear(out_buf_t* out);
+void Out_reserve(out_buf_t* out, long extra);
+void Out_char(out_buf_t* out, char c);
+void Out_str(out_buf_t* out, const char* s);
+void Out_int(out_buf_t* out, long x);
+void Out_print(out_buf_t* out, FILE* fp);
+
+#ifndef NO_MPI
+int  Out_write_ordered(out_buf_t* out, const char* file_name,
+      MPI_Comm comm);
+void Out_print_ordered(out_buf_t* out, FILE* fp, MPI_Comm comm);
+#endif
+
+#endif
@@ -7,26 +7,80 @@
  * Output:
  *    A:     elements of A after sorting
  *
- * Compile:  mpicc -g -Wall -o parallel_odd_even parallel_odd_even.c
+ * Compile:  mpicc -g -Wall -O3 -march=native -o parallel_odd_even
+ *              parallel_odd_even.c sort_net.c
  * Run:
- *    mpiexec -n <p> parallel_odd_even <g|i> <global_n> 
+ *    mpiexec -n <p> parallel_odd_even <g|i> <global_n> [sorts]
  *       - p: the number of processes
  *       - g: generate random, distributed list
  *       - i: user will input list on process 0
  *       - global_n: number of elements in global list
+ *       - sorts: number of times to sort a copy of the list
+ *         (default 1)
  *
  * Notes:
  * 1.  global_n must be evenly divisible by p
  * 2.  DEBUG flag prints original and final sublists
+ * 3.  PERF flag counts hardware events in Sort on each process (see
+ *     perf_counters.h), and prints the totals over all the processes
+ *     after the elapsed time.  Link with perf_counters.c.
+ * 4.  TRACE flag records a timeline of the local sort, and of the
+ *     communication and the merge-split in each phase, in
+ *     trace.<rank>.json (see trace.h).  Link with trace.c and
+ *     -lpthread.  The argument of a sendrecv or merge split is the
+ *     phase.
+ * 5.  The buffers used by Sort belong to a sort_ctx_t that's set up
+ *     once by Sort_init, so sorting the list more than once doesn't
+ *     allocate any memory.  A merge-split stores its result in a
+ *     spare buffer, and the spare buffer and the local list trade
+ *     places, so the result isn't copied.  The elapsed time is the
+ *     total over the sorts.
+ * 6.  PERSISTENT flag replaces the MPI_Sendrecv in each phase with
+ *     persistent requests.  Sort_init creates a receive request for
+ *     each partner and, since the local list alternates between two
+ *     buffers, a send request for each partner and buffer.  Each phase
+ *     then just starts and waits for one send and one receive.  This
+ *     can save the setup of the communication in every phase when
+ *     local_n is small and the list is sorted many times.  Whether it
+ *     does depends on the MPI implementation:  compare the time per
+ *     sort with and without the flag.  (With Open MPI 4.1 on a single
+ *     node, the persistent requests were slower for very short lists.)
+ * 7.  The local sort is Hybrid_sort (see sort_net.h):  a quicksort that
+ *     sorts short sublists with sorting networks in AVX2 registers
+ *     when the compiler targets AVX2.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <mpi.h>
+#include "trace.h"
+#include "sort_net.h"
+#ifdef PERF
+#include "perf_counters.h"
+#endif
 
 // const int RMAX = 1000000000;
 const int RMAX = 100;
 
+/* Storage and partners used by Sort.  After Sort_init, the caller
+ * stores its sublist in local_A.  Sort may change local_A to point
+ * to another of the buffers. */
+typedef struct {
+   int*     local_A;       /* The process' sublist                  */
+   int*     temp_B;        /* The sublist received from the partner */
+   int*     temp_C;        /* The result of a merge-split           */
+   int      local_n;
+   int      even_partner;  /* phase is even or left-looking */
+   int      odd_partner;   /* phase is odd or right-looking */
+   int      my_rank, p;
+   MPI_Comm comm;
+#  ifdef PERSISTENT
+   int*        bufs[2];         /* The buffers local_A alternates between */
+   MPI_Request send_req[2][2];  /* [phase % 2][buffer]                    */
+   MPI_Request recv_req[2];     /* [phase % 2]                            */
+#  endif
+} sort_ctx_t;
+
 /* Local functions */
 void Usage(char* program);
 void Print_list(int local_A[], int local_n, int rank);
@@ -35,16 +89,18 @@ void Merge_split_low(int local_A[], int temp_B[], int temp_C[],
 void Merge_split_high(int local_A[], int temp_B[], int temp_C[], 
         int local_n);
 void Generate_list(int local_A[], int local_n, int my_rank);
-int  Compare(const void* a_p, const void* b_p);
 
 /* Functions involving communication */
 void Get_args(int argc, char* argv[], int* global_n_p, int* local_n_p, 
-         char* gi_p, int my_rank, int p, MPI_Comm comm);
-void Sort(int local_A[], int local_n, int my_rank, 
-         int p, MPI_Comm comm);
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
-         int local_n, int phase, int even_partner, int odd_partner,
-         int my_rank, int p, MPI_Comm comm);
+         char* gi_p, int* sorts_p, int my_rank, int p, MPI_Comm comm);
+void Sort_init(sort_ctx_t* ctx, int local_n, int my_rank, int p,
+         MPI_Comm comm);
+void Sort_free(sort_ctx_t* ctx);
+#ifdef PERSISTENT
+void Init_requests(sort_ctx_t* ctx);
+#endif
+void Sort(sort_ctx_t* ctx);
+void Odd_even_iter(sort_ctx_t* ctx, int phase);
 void Print_local_lists(int local_A[], int local_n, 
          int my_rank, int p, MPI_Comm comm);
 void Print_global_list(int local_A[], int local_n, int my_rank,
@@ -60,15 +116,22 @@ int main(int argc, char* argv[]) {
    int *local_A;
    int global_n;
    int local_n;
+   int sorts, s;
+   sort_ctx_t ctx;
    MPI_Comm comm;
-   double start, finish;
+   double start, finish, elapsed;
+#  ifdef PERF
+   perf_counters_t counters, total;
+#  endif
 
    MPI_Init(&argc, &argv);
    comm = MPI_COMM_WORLD;
    MPI_Comm_size(comm, &p);
    MPI_Comm_rank(comm, &my_rank);
+   TRACE_PROCESS(my_rank);
 
-   Get_args(argc, argv, &global_n, &local_n, &g_i, my_rank, p, comm);
+   Get_args(argc, argv, &global_n, &local_n, &g_i, &sorts, my_rank, p,
+         comm);
    local_A = (int*) malloc(local_n*sizeof(int));
    if (g_i == 'g') {
       Generate_list(local_A, local_n, my_rank);
@@ -79,19 +142,49 @@ int main(int argc, char* argv[]) {
    Print_local_lists(local_A, local_n, my_rank, p, comm);
 #  endif
 
-   start = MPI_Wtime();
-   Sort(local_A, local_n, my_rank, p, comm);
-   finish = MPI_Wtime();
-   if (my_rank == 0)
-      printf("Elapsed time = %e seconds\n", finish-start);
+   Sort_init(&ctx, local_n, my_rank, p, comm);
+#  ifdef PERF
+   Perf_open(&counters);
+#  endif
+   elapsed = 0.0;
+   for (s = 0; s < sorts; s++) {
+      memcpy(ctx.local_A, local_A, local_n*sizeof(int));
+#     ifdef PERF
+      Perf_start(&counters);
+#     endif
+      start = MPI_Wtime();
+      Sort(&ctx);
+      finish = MPI_Wtime();
+#     ifdef PERF
+      Perf_stop(&counters);
+#     endif
+      elapsed += finish - start;
+   }
+#  ifdef PERF
+   Perf_close(&counters);
+   Perf_init(&total);
+   MPI_Reduce(counters.count, total.count, PERF_EVENT_COUNT, 
+         MPI_LONG_LONG, MPI_SUM, 0, comm);
+   MPI_Reduce(counters.available, total.available, PERF_EVENT_COUNT, 
+         MPI_INT, MPI_MIN, 0, comm);
+#  endif
+   if (my_rank == 0) {
+      printf("Elapsed time = %e seconds\n", elapsed);
+      if (sorts > 1)
+         printf("Time per sort = %e seconds\n", elapsed/sorts);
+   }
+#  ifdef PERF
+   if (my_rank == 0) Perf_print(stdout, &total);
+#  endif
 
 #  ifdef DEBUG
-   Print_local_lists(local_A, local_n, my_rank, p, comm);
+   Print_local_lists(ctx.local_A, local_n, my_rank, p, comm);
    fflush(stdout);
 #  endif
 
-   Print_global_list(local_A, local_n, my_rank, p, comm);
+   Print_global_list(ctx.local_A, local_n, my_rank, p, comm);
 
+   Sort_free(&ctx);
    free(local_A);
 
    MPI_Finalize();
@@ -123,13 +216,14 @@ void Generate_list(int local_A[], int local_n, int my_rank) {
  * Note:      Purely local, run only by process 0;
  */
 void Usage(char* program) {
-   fprintf(stderr, "usage:  mpirun -np <p> %s <g|i> <global_n>\n",
+   fprintf(stderr, "usage:  mpirun -np <p> %s <g|i> <global_n> [sorts]\n",
        program);
    fprintf(stderr, "   - p: the number of processes \n");
    fprintf(stderr, "   - g: generate random, distributed list\n");
    fprintf(stderr, "   - i: user will input list on process 0\n");
    fprintf(stderr, "   - global_n: number of elements in global list");
    fprintf(stderr, " (must be evenly divisible by p)\n");
+   fprintf(stderr, "   - sorts: number of times to sort the list\n");
    fflush(stderr);
 }  /* Usage */
 
@@ -138,13 +232,14 @@ void Usage(char* program) {
  * Function:    Get_args
  * Purpose:     Get and check command line arguments
  * Input args:  argc, argv, my_rank, p, comm
- * Output args: global_n_p, local_n_p, gi_p
+ * Output args: global_n_p, local_n_p, gi_p, sorts_p
  */
 void Get_args(int argc, char* argv[], int* global_n_p, int* local_n_p, 
-         char* gi_p, int my_rank, int p, MPI_Comm comm) {
+         char* gi_p, int* sorts_p, int my_rank, int p, MPI_Comm comm) {
 
    if (my_rank == 0) {
-      if (argc != 3) {
+      *sorts_p = (argc == 4) ? strtol(argv[3], NULL, 10) : 1;
+      if ((argc != 3 && argc != 4) || *sorts_p < 1) {
          Usage(argv[0]);
          *global_n_p = -1;  /* Bad args, quit */
       } else {
@@ -164,6 +259,7 @@ void Get_args(int argc, char* argv[], int* global_n_p, int* local_n_p,
 
    MPI_Bcast(gi_p, 1, MPI_CHAR, 0, comm);
    MPI_Bcast(global_n_p, 1, MPI_INT, 0, comm);
+   MPI_Bcast(sorts_p, 1, MPI_INT, 0, comm);
 
    if (*global_n_p <= 0) {
       MPI_Finalize();
@@ -233,107 +329,170 @@ void Print_global_list(int local_A[], int local_n, int my_rank, int p,
 }  /* Print_global_list */
 
 /*-------------------------------------------------------------------
- * Function:    Compare
- * Purpose:     Compare 2 ints, return -1, 0, or 1, respectively, when
- *              the first int is less than, equal, or greater than
- *              the second.  Used by qsort.
+ * Function:    Sort_init
+ * Purpose:     Allocate the buffers used by Sort and find the
+ *              partners
+ * In args:     local_n, my_rank, p, comm
+ * Out arg:     ctx
  */
-int Compare(const void* a_p, const void* b_p) {
-   int a = *((int*)a_p);
-   int b = *((int*)b_p);
-
-   if (a < b)
-      return -1;
-   else if (a == b)
-      return 0;
-   else /* a > b */
-      return 1;
-}  /* Compare */
+void Sort_init(sort_ctx_t* ctx, int local_n, int my_rank, int p,
+         MPI_Comm comm) {
+   ctx->local_A = (int*) malloc(local_n*sizeof(int));
+   ctx->temp_B = (int*) malloc(local_n*sizeof(int));
+   ctx->temp_C = (int*) malloc(local_n*sizeof(int));
+   ctx->local_n = local_n;
+   ctx->my_rank = my_rank;
+   ctx->p = p;
+   ctx->comm = comm;
+
+   /* Find partners:  negative rank => do nothing during phase */
+   if (my_rank % 2 != 0) {
+      ctx->even_partner = my_rank - 1;
+      ctx->odd_partner = my_rank + 1;
+      if (ctx->odd_partner == p)
+         ctx->odd_partner = -1;  // Idle during odd phase
+   } else {
+      ctx->even_partner = my_rank + 1;
+      if (ctx->even_partner == p)
+         ctx->even_partner = -1;  // Idle during even phase
+      ctx->odd_partner = my_rank-1;  
+   }
+
+#  ifdef PERSISTENT
+   Init_requests(ctx);
+#  endif
+}  /* Sort_init */
 
+
+#ifdef PERSISTENT
 /*-------------------------------------------------------------------
- * Function:    Sort
- * Purpose:     Use odd-even sort to sort global list.
- * Input args:  local_n, my_rank, p, comm
- * In/out args: local_A 
+ * Function:    Init_requests
+ * Purpose:     Create the persistent requests used by Odd_even_iter:
+ *              for each phase parity with a partner, a receive into
+ *              temp_B, and a send from each of the buffers that can
+ *              hold the local list
+ * In/out arg:  ctx
  */
-void Sort(int local_A[], int local_n, int my_rank, 
-         int p, MPI_Comm comm) {
-   int phase;
-   int *temp_B, *temp_C;
-   int even_partner;  /* phase is even or left-looking */
-   int odd_partner;   /* phase is odd or right-looking */
+void Init_requests(sort_ctx_t* ctx) {
+   int parity, b, partner;
+
+   ctx->bufs[0] = ctx->local_A;
+   ctx->bufs[1] = ctx->temp_C;
+   for (parity = 0; parity < 2; parity++) {
+      partner = (parity == 0) ? ctx->even_partner : ctx->odd_partner;
+      ctx->recv_req[parity] = MPI_REQUEST_NULL;
+      for (b = 0; b < 2; b++)
+         ctx->send_req[parity][b] = MPI_REQUEST_NULL;
+      if (partner < 0) continue;
+      MPI_Recv_init(ctx->temp_B, ctx->local_n, MPI_INT, partner, 0,
+            ctx->comm, &ctx->recv_req[parity]);
+      for (b = 0; b < 2; b++)
+         MPI_Send_init(ctx->bufs[b], ctx->local_n, MPI_INT, partner, 0,
+               ctx->comm, &ctx->send_req[parity][b]);
+   }
+}  /* Init_requests */
+#endif
 
-   /* Temporary storage used in merge-split */
-   temp_B = (int*) malloc(local_n*sizeof(int));
-   temp_C = (int*) malloc(local_n*sizeof(int));
 
-   /* Find partners:  negative rank => do nothing during phase */
-   if (my_rank % 2 != 0) {
-      even_partner = my_rank - 1;
-      odd_partner = my_rank + 1;
-      if (odd_partner == p) odd_partner = -1;  // Idle during odd phase
-   } else {
-      even_partner = my_rank + 1;
-      if (even_partner == p) even_partner = -1;  // Idle during even phase
-      odd_partner = my_rank-1;  
+/*-------------------------------------------------------------------
+ * Function:    Sort_free
+ * Purpose:     Free the buffers allocated by Sort_init
+ * In/out arg:  ctx
+ */
+void Sort_free(sort_ctx_t* ctx) {
+#  ifdef PERSISTENT
+   int parity, b;
+
+   for (parity = 0; parity < 2; parity++) {
+      if (ctx->recv_req[parity] != MPI_REQUEST_NULL)
+         MPI_Request_free(&ctx->recv_req[parity]);
+      for (b = 0; b < 2; b++)
+         if (ctx->send_req[parity][b] != MPI_REQUEST_NULL)
+            MPI_Request_free(&ctx->send_req[parity][b]);
    }
+#  endif
+   free(ctx->local_A);
+   free(ctx->temp_B);
+   free(ctx->temp_C);
+}  /* Sort_free */
 
-   /* Sort local list using built-in quick sort */
-   qsort(local_A, local_n, sizeof(int), Compare);
 
-   for (phase = 0; phase < p; phase++)
-      Odd_even_iter(local_A, temp_B, temp_C, local_n, phase, 
-             even_partner, odd_partner, my_rank, p, comm);
+/*-------------------------------------------------------------------
+ * Function:    Sort
+ * Purpose:     Use odd-even sort to sort global list.
+ * In/out arg:  ctx:  ctx->local_A is the process' sublist.  On
+ *              return it may point to a different buffer.
+ */
+void Sort(sort_ctx_t* ctx) {
+   int phase;
+
+   /* Sort local list */
+   TRACE_BEGIN("local sort", ctx->local_n);
+   Hybrid_sort(ctx->local_A, ctx->local_n);
+   TRACE_END("local sort");
 
-   free(temp_B);
-   free(temp_C);
+   for (phase = 0; phase < ctx->p; phase++)
+      Odd_even_iter(ctx, phase);
 }  /* Sort */
 
 
 /*-------------------------------------------------------------------
  * Function:    Odd_even_iter
  * Purpose:     One iteration of Odd-even transposition sort
- * In args:     local_n, phase, my_rank, p, comm
- * In/out args: local_A
- * Scratch:     temp_B, temp_C
+ * In args:     phase
+ * In/out arg:  ctx:  after a merge-split, ctx->local_A and ctx->temp_C
+ *              are swapped
  */
-void Odd_even_iter(int local_A[], int temp_B[], int temp_C[],
-        int local_n, int phase, int even_partner, int odd_partner,
-        int my_rank, int p, MPI_Comm comm) {
+void Odd_even_iter(sort_ctx_t* ctx, int phase) {
+#  ifdef PERSISTENT
+   MPI_Request reqs[2];
+#  else
    MPI_Status status;
+#  endif
+   int local_n = ctx->local_n;
+   int partner, keep_low;
+   int* swap;
 
    if (phase % 2 == 0) {  /* Even phase, odd process <-> rank-1 */
-      if (even_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, even_partner, 0, 
-            temp_B, local_n, MPI_INT, even_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_split_high(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_split_low(local_A, temp_B, temp_C, local_n);
-      }
+      partner = ctx->even_partner;
+      keep_low = (ctx->my_rank % 2 == 0);
    } else { /* Odd phase, odd process <-> rank+1 */
-      if (odd_partner >= 0) {
-         MPI_Sendrecv(local_A, local_n, MPI_INT, odd_partner, 0, 
-            temp_B, local_n, MPI_INT, odd_partner, 0, comm,
-            &status);
-         if (my_rank % 2 != 0)
-            Merge_split_low(local_A, temp_B, temp_C, local_n);
-         else
-            Merge_split_high(local_A, temp_B, temp_C, local_n);
-      }
+      partner = ctx->odd_partner;
+      keep_low = (ctx->my_rank % 2 != 0);
    }
+   if (partner < 0) return;
+
+   TRACE_BEGIN("sendrecv", phase);
+#  ifdef PERSISTENT
+   reqs[0] = ctx->send_req[phase % 2][ctx->local_A == ctx->bufs[0] ? 0 : 1];
+   reqs[1] = ctx->recv_req[phase % 2];
+   MPI_Startall(2, reqs);
+   MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+#  else
+   MPI_Sendrecv(ctx->local_A, local_n, MPI_INT, partner, 0, 
+      ctx->temp_B, local_n, MPI_INT, partner, 0, ctx->comm,
+      &status);
+#  endif
+   TRACE_END("sendrecv");
+   TRACE_BEGIN("merge split", phase);
+   if (keep_low)
+      Merge_split_low(ctx->local_A, ctx->temp_B, ctx->temp_C, local_n);
+   else
+      Merge_split_high(ctx->local_A, ctx->temp_B, ctx->temp_C, local_n);
+   TRACE_END("merge split");
+
+   swap = ctx->local_A;
+   ctx->local_A = ctx->temp_C;
+   ctx->temp_C = swap;
 }  /* Odd_even_iter */
 
 
 /*-------------------------------------------------------------------
  * Function:    Merge_split_low
  * Purpose:     Merge the smallest local_n elements in local_A 
- *              and temp_B into temp_C.  Then copy temp_C
- *              back into local_A.
- * In args:     local_n, temp_B
- * In/out args: local_A
- * Scratch:     temp_C
+ *              and temp_B into temp_C.
+ * In args:     local_A, temp_B, local_n
+ * Out arg:     temp_C
  */
 void Merge_split_low(int local_A[], int temp_B[], int temp_C[], 
         int local_n) {
@@ -351,18 +510,14 @@ void Merge_split_low(int local_A[], int temp_B[], int temp_C[],
          ci++; bi++;
       }
    }
-
-   memcpy(local_A, temp_C, local_n*sizeof(int));
 }  /* Merge_split_low */
 
 /*-------------------------------------------------------------------
  * Function:    Merge_split_high
  * Purpose:     Merge the largest local_n elements in local_A 
- *              and temp_B into temp_C.  Then copy temp_C
- *              back into local_A.
- * In args:     local_n, temp_B
- * In/out args: local_A
- * Scratch:     temp_C
+ *              and temp_B into temp_C.
+ * In args:     local_A, temp_B, local_n
+ * Out arg:     temp_C
  */
 void Merge_split_high(int local_A[], int temp_B[], int temp_C[], 
         int local_n) {
@@ -380,8 +535,6 @@ void Merge_split_high(int local_A[], int temp_B[], int temp_C[],
          ci--; bi--;
       }
    }
-
-   memcpy(local_A, temp_C, local_n*sizeof(int));
 }  /* Merge_split_low */
 
 
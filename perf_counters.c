@@ -0,0 +1,186 @@
+/* File:     perf_counters.c
+ *
+ * Purpose:  Implement the hardware event counters declared in
+ *           perf_counters.h
+ *
+ * Compile:  Link with a program that uses perf_counters.h.  Needs
+ *           -lpthread.
+ *
+ * Notes:
+ * 1.  Each event is opened as a separate counter, rather than as a
+ *     group, so that an event the processor doesn't support doesn't
+ *     prevent the others from being counted.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "perf_counters.h"
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static pthread_mutex_t add_mutex = PTHREAD_MUTEX_INITIALIZER;
+static const char* event_names[PERF_EVENT_COUNT] = {"cycles",
+   "instructions", "LLC misses", "branch misses", "dTLB misses"};
+
+/*-------------------------------------------------------------------
+ * Function:   Perf_init
+ * Purpose:    Zero the counts, and mark all the events available and
+ *             all the counters closed.  Used for totals.
+ */
+void Perf_init(perf_counters_t* pc) {
+   int e;
+
+   for (e = 0; e < PERF_EVENT_COUNT; e++) {
+      pc->fd[e] = -1;
+      pc->available[e] = 1;
+      pc->count[e] = 0;
+   }
+}  /* Perf_init */
+
+/*-------------------------------------------------------------------
+ * Function:   Perf_open
+ * Purpose:    Open a counter for each event for the calling thread.
+ *             The counters are initially disabled.
+ */
+void Perf_open(perf_counters_t* pc) {
+   int e;
+#  ifdef __linux__
+   struct perf_event_attr attr;
+   const unsigned type[PERF_EVENT_COUNT] = {PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+      PERF_TYPE_HW_CACHE};
+   const unsigned long long config[PERF_EVENT_COUNT] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+#  endif
+
+   Perf_init(pc);
+   for (e = 0; e < PERF_EVENT_COUNT; e++) {
+#     ifdef __linux__
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = type[e];
+      attr.config = config[e];
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      pc->fd[e] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#     endif
+      pc->available[e] = (pc->fd[e] >= 0);
+   }
+}  /* Perf_open */
+
+/*-------------------------------------------------------------------
+ * Function:   Perf_start
+ * Purpose:    Start counting
+ */
+void Perf_start(perf_counters_t* pc) {
+#  ifdef __linux__
+   int e;
+
+   for (e = 0; e < PERF_EVENT_COUNT; e++)
+      if (pc->fd[e] >= 0) {
+         ioctl(pc->fd[e], PERF_EVENT_IOC_RESET, 0);
+         ioctl(pc->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+      }
+#  endif
+}  /* Perf_start */
+
+/*-------------------------------------------------------------------
+ * Function:   Perf_stop
+ * Purpose:    Stop counting, and add the counts since Perf_start
+ *             into pc->count
+ */
+void Perf_stop(perf_counters_t* pc) {
+#  ifdef __linux__
+   int e;
+   unsigned long long buf[3];  /* value, time enabled, time running */
+
+   for (e = 0; e < PERF_EVENT_COUNT; e++)
+      if (pc->fd[e] >= 0) {
+         ioctl(pc->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+         if (read(pc->fd[e], buf, sizeof(buf)) != sizeof(buf)) {
+            pc->available[e] = 0;
+         } else if (buf[2] > 0) {
+            pc->count[e] += (long long)
+               ((double) buf[0]*((double) buf[1]/buf[2]));
+         }
+      }
+#  endif
+}  /* Perf_stop */
+
+/*-------------------------------------------------------------------
+ * Function:   Perf_close
+ * Purpose:    Close the counters.  The counts are kept.
+ */
+void Perf_close(perf_counters_t* pc) {
+   int e;
+
+   for (e = 0; e < PERF_EVENT_COUNT; e++)
+      if (pc->fd[e] >= 0) {
+         close(pc->fd[e]);
+         pc->fd[e] = -1;
+      }
+}  /* Perf_close */
+
+/*-------------------------------------------------------------------
+ * Function:   Perf_add
+ * Purpose:    Add the counts in pc into total.  An event is only
+ *             available in the total if it's available in every
+ *             set of counts added into it.  Safe to call from
+ *             several threads at once.
+ */
+void Perf_add(perf_counters_t* total, const perf_counters_t* pc) {
+   int e;
+
+   pthread_mutex_lock(&add_mutex);
+   for (e = 0; e < PERF_EVENT_COUNT; e++) {
+      total->count[e] += pc->count[e];
+      total->available[e] = total->available[e] && pc->available[e];
+   }
+   pthread_mutex_unlock(&add_mutex);
+}  /* Perf_add */
+
+/*-------------------------------------------------------------------
+ * Function:   Perf_print
+ * Purpose:    Print the counts, the instructions per cycle, and the
+ *             misses per thousand instructions
+ */
+void Perf_print(FILE* fp, const perf_counters_t* pc) {
+   int e, any = 0;
+   double instr = pc->count[PERF_INSTRUCTIONS];
+   int instr_ok = pc->available[PERF_INSTRUCTIONS] && instr > 0;
+
+   for (e = 0; e < PERF_EVENT_COUNT; e++)
+      any = any || pc->available[e];
+   if (!any) {
+      fprintf(fp, "Performance counters are not available\n");
+      return;
+   }
+
+   for (e = 0; e < PERF_EVENT_COUNT; e++)
+      if (pc->available[e])
+         fprintf(fp, "%-14s = %lld\n", event_names[e], pc->count[e]);
+      else
+         fprintf(fp, "%-14s = n/a\n", event_names[e]);
+
+   if (instr_ok && pc->available[PERF_CYCLES] && pc->count[PERF_CYCLES] > 0)
+      fprintf(fp, "IPC = %.3f", instr/pc->count[PERF_CYCLES]);
+   else
+      fprintf(fp, "IPC = n/a");
+   for (e = PERF_LLC_MISSES; e < PERF_EVENT_COUNT; e++)
+      if (instr_ok && pc->available[e])
+         fprintf(fp, ", %s/1000 instr = %.3f", event_names[e],
+               1000.0*pc->count[e]/instr);
+      else
+         fprintf(fp, ", %s/1000 instr = n/a", event_names[e]);
+   fprintf(fp, "\n");
+}  /* Perf_print */
@@ -0,0 +1,68 @@
+/* File:     perf_counters.h
+ *
+ * Purpose:  Count hardware events in a region of code using the Linux
+ *           perf_event_open system call.  The events counted are
+ *           cycles, instructions, last level cache misses, branch
+ *           misses, and data TLB misses.  The counters only count the
+ *           events of the thread that opened them.
+ *
+ * Compile:  Link with perf_counters.c.  The programs in this directory
+ *           that use it only do so when they're compiled with -DPERF,
+ *           e.g.,
+ *           gcc -g -Wall -DPERF -o pth_mat_vect_rand_cyc
+ *              pth_mat_vect_rand_cyc.c perf_counters.c -lpthread
+ *
+ * Example:
+ *    perf_counters_t my_counters, total;
+ *    . . .
+ *    Perf_init(&total);  // Just zeroes the counts
+ *    . . .
+ *    // In each thread
+ *    Perf_open(&my_counters);
+ *    Perf_start(&my_counters);
+ *    . . .
+ *    Code to be measured
+ *    . . .
+ *    Perf_stop(&my_counters);
+ *    Perf_close(&my_counters);
+ *    Perf_add(&total, &my_counters);  // Add into total with a lock
+ *    . . .
+ *    Perf_print(stdout, &total);
+ *
+ * Notes:
+ * 1.  If an event can't be counted (the kernel doesn't support
+ *     perf_event_open, /proc/sys/kernel/perf_event_paranoid is too
+ *     high, the processor doesn't have the event, or the program isn't
+ *     running on Linux), its count is marked unavailable, and
+ *     Perf_print prints n/a for it and the rates that use it.  The
+ *     rest of the program runs normally.
+ * 2.  Only user-level events are counted, so the counters work with
+ *     perf_event_paranoid <= 2.
+ * 3.  If the kernel has to multiplex the counters, the counts are
+ *     scaled by (time enabled)/(time running).
+ * 4.  Perf_start and Perf_stop can be called repeatedly:  the counts
+ *     accumulate.
+ */
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+#include <stdio.h>
+
+typedef enum {PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES,
+   PERF_BRANCH_MISSES, PERF_DTLB_MISSES, PERF_EVENT_COUNT} perf_event_t;
+
+typedef struct {
+   int       fd[PERF_EVENT_COUNT];         /* -1 if not open          */
+   int       available[PERF_EVENT_COUNT];  /* 1 if the count is valid */
+   long long count[PERF_EVENT_COUNT];
+} perf_counters_t;
+
+void Perf_init(perf_counters_t* pc);
+void Perf_open(perf_counters_t* pc);
+void Perf_start(perf_counters_t* pc);
+void Perf_stop(perf_counters_t* pc);
+void Perf_close(perf_counters_t* pc);
+void Perf_add(perf_counters_t* total, const perf_counters_t* pc);
+void Perf_print(FILE* fp, const perf_counters_t* pc);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "par_output.h"
 
 void Print_row(int local_mat[], int n, int my_rank, int i);
 
@@ -12,17 +13,24 @@ void Print_row(int local_mat[], int n, int my_rank, int i);
  * In args:   all            
  */
 void Print_row(int local_mat[], int n, int my_rank, int i){
-   char char_int[100];
-   char char_row[1000];
-   int j, offset = 0;
+   out_buf_t out;
+   int j;
 
+   Out_init(&out);
+   Out_str(&out, "Proc ");
+   Out_int(&out, my_rank);
+   Out_str(&out, " > row ");
+   Out_int(&out, i);
+   Out_str(&out, " = ");
    for (j = 0; j < n; j++) {
-      if (local_mat[i*n + j] == INFINITY)
-         sprintf(char_int, "i ");
-      else
-         sprintf(char_int, "%d ", local_mat[i*n + j]);
-      sprintf(char_row + offset, "%s", char_int);
-      offset += strlen(char_int);
+      if (local_mat[i*n + j] == INFINITY) {
+         Out_str(&out, "i ");
+      } else {
+         Out_int(&out, local_mat[i*n + j]);
+         Out_char(&out, ' ');
+      }
    }  
-   printf("Proc %d > row %d = %s\n", my_rank, i, char_row);
+   Out_char(&out, '\n');
+   Out_print(&out, stdout);
+   Out_free(&out);
 }  /* Print_row */
\ No newline at end of file
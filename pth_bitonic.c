@@ -2,7 +2,8 @@
  *
  * Purpose:  Implement bitonic sort of a list of ints using Pthreads
  *
- * Compile:  gcc -g -Wall -o pth_bitonic pth_bitonic.c -lpthread
+ * Compile:  gcc -g -Wall -O3 -march=native -o pth_bitonic pth_bitonic.c
+ *              sort_net.c -lpthread
  * Run:      ./pth_bitonic <thread count> <n> [g] [o]
  *           n = number of ints in the list 
  *           If 'g' is included on the command line, the program
@@ -21,12 +22,24 @@
  * Notes:
  * 1.  thread_count should be a power of 2
  * 2.  n = list_size should be evenly divisible by thread_count
+ * 3.  Compile with -DREGIONS and link with region_timer.c to get a
+ *     table of the time each thread spends in the local sort, the
+ *     merge-splits, and the barriers (see region_timer.h).
+ * 4.  Compile with -DTRACE and link with trace.c to get a timeline of
+ *     the same events for each thread in trace.<pid>.json (see
+ *     trace.h).  The argument of a merge split is the partner.
+ * 5.  Each thread sorts its sublist with Hybrid_sort (see sort_net.h),
+ *     which sorts short runs with sorting networks in AVX2 registers
+ *     when the compiler targets AVX2.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include "timer.h"
+#include "region_timer.h"
+#include "trace.h"
+#include "sort_net.h"
 
 /* Random values in the range 0 to RMAX-1 */
 #define RMAX 1000000
@@ -55,7 +68,6 @@ void Merge_split_lo(int my_rank, int my_first, int local_n,
       int partner);
 void Merge_split_hi(int my_rank, int my_first, int local_n,
       int partner);
-int  Compare(const void* x_p, const void* y_p);
 void Barrier(void);
 
 /*--------------------------------------------------------------------*/
@@ -198,28 +210,6 @@ void Print_list(char title[], int list[], int n) {
 }  /* Print_list */
 
 
-/*-----------------------------------------------------------------
- * Function:     Compare
- * Purpose:      Compare two ints and determine their relative sizes
- * In args:      x_p, y_p
- * Ret val:      -1 if *x_p < *y_p
- *                0 if *x_p == *y_p
- *               +1 if *x_p > *y_p
- * Note:         For use by qsort library function
- */
-int Compare(const void* x_p, const void* y_p) {
-   int x = *((int*)x_p);
-   int y = *((int*)y_p);
-
-   if (x < y)
-      return -1;
-   else if (x == y)
-      return 0;
-   else /* x > y */
-      return 1;
-}  /* Compare */
-
-
 /*-------------------------------------------------------------------
  * Function:        Bitonic_sort
  * Purpose:         Implement bitonic sort of a list of ints
@@ -237,11 +227,17 @@ void *Bitonic_sort(void* rank) {
 // int my_last = my_first + local_n - 1;
    unsigned th_count, and_bit, dim;
 
+   TRACE_THREAD(my_rank);
+
    /* Sort my sublist */
-   qsort(list1 + my_first, local_n, sizeof(int), Compare);  
+   REGION_BEGIN("local sort");
+   TRACE_BEGIN("local sort", local_n);
+   Hybrid_sort(list1 + my_first, local_n);
+   TRACE_END("local sort");
+   REGION_END("local sort");
    Barrier();
 #  ifdef DEBUG
-   if (my_rank == 0) Print_list("List after qsort", list1, n);
+   if (my_rank == 0) Print_list("List after local sort", list1, n);
 #  endif
    for (th_count = 2, and_bit = 2, dim = 1; th_count <= thread_count; 
          th_count <<= 1, and_bit <<= 1, dim++) {
@@ -278,10 +274,14 @@ void Bitonic_sort_incr(int th_count, int dim, int my_first, int local_n,
 
    for (stage = 0; stage < dim; stage++) {
       partner = my_rank ^ eor_bit;
+      REGION_BEGIN("merge split");
+      TRACE_BEGIN("merge split", partner);
       if (my_rank < partner)
          Merge_split_lo(my_rank, my_first, local_n, partner);
       else
          Merge_split_hi(my_rank, my_first, local_n, partner);
+      TRACE_END("merge split");
+      REGION_END("merge split");
       eor_bit >>= 1;
       Barrier();
       if (my_rank == 0) {
@@ -326,10 +326,14 @@ void Bitonic_sort_decr(int th_count, int dim, int my_first, int local_n,
 
    for (stage = 0; stage < dim; stage++) {
       partner = my_rank ^ eor_bit;
+      REGION_BEGIN("merge split");
+      TRACE_BEGIN("merge split", partner);
       if (my_rank > partner)
          Merge_split_lo(my_rank, my_first, local_n, partner);
       else
          Merge_split_hi(my_rank, my_first, local_n, partner);
+      TRACE_END("merge split");
+      REGION_END("merge split");
       eor_bit >>= 1;
       Barrier();
       if (my_rank == 0) {
@@ -416,6 +420,8 @@ void Merge_split_hi(int my_rank, int my_first, int local_n,
  * Globals:   bar_count, bar_mutex, bar_cond
  */
 void Barrier(void) {
+   REGION_BEGIN("barrier");
+   TRACE_BEGIN("barrier", 0);
    pthread_mutex_lock(&bar_mutex);
    bar_count++;
    if (bar_count == thread_count) {
@@ -425,4 +431,6 @@ void Barrier(void) {
       while (pthread_cond_wait(&bar_cond, &bar_mutex) != 0);
    }
    pthread_mutex_unlock(&bar_mutex);
+   TRACE_END("barrier");
+   REGION_END("barrier");
 }  /* Barrier */
\ No newline at end of file
@@ -0,0 +1,461 @@
+/* File:     pth_mat_elementwise.c
+ *
+ * Purpose:  Elementwise operations on m x n matrices of floats using
+ *           Pthreads:  a cpu counterpart to mat_add.cu.  The supported
+ *           operations are
+ *
+ *              add:    C = A + B
+ *              scale:  C = alpha*A
+ *              fma:    C = A*B + C   (elementwise products)
+ *              axpby:  C = alpha*A + beta*B
+ *
+ *           The rows are divided among the threads by blocks, and the
+ *           loop over each row is written so that the compiler can
+ *           vectorize it.  The operation is repeated REPS times and
+ *           the program reports the best time, the bandwidth in GB/s,
+ *           and the bandwidth as a percentage of the bandwidth of a
+ *           copy (C = A) of the same matrices by the same threads.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o pth_mat_elementwise
+ *              pth_mat_elementwise.c -lpthread
+ * Run:      ./pth_mat_elementwise <thread_count> <m> <n> <op> <i|g|b>
+ *              [file] [o]
+ *              m is the number of rows
+ *              n is the number of columns
+ *              op is one of add, scale, fma, axpby
+ *              i:  read the matrices from stdin in the format used
+ *                  by mat_add.cu
+ *              g:  generate the matrices with a random number generator
+ *              b:  read the matrices from the binary file [file].  The
+ *                  file should contain the m*n floats of A in row-major
+ *                  order, followed by B (and C if op is fma)
+ *              o:  print the input matrices and the result
+ *
+ * Input:    The matrices A and B (and C if op is fma) if i or b is used
+ * Output:   The result (if o is used), elapsed time and bandwidth.
+ *
+ * Notes:
+ * 1.  Unlike mat_add.cu, there is no limit on n.
+ * 2.  Storage for each matrix is allocated with posix_memalign, and
+ *     each row is padded so that it starts on a MEM_ALIGN-byte boundary.
+ *     So row i of A starts at A[i*ld], where ld >= n.
+ * 3.  The pages of the matrices are first touched by the threads that
+ *     will use them.
+ * 4.  The reported bandwidth counts each matrix that's read or
+ *     written once:  e.g., 3*m*n*sizeof(float) bytes for add.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timer.h"
+
+#define MEM_ALIGN 64
+#define REPS 10
+#define ALPHA 2.0f
+#define BETA 0.5f
+
+typedef enum {ADD, SCALE, FMA, AXPBY, COPY} op_t;
+
+/* Global variables */
+int     thread_count;
+int     m, n, ld;
+float  *A, *B, *C;
+op_t    op;
+int     reps;
+pthread_barrier_t barrier;
+double  best_time;
+
+/* Serial functions */
+void   Usage(char* prog_name);
+void   Get_args(int argc, char* argv[], char* input_p, char** file_p,
+          int* output_p);
+float* Alloc_matrix(void);
+void   Read_matrix(float A[], int m, int n);
+void   Read_matrix_bin(FILE* fp, float A[], int m, int n);
+void   Gen_matrix(float A[], int m, int n);
+void   Print_matrix(char title[], float A[], int m, int n);
+int    Op_matrix_count(op_t op);
+void   Start_threads(void* (*thread_fn)(void*));
+double Run(op_t the_op, int the_reps);
+
+/* Parallel functions */
+void   Get_rows(long my_rank, int* my_first_p, int* my_last_p);
+void*  Pth_first_touch(void* rank);
+void*  Pth_elementwise(void* rank);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   char   input;
+   char*  file;
+   int    output;
+   FILE*  fp;
+   double elapsed, copy_elapsed, bytes, gbs, copy_gbs;
+
+   Get_args(argc, argv, &input, &file, &output);
+   ld = ((n*sizeof(float) + MEM_ALIGN - 1)/MEM_ALIGN)*MEM_ALIGN
+      /sizeof(float);
+   A = Alloc_matrix();
+   B = Alloc_matrix();
+   C = Alloc_matrix();
+   pthread_barrier_init(&barrier, NULL, thread_count);
+
+   /* Let each thread touch the pages it will use */
+   Start_threads(Pth_first_touch);
+
+   if (input == 'i') {
+      printf("Enter the matrices A and B%s\n", op == FMA ? " and C" : "");
+      Read_matrix(A, m, n);
+      Read_matrix(B, m, n);
+      if (op == FMA) Read_matrix(C, m, n);
+   } else if (input == 'b') {
+      fp = fopen(file, "rb");
+      if (fp == NULL) {
+         fprintf(stderr, "Can't open %s\n", file);
+         exit(-1);
+      }
+      Read_matrix_bin(fp, A, m, n);
+      Read_matrix_bin(fp, B, m, n);
+      if (op == FMA) Read_matrix_bin(fp, C, m, n);
+      fclose(fp);
+   } else {
+      srandom(1);
+      Gen_matrix(A, m, n);
+      Gen_matrix(B, m, n);
+      if (op == FMA) Gen_matrix(C, m, n);
+   }
+
+   if (output) {
+      Print_matrix("A =", A, m, n);
+      Print_matrix("B =", B, m, n);
+      if (op == FMA) Print_matrix("C =", C, m, n);
+   }
+
+   /* fma updates C, so the result is printed after a single rep */
+   if (output) {
+      Run(op, 1);
+      Print_matrix("The result is:", C, m, n);
+   }
+
+   copy_elapsed = Run(COPY, REPS);
+   elapsed = Run(op, REPS);
+
+   bytes = ((double) Op_matrix_count(op))*m*n*sizeof(float);
+   gbs = bytes/elapsed/1.0e9;
+   copy_gbs = 2.0*m*n*sizeof(float)/copy_elapsed/1.0e9;
+   printf("Elapsed time = %e seconds\n", elapsed);
+   printf("Bandwidth = %.2f GB/s (copy = %.2f GB/s, %.1f%% of copy)\n",
+         gbs, copy_gbs, 100.0*gbs/copy_gbs);
+
+   pthread_barrier_destroy(&barrier);
+   free(A);
+   free(B);
+   free(C);
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   print a message showing what the command line should
+ *            be, and terminate
+ * In arg :   prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <m> <n> <op> <i|g|b> "
+         "[file] [o]\n", prog_name);
+   fprintf(stderr, "   op: add, scale, fma, or axpby\n");
+   fprintf(stderr, "   i:  read matrices from stdin\n");
+   fprintf(stderr, "   g:  generate matrices\n");
+   fprintf(stderr, "   b:  read matrices from binary file\n");
+   fprintf(stderr, "   o:  print matrices\n");
+   exit(0);
+}  /* Usage */
+
+
+/*------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check command line args
+ * In args:     argc, argv
+ * Out args:    input_p, file_p, output_p
+ * Out globals: thread_count, m, n, op
+ */
+void Get_args(int argc, char* argv[], char* input_p, char** file_p,
+      int* output_p) {
+   int next;
+
+   if (argc < 6 || argc > 8) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   m = strtol(argv[2], NULL, 10);
+   n = strtol(argv[3], NULL, 10);
+   if (thread_count <= 0 || m <= 0 || n <= 0) Usage(argv[0]);
+
+   if (strcmp(argv[4], "add") == 0)
+      op = ADD;
+   else if (strcmp(argv[4], "scale") == 0)
+      op = SCALE;
+   else if (strcmp(argv[4], "fma") == 0)
+      op = FMA;
+   else if (strcmp(argv[4], "axpby") == 0)
+      op = AXPBY;
+   else
+      Usage(argv[0]);
+
+   *input_p = argv[5][0];
+   if (*input_p != 'i' && *input_p != 'g' && *input_p != 'b')
+      Usage(argv[0]);
+   next = 6;
+   *file_p = NULL;
+   if (*input_p == 'b') {
+      if (argc < 7) Usage(argv[0]);
+      *file_p = argv[next++];
+   }
+
+   *output_p = 0;
+   if (next < argc) {
+      if (argv[next][0] != 'o' || next + 1 < argc) Usage(argv[0]);
+      *output_p = 1;
+   }
+}  /* Get_args */
+
+
+/*------------------------------------------------------------------
+ * Function:    Alloc_matrix
+ * Purpose:     Allocate storage for an m x ld matrix aligned on a
+ *              MEM_ALIGN-byte boundary
+ * In globals:  m, ld
+ * Ret val:     The new matrix
+ */
+float* Alloc_matrix(void) {
+   void* mat;
+
+   if (posix_memalign(&mat, MEM_ALIGN, ((size_t) m)*ld*sizeof(float))
+         != 0) {
+      fprintf(stderr, "Can't allocate matrix\n");
+      exit(-1);
+   }
+   return mat;
+}  /* Alloc_matrix */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Read_matrix
+ * Purpose:   Read an m x n matrix from stdin
+ * In args:   m, n
+ * Out arg:   A
+ */
+void Read_matrix(float A[], int m, int n) {
+   int i, j;
+
+   for (i = 0; i < m; i++)
+      for (j = 0; j < n; j++)
+         scanf("%f", &A[i*ld+j]);
+}  /* Read_matrix */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Read_matrix_bin
+ * Purpose:   Read an m x n matrix of floats from a binary file
+ * In args:   fp, m, n
+ * Out arg:   A
+ */
+void Read_matrix_bin(FILE* fp, float A[], int m, int n) {
+   int i;
+
+   for (i = 0; i < m; i++)
+      if (fread(&A[((size_t) i)*ld], sizeof(float), n, fp) != n) {
+         fprintf(stderr, "Binary file is too short\n");
+         exit(-1);
+      }
+}  /* Read_matrix_bin */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Gen_matrix
+ * Purpose:   Use the random number generator random to generate
+ *            the entries in A
+ * In args:   m, n
+ * Out arg:   A
+ */
+void Gen_matrix(float A[], int m, int n) {
+   int i, j;
+
+   for (i = 0; i < m; i++)
+      for (j = 0; j < n; j++)
+         A[((size_t) i)*ld+j] = random()/((float) RAND_MAX);
+}  /* Gen_matrix */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Print_matrix
+ * Purpose:   Print an m x n matrix to stdout
+ * In args:   title, A, m, n
+ */
+void Print_matrix(char title[], float A[], int m, int n) {
+   int i, j;
+
+   printf("%s\n", title);
+   for (i = 0; i < m; i++) {
+      for (j = 0; j < n; j++)
+         printf("%.1f ", A[((size_t) i)*ld+j]);
+      printf("\n");
+   }
+}  /* Print_matrix */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Op_matrix_count
+ * Purpose:   Return the number of matrices read or written by op
+ */
+int Op_matrix_count(op_t op) {
+   switch (op) {
+      case ADD:   return 3;
+      case SCALE: return 2;
+      case FMA:   return 4;
+      case AXPBY: return 3;
+      default:    return 2;  /* COPY */
+   }
+}  /* Op_matrix_count */
+
+
+/*---------------------------------------------------------------------
+ * Function:    Start_threads
+ * Purpose:     Start thread_count threads running thread_fn and
+ *              wait for them to finish
+ * In arg:      thread_fn
+ * In global:   thread_count
+ */
+void Start_threads(void* (*thread_fn)(void*)) {
+   long       thread;
+   pthread_t* thread_handles;
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         thread_fn, (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   free(thread_handles);
+}  /* Start_threads */
+
+
+/*---------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Have each thread carry out the_op the_reps times, and 
+ *              return the best time
+ * In args:     the_op, the_reps
+ * Out globals: op, reps
+ * Ret val:     The minimum elapsed time over the reps
+ */
+double Run(op_t the_op, int the_reps) {
+   op_t save_op = op;
+
+   op = the_op;
+   reps = the_reps;
+   best_time = 1.0e30;
+   Start_threads(Pth_elementwise);
+   op = save_op;
+
+   return best_time;
+}  /* Run */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Get_rows
+ * Purpose:        Find the block of rows assigned to a thread
+ * In arg:         my_rank
+ * Out args:       my_first_p, my_last_p:  the thread's rows are
+ *                 my_first <= i < my_last
+ * Global in vars: m, thread_count
+ */
+void Get_rows(long my_rank, int* my_first_p, int* my_last_p) {
+   int local_m = m/thread_count, rem = m % thread_count;
+
+   if (my_rank < rem) {
+      *my_first_p = my_rank*(local_m + 1);
+      *my_last_p = *my_first_p + local_m + 1;
+   } else {
+      *my_first_p = my_rank*local_m + rem;
+      *my_last_p = *my_first_p + local_m;
+   }
+}  /* Get_rows */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Pth_first_touch
+ * Purpose:        Zero this thread's block of rows in A, B, and C, so
+ *                 that the pages are allocated near the thread
+ * In arg:         rank
+ * Global out:     A, B, C
+ */
+void* Pth_first_touch(void* rank) {
+   long my_rank = (long) rank;
+   int  i, my_first, my_last;
+
+   Get_rows(my_rank, &my_first, &my_last);
+   for (i = my_first; i < my_last; i++) {
+      memset(&A[((size_t) i)*ld], 0, ld*sizeof(float));
+      memset(&B[((size_t) i)*ld], 0, ld*sizeof(float));
+      memset(&C[((size_t) i)*ld], 0, ld*sizeof(float));
+   }
+
+   return NULL;
+}  /* Pth_first_touch */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Pth_elementwise
+ * Purpose:        Apply op to this thread's block of rows reps times.
+ *                 Thread 0 records the best time.
+ * In arg:         rank
+ * Global in vars: A, B, m, n, ld, op, reps, thread_count
+ * Global in/out:  C, best_time
+ */
+void* Pth_elementwise(void* rank) {
+   long my_rank = (long) rank;
+   int  i, j, rep, my_first, my_last;
+   double start, finish;
+   float* restrict a;
+   float* restrict b;
+   float* restrict c;
+
+   Get_rows(my_rank, &my_first, &my_last);
+   for (rep = 0; rep < reps; rep++) {
+      pthread_barrier_wait(&barrier);
+      if (my_rank == 0) GET_TIME(start);
+      for (i = my_first; i < my_last; i++) {
+         a = __builtin_assume_aligned(&A[((size_t) i)*ld], MEM_ALIGN);
+         b = __builtin_assume_aligned(&B[((size_t) i)*ld], MEM_ALIGN);
+         c = __builtin_assume_aligned(&C[((size_t) i)*ld], MEM_ALIGN);
+         switch (op) {
+            case ADD:
+               for (j = 0; j < n; j++)
+                  c[j] = a[j] + b[j];
+               break;
+            case SCALE:
+               for (j = 0; j < n; j++)
+                  c[j] = ALPHA*a[j];
+               break;
+            case FMA:
+               for (j = 0; j < n; j++)
+                  c[j] = a[j]*b[j] + c[j];
+               break;
+            case AXPBY:
+               for (j = 0; j < n; j++)
+                  c[j] = ALPHA*a[j] + BETA*b[j];
+               break;
+            case COPY:
+               for (j = 0; j < n; j++)
+                  c[j] = a[j];
+               break;
+         }
+      }
+      pthread_barrier_wait(&barrier);
+      if (my_rank == 0) {
+         GET_TIME(finish);
+         if (finish - start < best_time) best_time = finish - start;
+      }
+   }
+
+   return NULL;
+}  /* Pth_elementwise */
@@ -0,0 +1,215 @@
+/* File:
+ *     pth_mat_mat.c
+ *
+ * Purpose:
+ *     Computes a parallel matrix-matrix product C = A*B.  The rows of
+ *     A and C are divided among the threads by blocks, and each thread
+ *     uses the cache-blocked Gemm in gemm.c to multiply its block of
+ *     rows of A by B.  A and B are generated with a random number
+ *     generator.
+ *
+ * Input:
+ *     none
+ *
+ * Output:
+ *     Elapsed time for the computation, GFLOP/s, and the GFLOP/s as
+ *     a percentage of the theoretical peak.
+ *     If c is on the command line, the maximum difference between C
+ *     and the product computed with the usual triple loop.
+ *
+ * Compile:
+ *    gcc -g -Wall -O3 -march=native -o pth_mat_mat pth_mat_mat.c gemm.c
+ *       -lpthread
+ * Usage:
+ *    ./pth_mat_mat <thread_count> <m> <n> <k> [c]
+ *       C is m x n, A is m x k, B is k x n
+ *       c:  check the product against the triple loop
+ *
+ * Notes:
+ *     1.  We use 1-dimensional arrays for A, B, C and compute
+ *         subscripts using the formula A[i][j] = A[i*k + j]
+ *     2.  The theoretical peak is
+ *            thread_count*(clock rate)*GEMM_FLOPS_PER_CYCLE
+ *         where the clock rate is taken from /proc/cpuinfo.  It
+ *         assumes that each thread runs on its own core.
+ *     3.  Compile with -DDEBUG to print A, B, and C.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "timer.h"
+#include "gemm.h"
+
+/* Global variables */
+int     thread_count;
+int     m, n, k;
+double* A;
+double* B;
+double* C;
+
+/* Serial functions */
+void Usage(char* prog_name);
+void Gen_matrix(double A[], int m, int n);
+void Print_matrix(char* title, double A[], int m, int n);
+double Check_product(void);
+
+/* Parallel function */
+void *Pth_mat_mat(void* rank);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long       thread;
+   pthread_t* thread_handles;
+   double start, finish, elapsed, gflops, ghz;
+
+   if (argc != 5 && argc != 6) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   m = strtol(argv[2], NULL, 10);
+   n = strtol(argv[3], NULL, 10);
+   k = strtol(argv[4], NULL, 10);
+   if (argc == 6 && argv[5][0] != 'c') Usage(argv[0]);
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   A = malloc(((size_t) m)*k*sizeof(double));
+   B = malloc(((size_t) k)*n*sizeof(double));
+   C = calloc(((size_t) m)*n, sizeof(double));
+
+   srandom(1);
+   Gen_matrix(A, m, k);
+   Gen_matrix(B, k, n);
+#  ifdef DEBUG
+   Print_matrix("A =", A, m, k);
+   Print_matrix("B =", B, k, n);
+#  endif
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         Pth_mat_mat, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+   elapsed = finish - start;
+
+#  ifdef DEBUG
+   Print_matrix("The product is", C, m, n);
+#  endif
+   gflops = 2.0*m*n*k/elapsed/1.0e9;
+   printf("Elapsed time = %e seconds\n", elapsed);
+   printf("GFLOP/s = %.2f", gflops);
+   ghz = Cpu_ghz();
+   if (ghz > 0.0)
+      printf(" (%.1f%% of peak %.2f GFLOP/s)", 100.0*gflops/
+            (thread_count*ghz*GEMM_FLOPS_PER_CYCLE),
+            thread_count*ghz*GEMM_FLOPS_PER_CYCLE);
+   printf("\n");
+
+   if (argc == 6)
+      printf("Max difference from triple loop = %e\n", Check_product());
+
+   free(A);
+   free(B);
+   free(C);
+   free(thread_handles);
+
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   print a message showing what the command line should
+ *            be, and terminate
+ * In arg :   prog_name
+ */
+void Usage (char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <m> <n> <k> [c]\n", prog_name);
+   fprintf(stderr, "   C is m x n, A is m x k, B is k x n\n");
+   fprintf(stderr, "   c:  check the product against the triple loop\n");
+   exit(0);
+}  /* Usage */
+
+/*------------------------------------------------------------------
+ * Function: Gen_matrix
+ * Purpose:  Use the random number generator random to generate
+ *    the entries in A
+ * In args:  m, n
+ * Out arg:  A
+ */
+void Gen_matrix(double A[], int m, int n) {
+   int i, j;
+
+   for (i = 0; i < m; i++)
+      for (j = 0; j < n; j++)
+         A[i*n+j] = random()/((double) RAND_MAX);
+}  /* Gen_matrix */
+
+
+/*------------------------------------------------------------------
+ * Function:       Pth_mat_mat
+ * Purpose:        Multiply the thread's block of rows of A by B
+ * In arg:         rank
+ * Global in vars: A, B, m, n, k, thread_count
+ * Global out var: C
+ */
+void *Pth_mat_mat(void* rank) {
+   long my_rank = (long) rank;
+   int local_m = m/thread_count, rem = m % thread_count;
+   int my_first, my_m;
+
+   if (my_rank < rem) {
+      my_m = local_m + 1;
+      my_first = my_rank*my_m;
+   } else {
+      my_m = local_m;
+      my_first = my_rank*local_m + rem;
+   }
+
+   Gemm(my_m, n, k, &A[((size_t) my_first)*k], k, B, n,
+         &C[((size_t) my_first)*n], n);
+
+   return NULL;
+}  /* Pth_mat_mat */
+
+
+/*------------------------------------------------------------------
+ * Function:    Check_product
+ * Purpose:     Compute A*B with the triple loop and return the
+ *              largest difference between it and C
+ * Globals:     A, B, C, m, n, k
+ */
+double Check_product(void) {
+   int i, j, p;
+   double sum, diff, max_diff = 0.0;
+
+   for (i = 0; i < m; i++)
+      for (j = 0; j < n; j++) {
+         sum = 0.0;
+         for (p = 0; p < k; p++)
+            sum += A[i*k+p]*B[p*n+j];
+         diff = fabs(sum - C[i*n+j]);
+         if (diff > max_diff) max_diff = diff;
+      }
+   return max_diff;
+}  /* Check_product */
+
+
+/*------------------------------------------------------------------
+ * Function:    Print_matrix
+ * Purpose:     Print the matrix
+ * In args:     title, A, m, n
+ */
+void Print_matrix( char* title, double A[], int m, int n) {
+   int   i, j;
+
+   printf("%s\n", title);
+   for (i = 0; i < m; i++) {
+      for (j = 0; j < n; j++)
+         printf("%6.3f ", A[i*n + j]);
+      printf("\n");
+   }
+}  /* Print_matrix */
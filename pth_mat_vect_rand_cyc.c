@@ -26,6 +26,10 @@
  *         globally shared.
  *     4.  Compile with -DDEBUG for information on generated data
  *         and product.
+ *     5.  Compile with -DPERF and link with perf_counters.c to count
+ *         cycles, instructions, and cache, branch and TLB misses in
+ *         the threads' loops (see perf_counters.h).  The totals over
+ *         all the threads are printed after the elapsed time.
  *
  * Performance:  We obtained the following run-times for this program
  * and the program pth_mat_vect_rand.c, which uses a block distribution.
@@ -68,6 +72,9 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include "timer.h"
+#ifdef PERF
+#include "perf_counters.h"
+#endif
 
 /* Global variables */
 int     thread_count;
@@ -75,6 +82,9 @@ int     m, n;
 double* A;
 double* x;
 double* y;
+#ifdef PERF
+perf_counters_t total_counters;
+#endif
 
 /* Serial functions */
 void Usage(char* prog_name);
@@ -118,6 +128,9 @@ int main(int argc, char* argv[]) {
 #  ifdef DEBUG
    Print_vector("We generated", x, n); 
 #  endif
+#  ifdef PERF
+   Perf_init(&total_counters);
+#  endif
 
    GET_TIME(start);
    for (thread = 0; thread < thread_count; thread++)
@@ -132,6 +145,9 @@ int main(int argc, char* argv[]) {
    Print_vector("The product is", y, m); 
 #  endif
    printf("Elapsed time = %e seconds\n", finish - start);
+#  ifdef PERF
+   Perf_print(stdout, &total_counters);
+#  endif
 
    free(A);
    free(x);
@@ -222,6 +238,12 @@ void *Pth_mat_vect(void* rank) {
    long my_rank = (long) rank;
    int i;
    int j; 
+#  ifdef PERF
+   perf_counters_t my_counters;
+
+   Perf_open(&my_counters);
+   Perf_start(&my_counters);
+#  endif
 
    for (i = my_rank; i < m; i += thread_count) {
       y[i] = 0.0;
@@ -229,6 +251,11 @@ void *Pth_mat_vect(void* rank) {
           y[i] += A[i*n+j]*x[j];
    }
 
+#  ifdef PERF
+   Perf_stop(&my_counters);
+   Perf_close(&my_counters);
+   Perf_add(&total_counters, &my_counters);
+#  endif
    return NULL;
 }  /* Pth_mat_vect */
 
@@ -0,0 +1,560 @@
+/* File:     pth_permute.c
+ *
+ * Purpose:  Permute large arrays of ints using Pthreads:  a parallel
+ *           generalization of reverse.c.  The supported operations are
+ *
+ *              r:  reverse the n elements of an array in place
+ *              g:  gather:   out[i] = in[idx[i]]
+ *              s:  scatter:  out[idx[i]] = in[i]
+ *              t:  transpose a rows x cols array into a cols x rows
+ *                  array
+ *
+ *           idx is a random permutation of 0, 1, ..., n-1.
+ *
+ *           The reversal swaps the pairs (i, n-1-i) for 0 <= i < n/2,
+ *           and the pairs are divided among the threads by blocks, so
+ *           each thread works on a block at the front of the array and
+ *           the matching block at the back.  The gather and scatter
+ *           divide i by blocks, and the transpose divides the rows of
+ *           tiles by blocks.  The operation is repeated REPS times and
+ *           the program reports the best time and the bandwidth in GB/s.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o pth_permute pth_permute.c
+ *              transpose.c -lpthread
+ * Run:      ./pth_permute <thread_count> <r|g|s> <n> [i] [o]
+ *           ./pth_permute <thread_count> t <rows> <cols> [i] [o]
+ *              i:  read the array from stdin.  Otherwise the array is
+ *                  0, 1, 2, ...
+ *              o:  print the input and the result
+ *
+ * Input:    The array (if i is used)
+ * Output:   The result (if o is used), whether it's correct, the
+ *           elapsed time and the bandwidth.
+ *
+ * Notes:
+ * 1.  Storage for the arrays is allocated with posix_memalign, and
+ *     there's no limit on n other than the memory available and the
+ *     range of an int (the indexes in idx are ints).
+ * 2.  If the compiler is targeting AVX2 (e.g. -march=native on a
+ *     recent x86), the reversal swaps blocks of 8 ints, reversing each
+ *     block in a register with a lane permute, and the gather uses the
+ *     AVX2 gather instruction.  There's no AVX2 scatter instruction, so
+ *     the scatter is always scalar.
+ * 3.  Each thread transposes its rows of TILE x TILE tiles with the
+ *     cache-oblivious Transpose_int in transpose.c.  Compile with
+ *     -DTILE=<size> to change the number of rows in a row of tiles.
+ * 4.  The reported bandwidth counts each array that's read or written
+ *     once:  2*n*sizeof(int) bytes for a reversal or transpose, and
+ *     3*n*sizeof(int) for gather and scatter, which also read idx.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "timer.h"
+#include "transpose.h"
+
+#define MEM_ALIGN 64
+#define REPS 10
+#ifndef TILE
+#define TILE 32
+#endif
+
+/* Global variables */
+int     thread_count;
+char    op;
+long    n;              /* Total number of elements */
+int     rows, cols;     /* Only used by transpose   */
+int    *in, *out, *idx;
+int     reps;
+pthread_barrier_t barrier;
+double  best_time;
+
+/* Serial functions */
+void   Usage(char* prog_name);
+void   Get_args(int argc, char* argv[], int* input_p, int* output_p);
+int*   Alloc_array(long count);
+void   Read_arr(int arr[], long count);
+void   Gen_perm(int perm[], long count);
+void   Print_arr(char title[], int arr[], int m, long count);
+int    Check(int orig[]);
+void   Start_threads(void* (*thread_fn)(void*));
+double Run(int the_reps);
+
+/* Parallel functions */
+void   Get_block(long my_rank, long total, long* my_first_p,
+          long* my_last_p);
+void*  Pth_first_touch(void* rank);
+void*  Pth_permute(void* rank);
+void   Reverse(long my_first, long my_last);
+void   Gather(long my_first, long my_last);
+void   Scatter(long my_first, long my_last);
+void   Transpose(long my_first, long my_last);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int    input, output, m;
+   long   i;
+   int*   orig;
+   double elapsed, bytes;
+
+   Get_args(argc, argv, &input, &output);
+   in = Alloc_array(n);
+   out = (op == 'r') ? NULL : Alloc_array(n);
+   idx = (op == 'g' || op == 's') ? Alloc_array(n) : NULL;
+   pthread_barrier_init(&barrier, NULL, thread_count);
+
+   /* Let each thread touch the pages it will use */
+   Start_threads(Pth_first_touch);
+
+   if (input) {
+      printf("Enter the %ld elements of the array\n", n);
+      Read_arr(in, n);
+   } else {
+      for (i = 0; i < n; i++)
+         in[i] = (int) i;
+   }
+   if (idx != NULL) {
+      srandom(1);
+      Gen_perm(idx, n);
+   }
+   m = (op == 't') ? rows : 1;
+   if (output) Print_arr("The input array is", in, m, n);
+
+   /* The reversal is in place, so save a copy to check it */
+   orig = Alloc_array(n);
+   memcpy(orig, in, n*sizeof(int));
+   Run(1);
+   if (output)
+      Print_arr("The result is", op == 'r' ? in : out,
+            op == 't' ? cols : 1, n);
+   if (Check(orig))
+      printf("The result is correct\n");
+   else
+      printf("The result is NOT correct\n");
+   free(orig);
+
+   elapsed = Run(REPS);
+
+   bytes = ((op == 'g' || op == 's') ? 3.0 : 2.0)*n*sizeof(int);
+   printf("Elapsed time = %e seconds\n", elapsed);
+   printf("Bandwidth = %.2f GB/s\n", bytes/elapsed/1.0e9);
+
+   pthread_barrier_destroy(&barrier);
+   free(in);
+   free(out);
+   free(idx);
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   print a message showing what the command line should
+ *            be, and terminate
+ * In arg :   prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <r|g|s> <n> [i] [o]\n",
+         prog_name);
+   fprintf(stderr, "       %s <thread_count> t <rows> <cols> [i] [o]\n",
+         prog_name);
+   fprintf(stderr, "   r:  reverse n ints in place\n");
+   fprintf(stderr, "   g:  gather out[i] = in[idx[i]]\n");
+   fprintf(stderr, "   s:  scatter out[idx[i]] = in[i]\n");
+   fprintf(stderr, "   t:  transpose a rows x cols array\n");
+   fprintf(stderr, "   i:  read the array from stdin\n");
+   fprintf(stderr, "   o:  print the input and the result\n");
+   exit(0);
+}  /* Usage */
+
+
+/*------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check command line args
+ * In args:     argc, argv
+ * Out args:    input_p, output_p
+ * Out globals: thread_count, op, n, rows, cols
+ */
+void Get_args(int argc, char* argv[], int* input_p, int* output_p) {
+   int next;
+
+   if (argc < 4) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   op = argv[2][0];
+   if (thread_count <= 0 || strchr("rgst", op) == NULL || argv[2][1])
+      Usage(argv[0]);
+
+   if (op == 't') {
+      if (argc < 5) Usage(argv[0]);
+      rows = strtol(argv[3], NULL, 10);
+      cols = strtol(argv[4], NULL, 10);
+      if (rows <= 0 || cols <= 0) Usage(argv[0]);
+      n = ((long) rows)*cols;
+      next = 5;
+   } else {
+      n = strtol(argv[3], NULL, 10);
+      if (n <= 0 || n > 0x7fffffff) Usage(argv[0]);
+      next = 4;
+   }
+
+   *input_p = *output_p = 0;
+   for (; next < argc; next++)
+      if (argv[next][0] == 'i')
+         *input_p = 1;
+      else if (argv[next][0] == 'o')
+         *output_p = 1;
+      else
+         Usage(argv[0]);
+}  /* Get_args */
+
+
+/*------------------------------------------------------------------
+ * Function:    Alloc_array
+ * Purpose:     Allocate storage for count ints aligned on a
+ *              MEM_ALIGN-byte boundary
+ * In arg:      count
+ * Ret val:     The new array
+ */
+int* Alloc_array(long count) {
+   void* arr;
+
+   if (posix_memalign(&arr, MEM_ALIGN, count*sizeof(int)) != 0) {
+      fprintf(stderr, "Can't allocate array\n");
+      exit(-1);
+   }
+   return arr;
+}  /* Alloc_array */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Read_arr
+ * Purpose:   Read an array of ints from stdin
+ * In arg:    count, the number of elements in the array
+ * Out arg:   arr
+ */
+void Read_arr(int arr[], long count) {
+   long i;
+
+   for (i = 0; i < count; i++)
+      if (scanf("%d", &arr[i]) != 1) {
+         fprintf(stderr, "Expected %ld elements, got %ld\n", count, i);
+         exit(-1);
+      }
+}  /* Read_arr */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Gen_perm
+ * Purpose:   Generate a random permutation of 0, 1, ..., count-1 with
+ *            a Fisher-Yates shuffle
+ * In arg:    count
+ * Out arg:   perm
+ */
+void Gen_perm(int perm[], long count) {
+   long i, j;
+   int tmp;
+
+   for (i = 0; i < count; i++)
+      perm[i] = (int) i;
+   for (i = count-1; i > 0; i--) {
+      j = ((((long) random()) << 31) | random()) % (i + 1);
+      tmp = perm[i];
+      perm[i] = perm[j];
+      perm[j] = tmp;
+   }
+}  /* Gen_perm */
+
+
+/*---------------------------------------------------------------------
+ * Function:  Print_arr
+ * Purpose:   Print an array of ints to stdout as m rows
+ * In args:   title, arr, m, count
+ */
+void Print_arr(char title[], int arr[], int m, long count) {
+   long i;
+
+   printf("%s\n", title);
+   for (i = 0; i < count; i++) {
+      printf("%d ", arr[i]);
+      if ((i + 1) % (count/m) == 0) printf("\n");
+   }
+}  /* Print_arr */
+
+
+/*---------------------------------------------------------------------
+ * Function:    Check
+ * Purpose:     Check the result of a single run of op
+ * In arg:      orig, a copy of the input array
+ * In globals:  op, n, rows, cols, in, out, idx
+ * Ret val:     1 if the result is correct, 0 otherwise
+ */
+int Check(int orig[]) {
+   long i, j;
+
+   switch (op) {
+      case 'r':
+         for (i = 0; i < n; i++)
+            if (in[i] != orig[n-1-i]) return 0;
+         break;
+      case 'g':
+         for (i = 0; i < n; i++)
+            if (out[i] != orig[idx[i]]) return 0;
+         break;
+      case 's':
+         for (i = 0; i < n; i++)
+            if (out[idx[i]] != orig[i]) return 0;
+         break;
+      case 't':
+         for (i = 0; i < rows; i++)
+            for (j = 0; j < cols; j++)
+               if (out[j*rows + i] != orig[i*cols + j]) return 0;
+         break;
+   }
+   return 1;
+}  /* Check */
+
+
+/*---------------------------------------------------------------------
+ * Function:    Start_threads
+ * Purpose:     Start thread_count threads running thread_fn and
+ *              wait for them to finish
+ * In arg:      thread_fn
+ * In global:   thread_count
+ */
+void Start_threads(void* (*thread_fn)(void*)) {
+   long       thread;
+   pthread_t* thread_handles;
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         thread_fn, (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   free(thread_handles);
+}  /* Start_threads */
+
+
+/*---------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Have each thread carry out op the_reps times, and
+ *              return the best time
+ * In arg:      the_reps
+ * Out global:  reps
+ * Ret val:     The minimum elapsed time over the reps
+ */
+double Run(int the_reps) {
+   reps = the_reps;
+   best_time = 1.0e30;
+   Start_threads(Pth_permute);
+
+   return best_time;
+}  /* Run */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Get_block
+ * Purpose:        Find the block of 0, 1, ..., total-1 assigned to a
+ *                 thread
+ * In args:        my_rank, total
+ * Out args:       my_first_p, my_last_p:  the thread's block is
+ *                 my_first <= i < my_last
+ * Global in var:  thread_count
+ */
+void Get_block(long my_rank, long total, long* my_first_p,
+      long* my_last_p) {
+   long local_n = total/thread_count, rem = total % thread_count;
+
+   if (my_rank < rem) {
+      *my_first_p = my_rank*(local_n + 1);
+      *my_last_p = *my_first_p + local_n + 1;
+   } else {
+      *my_first_p = my_rank*local_n + rem;
+      *my_last_p = *my_first_p + local_n;
+   }
+}  /* Get_block */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Pth_first_touch
+ * Purpose:        Zero the parts of the arrays that this thread will
+ *                 use, so that the pages are allocated near the thread
+ * In arg:         rank
+ * Global in vars: op, n, rows, cols
+ * Global out:     in, out, idx
+ * Note:           The parts of out written by a thread in a transpose
+ *                 are scattered through out, so in that case the
+ *                 thread touches its block of out.
+ */
+void* Pth_first_touch(void* rank) {
+   long my_rank = (long) rank;
+   long my_first, my_last;
+
+   if (op == 'r') {
+      Get_block(my_rank, n/2, &my_first, &my_last);
+      memset(in + my_first, 0, (my_last - my_first)*sizeof(int));
+      memset(in + n - my_last, 0, (my_last - my_first)*sizeof(int));
+      /* The middle element of an odd length array */
+      if (my_rank == thread_count-1 && n % 2 != 0) in[n/2] = 0;
+   } else if (op == 't') {
+      Get_block(my_rank, (rows + TILE - 1)/TILE, &my_first, &my_last);
+      my_first = (my_first*TILE < rows ? my_first*TILE : rows)*cols;
+      my_last = (my_last*TILE < rows ? my_last*TILE : rows)*cols;
+      memset(in + my_first, 0, (my_last - my_first)*sizeof(int));
+      Get_block(my_rank, n, &my_first, &my_last);
+      memset(out + my_first, 0, (my_last - my_first)*sizeof(int));
+   } else {
+      Get_block(my_rank, n, &my_first, &my_last);
+      memset(in + my_first, 0, (my_last - my_first)*sizeof(int));
+      memset(out + my_first, 0, (my_last - my_first)*sizeof(int));
+      memset(idx + my_first, 0, (my_last - my_first)*sizeof(int));
+   }
+
+   return NULL;
+}  /* Pth_first_touch */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Pth_permute
+ * Purpose:        Carry out this thread's part of op reps times.
+ *                 Thread 0 records the best time.
+ * In arg:         rank
+ * Global in vars: op, n, rows, reps, thread_count
+ * Global in/out:  best_time
+ */
+void* Pth_permute(void* rank) {
+   long my_rank = (long) rank;
+   long my_first, my_last;
+   int  rep;
+   double start = 0.0, finish;
+
+   if (op == 'r')
+      Get_block(my_rank, n/2, &my_first, &my_last);
+   else if (op == 't')
+      Get_block(my_rank, (rows + TILE - 1)/TILE, &my_first, &my_last);
+   else
+      Get_block(my_rank, n, &my_first, &my_last);
+
+   for (rep = 0; rep < reps; rep++) {
+      pthread_barrier_wait(&barrier);
+      if (my_rank == 0) GET_TIME(start);
+      switch (op) {
+         case 'r':
+            Reverse(my_first, my_last);
+            break;
+         case 'g':
+            Gather(my_first, my_last);
+            break;
+         case 's':
+            Scatter(my_first, my_last);
+            break;
+         case 't':
+            Transpose(my_first, my_last);
+            break;
+      }
+      pthread_barrier_wait(&barrier);
+      if (my_rank == 0) {
+         GET_TIME(finish);
+         if (finish - start < best_time) best_time = finish - start;
+      }
+   }
+
+   return NULL;
+}  /* Pth_permute */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Reverse
+ * Purpose:        Swap in[i] and in[n-1-i] for my_first <= i < my_last
+ * In args:        my_first, my_last:  my_last <= n/2
+ * Global in var:  n
+ * Global in/out:  in
+ * Note:           With AVX2, the block in[i..i+7] is swapped with
+ *                 in[n-i-8..n-i-1], and each block is reversed in a
+ *                 register.  Since i+8 <= my_last <= n/2, the two
+ *                 blocks don't overlap.
+ */
+void Reverse(long my_first, long my_last) {
+   long i = my_first;
+   int tmp;
+
+#  if defined(__AVX2__)
+   const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+   __m256i front, back;
+
+   for (; i + 8 <= my_last; i += 8) {
+      front = _mm256_loadu_si256((__m256i*) (in + i));
+      back = _mm256_loadu_si256((__m256i*) (in + n - i - 8));
+      _mm256_storeu_si256((__m256i*) (in + i),
+            _mm256_permutevar8x32_epi32(back, rev));
+      _mm256_storeu_si256((__m256i*) (in + n - i - 8),
+            _mm256_permutevar8x32_epi32(front, rev));
+   }
+#  endif
+   for (; i < my_last; i++) {
+      tmp = in[i];
+      in[i] = in[n-1-i];
+      in[n-1-i] = tmp;
+   }
+}  /* Reverse */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Gather
+ * Purpose:        out[i] = in[idx[i]] for my_first <= i < my_last
+ * In args:        my_first, my_last
+ * Global in vars: in, idx
+ * Global out var: out
+ */
+void Gather(long my_first, long my_last) {
+   long i = my_first;
+
+#  if defined(__AVX2__)
+   __m256i vidx;
+
+   for (; i + 8 <= my_last; i += 8) {
+      vidx = _mm256_loadu_si256((__m256i*) (idx + i));
+      _mm256_storeu_si256((__m256i*) (out + i),
+            _mm256_i32gather_epi32(in, vidx, sizeof(int)));
+   }
+#  endif
+   for (; i < my_last; i++)
+      out[i] = in[idx[i]];
+}  /* Gather */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Scatter
+ * Purpose:        out[idx[i]] = in[i] for my_first <= i < my_last
+ * In args:        my_first, my_last
+ * Global in vars: in, idx
+ * Global out var: out
+ */
+void Scatter(long my_first, long my_last) {
+   long i;
+
+   for (i = my_first; i < my_last; i++)
+      out[idx[i]] = in[i];
+}  /* Scatter */
+
+
+/*---------------------------------------------------------------------
+ * Function:       Transpose
+ * Purpose:        out[j*rows + i] = in[i*cols + j] for the rows i in
+ *                 the rows of tiles my_first <= ib < my_last
+ * In args:        my_first, my_last
+ * Global in vars: in, rows, cols
+ * Global out var: out
+ */
+void Transpose(long my_first, long my_last) {
+   long first_row = my_first*TILE;
+   long last_row = (my_last*TILE < rows) ? my_last*TILE : rows;
+
+   if (first_row < last_row)
+      Transpose_int(last_row - first_row, cols, in + first_row*cols, cols,
+            out + first_row, rows);
+}  /* Transpose */
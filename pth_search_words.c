@@ -0,0 +1,562 @@
+/* File:     pth_search_words.c
+ *
+ * Purpose:  Search a text file for every occurrence of each of a
+ *           collection of words.  Print where each word occurs, and
+ *           the total number of occurrences of each word.  This is a
+ *           parallel version of search_word1.c that can search for
+ *           many words at once.  It can also search for every 
+ *           occurrence of a string as a substring of the words.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o pth_search_words 
+ *              pth_search_words.c -lpthread
+ * Usage:    ./pth_search_words <thread_count> w <file> <word> [word ...]
+ *           ./pth_search_words <thread_count> s <file> <string>
+ *           ./pth_search_words <thread_count> b <gigabytes> <string>
+ *              w:  search for whole words
+ *              s:  search for substrings
+ *              b:  benchmark:  generate <gigabytes> of text in memory,
+ *                  search it for <string> using both w and s, and
+ *                  report the bandwidth of each search
+ *
+ * Input:    The text in file
+ * Output:   Location of each occurrence of each search word (or of
+ *              the search string) in the order in which they occur 
+ *              in the text.
+ *           Total number of occurrences of each search word.
+ *           Elapsed time for the search (on stderr).
+ *
+ * Algorithm:
+ * 1.  The file is mapped into memory with mmap.
+ * 2.  The text is divided into thread_count chunks of roughly equal
+ *     size.  Each chunk boundary is moved forward to the start of the
+ *     next word, so that no word is split between two threads.
+ * 3.  The search words are stored in a hash table.  Each thread breaks
+ *     its chunk into words and looks up each word in the table.  It
+ *     records the local subscript of each word that's found, and it
+ *     counts the words in its chunk.
+ * 4.  After the threads are done, the global subscript of a word is
+ *     its local subscript plus the number of words in the earlier
+ *     chunks.
+ * 5.  In substring mode, step 3 is replaced by a scan of the chunk 32
+ *     bytes at a time using AVX2.  For each block, one compare finds
+ *     the positions whose byte matches the first byte of the string, 
+ *     and a second compare, of the block starting len-1 bytes later, 
+ *     finds the positions whose string-length window ends with the 
+ *     last byte of the string.  The AND of the two movemasks gives the 
+ *     candidate positions, and only these are compared with memcmp.
+ *     The same block is also classified as white space or not, and
+ *     the positions at which words start are counted with popcount,
+ *     so the subscript of the word containing each occurrence is
+ *     known without a separate pass.  Without AVX2 the scan is done
+ *     a byte at a time.
+ *
+ * Notes:
+ * 1.  Words searched for should contain no white space
+ * 2.  Words in input text consist of strings separated by white space.
+ *     As in search_word1.c, white space is anything for which isspace
+ *     returns true in the C locale.
+ * 3.  For a single search word the output is the same as the output
+ *     of search_word1.c (without its prompt for input).
+ * 4.  Unlike search_word1.c, there's no limit on the length of a word.
+ * 5.  A substring occurrence is reported by the subscript of the word 
+ *     that contains it.  A word that contains the string more than
+ *     once is reported once for each occurrence.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "timer.h"
+
+/* An entry in the hash table of search words */
+typedef struct {
+   const char* word;   /* NULL if the entry is empty */
+   int         len;
+   int         index;  /* Subscript of the word in search_for */
+} entry_t;
+
+/* An occurrence of a search word in a chunk */
+typedef struct {
+   int  index;         /* Which search word */
+   long word_num;      /* Local subscript of the word in the chunk */
+} match_t;
+
+/* The results of searching one chunk */
+typedef struct {
+   match_t* matches;
+   long     match_count;
+   long     match_max;
+   long     word_count;
+} chunk_result_t;
+
+/* Global variables */
+int      thread_count;
+char     mode;
+char*    text;
+long     text_len;
+char**   search_for;
+int      search_count;
+entry_t* table;
+unsigned table_mask;
+chunk_result_t* results;
+unsigned char is_white[256];
+
+void Usage(char prog_name[]);
+void Map_file(char* file_name);
+void Gen_text(double gigabytes);
+double Run_search(void* (*search_fn)(void*));
+long Total_matches(void);
+void Build_table(void);
+unsigned Hash(const char* word, int len);
+int  Lookup(const char* word, int len);
+long Chunk_start(int rank);
+void Add_match(chunk_result_t* result, int index, long word_num);
+void Print_results(void);
+void* Pth_search(void* rank);
+void* Pth_search_substring(void* rank);
+
+/*-------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int        c;
+   double     elapsed, w_elapsed;
+   long       w_count;
+
+   if (argc < 5) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   mode = argv[2][0];
+   if (thread_count <= 0 || (mode != 'w' && mode != 's' && mode != 'b'))
+      Usage(argv[0]);
+   if (mode != 'w' && argc != 5) Usage(argv[0]);
+   search_for = argv + 4;
+   search_count = argc - 4;
+   if (mode != 'w' && search_for[0][0] == '\0') Usage(argv[0]);
+
+   for (c = 0; c < 256; c++)
+      is_white[c] = (c == ' ' || c == '\t' || c == '\n' || c == '\v' ||
+            c == '\f' || c == '\r');
+   if (mode == 'b')
+      Gen_text(strtod(argv[3], NULL));
+   else
+      Map_file(argv[3]);
+   Build_table();
+   results = calloc(thread_count, sizeof(chunk_result_t));
+
+   if (mode == 'b') {
+      w_elapsed = Run_search(Pth_search);
+      w_count = Total_matches();
+      elapsed = Run_search(Pth_search_substring);
+      printf("%.2f GB of text, %s occurred %ld times as a word, "
+            "%ld times as a substring\n", text_len/1.0e9, search_for[0],
+            w_count, Total_matches());
+      printf("Words:       elapsed time = %e seconds, %.2f GB/s\n",
+            w_elapsed, text_len/w_elapsed/1.0e9);
+      printf("Substrings:  elapsed time = %e seconds, %.2f GB/s\n",
+            elapsed, text_len/elapsed/1.0e9);
+      free(text);
+   } else {
+      elapsed = Run_search(mode == 'w' ? Pth_search : Pth_search_substring);
+      Print_results();
+      fprintf(stderr, "Elapsed time = %e seconds\n", elapsed);
+      if (text_len > 0) munmap(text, text_len);
+   }
+
+   for (c = 0; c < thread_count; c++)
+      free(results[c].matches);
+   free(results);
+   free(table);
+
+   return 0;
+}  /* main */
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program and quit
+ */
+void Usage(char prog_name[]) {
+   fprintf(stderr, "usage: %s <thread_count> w <file> <word> [word ...]\n",
+      prog_name);
+   fprintf(stderr, "       %s <thread_count> s <file> <string>\n",
+      prog_name);
+   fprintf(stderr, "       %s <thread_count> b <gigabytes> <string>\n",
+      prog_name);
+   fprintf(stderr, "   w:  search for whole words\n");
+   fprintf(stderr, "   s:  search for substrings\n");
+   fprintf(stderr, "   b:  benchmark w and s on generated text\n");
+   exit(0);
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:     Run_search
+ * Purpose:      Start the threads running search_fn on their chunks
+ *               and wait for them to finish
+ * In arg:       search_fn
+ * Global out:   results
+ * Ret val:      Elapsed time
+ * Note:         In benchmark mode the matches aren't kept:  only
+ *               match_count is updated
+ */
+double Run_search(void* (*search_fn)(void*)) {
+   long       thread;
+   pthread_t* thread_handles = malloc(thread_count*sizeof(pthread_t));
+   double     start, finish;
+
+   for (thread = 0; thread < thread_count; thread++) {
+      free(results[thread].matches);
+      memset(&results[thread], 0, sizeof(chunk_result_t));
+   }
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL, search_fn,
+            (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+   free(thread_handles);
+
+   return finish - start;
+}  /* Run_search */
+
+/*-------------------------------------------------------------------
+ * Function:     Total_matches
+ * Purpose:      Return the total number of matches in all the chunks
+ * Global in:    results, thread_count
+ */
+long Total_matches(void) {
+   long total = 0;
+   int  t;
+
+   for (t = 0; t < thread_count; t++)
+      total += results[t].match_count;
+   return total;
+}  /* Total_matches */
+
+/*-------------------------------------------------------------------
+ * Function:     Map_file
+ * Purpose:      Map the input file into memory
+ * In arg:       file_name
+ * Out globals:  text, text_len
+ */
+void Map_file(char* file_name) {
+   int fd;
+   struct stat buf;
+
+   fd = open(file_name, O_RDONLY);
+   if (fd < 0 || fstat(fd, &buf) != 0) {
+      fprintf(stderr, "Can't open %s\n", file_name);
+      exit(-1);
+   }
+   text_len = buf.st_size;
+   text = NULL;
+   if (text_len > 0) {
+      text = mmap(NULL, text_len, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (text == MAP_FAILED) {
+         fprintf(stderr, "Can't map %s\n", file_name);
+         exit(-1);
+      }
+      madvise(text, text_len, MADV_SEQUENTIAL);
+   }
+   close(fd);
+}  /* Map_file */
+
+/*-------------------------------------------------------------------
+ * Function:     Gen_text
+ * Purpose:      Generate text for the benchmark:  the first megabyte
+ *               is random words, a few of which contain the search
+ *               string, and the rest of the text is copies of it
+ * In arg:       gigabytes
+ * Out globals:  text, text_len
+ */
+void Gen_text(double gigabytes) {
+   const char* words[] = {"the", "parallel", "of", "memory", "bandwidth",
+      "a", "thread", "process", "cache", "vectorize", "and", "to"};
+   const int word_count = sizeof(words)/sizeof(char*);
+   long block = 1 << 20, i = 0, len, w;
+
+   text_len = (long) (gigabytes*1.0e9);
+   if (text_len < block) text_len = block;
+   text = malloc(text_len);
+   if (text == NULL) {
+      fprintf(stderr, "Can't allocate %ld bytes\n", text_len);
+      exit(-1);
+   }
+
+   srandom(1);
+   while (i < block) {
+      w = random() % (word_count + 1);
+      if (w == word_count) {
+         len = strlen(search_for[0]);
+         if (i + len + 2 > block) break;
+         memcpy(text + i, search_for[0], len);
+         if (random() % 2 == 0) {
+            text[i + len] = 's';  /* a substring, but not a word */
+            len++;
+         }
+      } else {
+         len = strlen(words[w]);
+         if (i + len + 1 > block) break;
+         memcpy(text + i, words[w], len);
+      }
+      i += len;
+      text[i++] = (random() % 8 == 0) ? '\n' : ' ';
+   }
+   memset(text + i, ' ', block - i);
+
+   for (i = block; i < text_len; i += block)
+      memcpy(text + i, text, (text_len - i < block) ? text_len - i : block);
+}  /* Gen_text */
+
+/*-------------------------------------------------------------------
+ * Function:     Hash
+ * Purpose:      FNV-1a hash of a word
+ */
+unsigned Hash(const char* word, int len) {
+   unsigned h = 2166136261u;
+   int i;
+
+   for (i = 0; i < len; i++) {
+      h ^= (unsigned char) word[i];
+      h *= 16777619u;
+   }
+   return h;
+}  /* Hash */
+
+/*-------------------------------------------------------------------
+ * Function:     Build_table
+ * Purpose:      Insert the search words into an open addressing hash
+ *               table with at least twice as many entries as words
+ * In globals:   search_for, search_count
+ * Out globals:  table, table_mask
+ * Note:         If a word is repeated on the command line, only its
+ *               first occurrence is inserted
+ */
+void Build_table(void) {
+   unsigned size = 2, h;
+   int w, len;
+
+   while (size < 2*search_count) size *= 2;
+   table = calloc(size, sizeof(entry_t));
+   table_mask = size - 1;
+   for (w = 0; w < search_count; w++) {
+      len = strlen(search_for[w]);
+      if (Lookup(search_for[w], len) >= 0) continue;
+      h = Hash(search_for[w], len) & table_mask;
+      while (table[h].word != NULL)
+         h = (h + 1) & table_mask;
+      table[h].word = search_for[w];
+      table[h].len = len;
+      table[h].index = w;
+   }
+}  /* Build_table */
+
+/*-------------------------------------------------------------------
+ * Function:     Lookup
+ * Purpose:      Find a word in the hash table
+ * Ret val:      The subscript of the word in search_for, or -1 if
+ *               it isn't a search word
+ */
+int Lookup(const char* word, int len) {
+   unsigned h = Hash(word, len) & table_mask;
+
+   while (table[h].word != NULL) {
+      if (table[h].len == len && memcmp(table[h].word, word, len) == 0)
+         return table[h].index;
+      h = (h + 1) & table_mask;
+   }
+   return -1;
+}  /* Lookup */
+
+/*-------------------------------------------------------------------
+ * Function:     Chunk_start
+ * Purpose:      Find the subscript of the first character of a
+ *               thread's chunk:  the first word that starts at or
+ *               after rank*text_len/thread_count
+ * Note:         Position 0 belongs to thread 0.  So if the text is
+ *               shorter than thread_count, and rank*text_len/thread_count
+ *               rounds down to 0, the search starts at 1.  This keeps
+ *               the chunks from overlapping, and text[start-1] in
+ *               the text.
+ */
+long Chunk_start(int rank) {
+   long start;
+
+   if (rank == 0) return 0;
+   if (rank == thread_count) return text_len;
+   start = (long) (((double) rank)*text_len/thread_count);
+   if (start < 1) start = 1;
+   if (start > text_len) return text_len;
+   while (start < text_len && !is_white[(unsigned char) text[start-1]])
+      start++;
+   return start;
+}  /* Chunk_start */
+
+/*-------------------------------------------------------------------
+ * Function:     Add_match
+ * Purpose:      Append an occurrence to a chunk's list of matches
+ */
+void Add_match(chunk_result_t* result, int index, long word_num) {
+   if (result->match_count == result->match_max) {
+      result->match_max = (result->match_max == 0) ?
+         1024 : 2*result->match_max;
+      result->matches = realloc(result->matches,
+            result->match_max*sizeof(match_t));
+   }
+   result->matches[result->match_count].index = index;
+   result->matches[result->match_count].word_num = word_num;
+   result->match_count++;
+}  /* Add_match */
+
+/*-------------------------------------------------------------------
+ * Function:     Pth_search
+ * Purpose:      Find the search words in a thread's chunk of text
+ * In arg:       rank
+ * Globals in:   text, table, thread_count
+ * Global out:   results[rank]
+ */
+void* Pth_search(void* rank) {
+   long my_rank = (long) rank;
+   long i = Chunk_start(my_rank), my_end = Chunk_start(my_rank + 1);
+   long word_start;
+   int  index;
+   chunk_result_t* my_result = &results[my_rank];
+
+   while (i < my_end) {
+      while (i < my_end && is_white[(unsigned char) text[i]]) i++;
+      if (i == my_end) break;
+      word_start = i;
+      while (i < my_end && !is_white[(unsigned char) text[i]]) i++;
+      index = Lookup(text + word_start, i - word_start);
+      if (index >= 0) {
+         if (mode == 'b')
+            my_result->match_count++;
+         else
+            Add_match(my_result, index, my_result->word_count);
+      }
+      my_result->word_count++;
+   }
+
+   return NULL;
+}  /* Pth_search */
+
+/*-------------------------------------------------------------------
+ * Function:     Pth_search_substring
+ * Purpose:      Find the occurrences of search_for[0] in a thread's 
+ *               chunk of text.  See Algorithm, note 5 above.
+ * In arg:       rank
+ * Globals in:   text, text_len, search_for, thread_count, mode
+ * Global out:   results[rank]
+ */
+void* Pth_search_substring(void* rank) {
+   long my_rank = (long) rank;
+   long i = Chunk_start(my_rank), my_end = Chunk_start(my_rank + 1);
+   const char* pat = search_for[0];
+   int  len = strlen(pat), prev_white;
+   chunk_result_t* my_result = &results[my_rank];
+#  if defined(__AVX2__)
+   __m256i first = _mm256_set1_epi8(pat[0]);
+   __m256i last = _mm256_set1_epi8(pat[len-1]);
+   __m256i space = _mm256_set1_epi8(' ');
+   __m256i nine = _mm256_set1_epi8(9);
+   __m256i four = _mm256_set1_epi8(4);
+   __m256i blk_first, blk_last, low;
+   unsigned cand, white, starts, carry;
+   int bit;
+
+   /* 1 if the byte before the current block is not white space */
+   carry = (i > 0 && !is_white[(unsigned char) text[i-1]]);
+   while (i + 32 <= my_end && i + len + 31 <= text_len) {
+      blk_first = _mm256_loadu_si256((const __m256i*) (text + i));
+      blk_last = _mm256_loadu_si256((const __m256i*) (text + i + len - 1));
+      cand = _mm256_movemask_epi8(_mm256_and_si256(
+               _mm256_cmpeq_epi8(first, blk_first),
+               _mm256_cmpeq_epi8(last, blk_last)));
+
+      /* White space is ' ' or '\t' ... '\r' = 9 ... 13 */
+      low = _mm256_sub_epi8(blk_first, nine);
+      white = _mm256_movemask_epi8(_mm256_or_si256(
+               _mm256_cmpeq_epi8(blk_first, space),
+               _mm256_cmpeq_epi8(_mm256_min_epu8(low, four), low)));
+      starts = ~white & ~((~white << 1) | carry);
+      carry = (~white) >> 31;
+
+      while (cand != 0) {
+         bit = __builtin_ctz(cand);
+         if (len <= 2 || memcmp(text + i + bit + 1, pat + 1, len - 2) == 0) {
+            if (mode == 'b')
+               my_result->match_count++;
+            else
+               /* Words starting at or before i + bit, less 1 */
+               Add_match(my_result, 0, my_result->word_count + 
+                     __builtin_popcount(starts & (0xffffffffu >> (31-bit)))
+                     - 1);
+         }
+         cand &= cand - 1;
+      }
+      my_result->word_count += __builtin_popcount(starts);
+      i += 32;
+   }
+#  endif
+
+   /* Finish the chunk a byte at a time */
+   prev_white = (i == 0 || is_white[(unsigned char) text[i-1]]);
+   for ( ; i < my_end; i++) {
+      if (is_white[(unsigned char) text[i]]) {
+         prev_white = 1;
+         continue;
+      }
+      if (prev_white) my_result->word_count++;
+      prev_white = 0;
+      if (text[i] == pat[0] && i + len <= my_end &&
+            memcmp(text + i, pat, len) == 0) {
+         if (mode == 'b')
+            my_result->match_count++;
+         else
+            Add_match(my_result, 0, my_result->word_count - 1);
+      }
+   }
+
+   return NULL;
+}  /* Pth_search_substring */
+
+/*-------------------------------------------------------------------
+ * Function:     Print_results
+ * Purpose:      Print the occurrences in the order in which they
+ *               occur in the text, and the number of occurrences of
+ *               each search word
+ * Globals in:   results, search_for, search_count, thread_count
+ */
+void Print_results(void) {
+   long* counts = calloc(search_count, sizeof(long));
+   long  words_before = 0, m;
+   int   t, w, len;
+   chunk_result_t* result;
+
+   for (t = 0; t < thread_count; t++) {
+      result = &results[t];
+      for (m = 0; m < result->match_count; m++) {
+         w = result->matches[m].index;
+         if (mode == 'w')
+            printf("%s is word %ld\n", search_for[w],
+                  words_before + result->matches[m].word_num);
+         else
+            printf("%s occurs in word %ld\n", search_for[w],
+                  words_before + result->matches[m].word_num);
+         counts[w]++;
+      }
+      words_before += result->word_count;
+   }
+
+   for (w = 0; w < search_count; w++) {
+      len = strlen(search_for[w]);
+      printf("%s occurred %ld times in the input\n", search_for[w],
+            counts[Lookup(search_for[w], len)]);
+   }
+   free(counts);
+}  /* Print_results */
@@ -0,0 +1,345 @@
+/* File:     region_timer.c
+ *
+ * Purpose:  Implement the region timer declared in region_timer.h
+ *
+ * Compile:  Link with a program compiled with -DREGIONS (see
+ *           region_timer.h).  Needs -lpthread.
+ *
+ * Data structures:
+ *    Each thread has a thread_table_t, which is created the first
+ *    time the thread calls Region_begin.  The table lists the regions
+ *    the thread has entered, in the order in which it first entered
+ *    them:  each region_t stores the subscript of its enclosing region
+ *    and its samples.  The thread also keeps a stack of the regions
+ *    it's currently in.  The tables are linked into a global list
+ *    (protected by a mutex) so that they can be found at exit.
+ *
+ *    At exit the regions in the different threads' tables are merged
+ *    by name and enclosing region, and the merged regions are printed
+ *    depth-first.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timer.h"
+#include "region_timer.h"
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(REGION_NO_TSC)
+#include <x86intrin.h>
+#define REGION_USE_TSC
+#endif
+
+typedef struct {
+   const char* name;
+   int      parent;        /* -1 for a top level region */
+   long     count;         /* Number of samples */
+   double   total, min, max;
+   double*  samples;
+   long     sample_max;
+   double   start;         /* Start of the current sample */
+} region_t;
+
+typedef struct thread_table_s {
+   region_t* regions;
+   int       region_count, region_max;
+   int       stack[REGION_MAX_DEPTH];
+   int       depth;
+   struct thread_table_s* next;
+} thread_table_t;
+
+/* A region in the merged table printed at exit */
+typedef struct {
+   const char* name;
+   int      parent;
+   int      threads;
+   long     count;
+   double   total, max_thread_total, min, max;
+   double*  samples;
+   long     sample_count;
+} merged_t;
+
+static __thread thread_table_t* my_table = NULL;
+static thread_table_t* all_tables = NULL;
+static pthread_mutex_t tables_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+#ifdef REGION_USE_TSC
+static double tsc_secs_per_tick;
+static unsigned long long tsc_base;
+#endif
+
+static void Init(void);
+static void Report_at_exit(void);
+static thread_table_t* Get_table(void);
+static int  Find_region(thread_table_t* table, const char* name,
+      int parent);
+static int  Compare_doubles(const void* x_p, const void* y_p);
+static void Print_merged(FILE* fp, merged_t merged[], int merged_count,
+      int parent, int depth);
+
+/*-------------------------------------------------------------------
+ * Function:    Init
+ * Purpose:     Calibrate rdtsc, and arrange for the report to be
+ *              printed at exit.  Called once.
+ */
+static void Init(void) {
+#  ifdef REGION_USE_TSC
+   double start, finish;
+   unsigned long long t0, t1;
+
+   GET_TIME(start);
+   t0 = __rdtsc();
+   do {
+      GET_TIME(finish);
+   } while (finish - start < 0.01);
+   t1 = __rdtsc();
+   tsc_secs_per_tick = (finish - start)/(t1 - t0);
+   tsc_base = t0;
+#  endif
+   atexit(Report_at_exit);
+}  /* Init */
+
+/*-------------------------------------------------------------------
+ * Function:    Region_now
+ * Purpose:     Return the current time in seconds
+ */
+double Region_now(void) {
+#  ifdef REGION_USE_TSC
+   pthread_once(&init_once, Init);
+   return (__rdtsc() - tsc_base)*tsc_secs_per_tick;
+#  else
+   double now;
+
+   GET_TIME(now);
+   return now;
+#  endif
+}  /* Region_now */
+
+/*-------------------------------------------------------------------
+ * Function:    Get_table
+ * Purpose:     Return the calling thread's table, creating it if
+ *              necessary
+ */
+static thread_table_t* Get_table(void) {
+   if (my_table == NULL) {
+      pthread_once(&init_once, Init);
+      my_table = calloc(1, sizeof(thread_table_t));
+      pthread_mutex_lock(&tables_mutex);
+      my_table->next = all_tables;
+      all_tables = my_table;
+      pthread_mutex_unlock(&tables_mutex);
+   }
+   return my_table;
+}  /* Get_table */
+
+/*-------------------------------------------------------------------
+ * Function:    Find_region
+ * Purpose:     Find the region with the given name and parent in the
+ *              table, adding it if it isn't there
+ * Ret val:     The subscript of the region
+ */
+static int Find_region(thread_table_t* table, const char* name,
+      int parent) {
+   int r;
+   region_t* region;
+
+   for (r = table->region_count - 1; r >= 0; r--)
+      if (table->regions[r].parent == parent &&
+            (table->regions[r].name == name ||
+             strcmp(table->regions[r].name, name) == 0))
+         return r;
+
+   if (table->region_count == table->region_max) {
+      table->region_max = (table->region_max == 0) ? 16 :
+         2*table->region_max;
+      table->regions = realloc(table->regions,
+            table->region_max*sizeof(region_t));
+   }
+   region = &table->regions[table->region_count];
+   memset(region, 0, sizeof(region_t));
+   region->name = name;
+   region->parent = parent;
+   region->min = 1.0e300;
+   return table->region_count++;
+}  /* Find_region */
+
+/*-------------------------------------------------------------------
+ * Function:    Region_begin
+ * Purpose:     Start a sample of the region name
+ */
+void Region_begin(const char* name) {
+   thread_table_t* table = Get_table();
+   int parent = (table->depth > 0) ? table->stack[table->depth-1] : -1;
+   int r = Find_region(table, name, parent);
+
+   if (table->depth == REGION_MAX_DEPTH) {
+      fprintf(stderr, "Region_begin:  regions nested too deeply at %s\n",
+            name);
+      exit(-1);
+   }
+   table->stack[table->depth++] = r;
+   table->regions[r].start = Region_now();
+}  /* Region_begin */
+
+/*-------------------------------------------------------------------
+ * Function:    Region_end
+ * Purpose:     End the current sample of the region name
+ */
+void Region_end(const char* name) {
+   double now = Region_now(), elapsed;
+   thread_table_t* table = Get_table();
+   region_t* region;
+
+   if (table->depth == 0) {
+      fprintf(stderr, "Region_end:  %s isn't open\n", name);
+      return;
+   }
+   region = &table->regions[table->stack[--table->depth]];
+   if (strcmp(region->name, name) != 0)
+      fprintf(stderr, "Region_end:  ending %s, but %s is innermost\n",
+            name, region->name);
+
+   elapsed = now - region->start;
+   region->count++;
+   region->total += elapsed;
+   if (elapsed < region->min) region->min = elapsed;
+   if (elapsed > region->max) region->max = elapsed;
+   if (region->count <= REGION_MAX_SAMPLES) {
+      if (region->count > region->sample_max) {
+         region->sample_max = (region->sample_max == 0) ? 64 :
+            2*region->sample_max;
+         region->samples = realloc(region->samples,
+               region->sample_max*sizeof(double));
+      }
+      region->samples[region->count-1] = elapsed;
+   }
+}  /* Region_end */
+
+/*-------------------------------------------------------------------
+ * Function:    Compare_doubles
+ * Purpose:     Compare two doubles for qsort
+ */
+static int Compare_doubles(const void* x_p, const void* y_p) {
+   double x = *((double*) x_p);
+   double y = *((double*) y_p);
+
+   if (x < y)
+      return -1;
+   else if (x == y)
+      return 0;
+   else /* x > y */
+      return 1;
+}  /* Compare_doubles */
+
+/*-------------------------------------------------------------------
+ * Function:    Print_merged
+ * Purpose:     Print the merged regions with the given parent, each
+ *              followed by the regions it encloses
+ */
+static void Print_merged(FILE* fp, merged_t merged[], int merged_count,
+      int parent, int depth) {
+   int r;
+   merged_t* reg;
+   double median;
+   char median_str[32];
+
+   for (r = 0; r < merged_count; r++) {
+      reg = &merged[r];
+      if (reg->parent != parent) continue;
+      if (reg->sample_count == 0) {
+         /* No samples kept:  never ended, or REGION_MAX_SAMPLES is 0 */
+         snprintf(median_str, sizeof(median_str), "%11s", "-");
+      } else {
+         qsort(reg->samples, reg->sample_count, sizeof(double),
+               Compare_doubles);
+         if (reg->sample_count % 2 == 1)
+            median = reg->samples[reg->sample_count/2];
+         else
+            median = (reg->samples[reg->sample_count/2 - 1] +
+                  reg->samples[reg->sample_count/2])/2.0;
+         snprintf(median_str, sizeof(median_str), "%11.4e", median);
+      }
+      fprintf(fp, "%*s%-*s %7d %10ld %11.4e %11.4e %11.4e %s %11.4e\n",
+            2*depth, "", 24 - 2*depth, reg->name, reg->threads,
+            reg->count, reg->total, reg->max_thread_total, reg->min,
+            median_str, reg->max);
+      Print_merged(fp, merged, merged_count, r, depth + 1);
+   }
+}  /* Print_merged */
+
+/*-------------------------------------------------------------------
+ * Function:    Region_report
+ * Purpose:     Merge the regions in all the threads' tables and
+ *              print the summary table
+ * Note:        Should only be called when no thread is timing
+ */
+void Region_report(FILE* fp) {
+   thread_table_t* table;
+   merged_t* merged = NULL;
+   int merged_count = 0, merged_max = 0, r, m, parent;
+   int* map;
+   region_t* reg;
+   long kept;
+
+   pthread_mutex_lock(&tables_mutex);
+   for (table = all_tables; table != NULL; table = table->next) {
+      /* map[r] is the merged region for region r of this table */
+      map = malloc((table->region_count + 1)*sizeof(int));
+      for (r = 0; r < table->region_count; r++) {
+         reg = &table->regions[r];
+         parent = (reg->parent < 0) ? -1 : map[reg->parent];
+         for (m = 0; m < merged_count; m++)
+            if (merged[m].parent == parent &&
+                  strcmp(merged[m].name, reg->name) == 0)
+               break;
+         if (m == merged_count) {
+            if (merged_count == merged_max) {
+               merged_max = (merged_max == 0) ? 16 : 2*merged_max;
+               merged = realloc(merged, merged_max*sizeof(merged_t));
+            }
+            memset(&merged[m], 0, sizeof(merged_t));
+            merged[m].name = reg->name;
+            merged[m].parent = parent;
+            merged[m].min = 1.0e300;
+            merged_count++;
+         }
+         map[r] = m;
+
+         kept = (reg->count < REGION_MAX_SAMPLES) ? reg->count :
+            REGION_MAX_SAMPLES;
+         if (kept > 0) {
+            merged[m].samples = realloc(merged[m].samples,
+                  (merged[m].sample_count + kept)*sizeof(double));
+            memcpy(merged[m].samples + merged[m].sample_count,
+                  reg->samples, kept*sizeof(double));
+            merged[m].sample_count += kept;
+         }
+         merged[m].threads++;
+         merged[m].count += reg->count;
+         merged[m].total += reg->total;
+         if (reg->total > merged[m].max_thread_total)
+            merged[m].max_thread_total = reg->total;
+         if (reg->min < merged[m].min) merged[m].min = reg->min;
+         if (reg->max > merged[m].max) merged[m].max = reg->max;
+      }
+      free(map);
+   }
+   pthread_mutex_unlock(&tables_mutex);
+
+   if (merged_count == 0) return;
+   fprintf(fp, "%-24s %7s %10s %11s %11s %11s %11s %11s\n", "Region",
+         "Threads", "Samples", "Total", "Max thread", "Min", "Median",
+         "Max");
+   Print_merged(fp, merged, merged_count, -1, 0);
+
+   for (m = 0; m < merged_count; m++)
+      free(merged[m].samples);
+   free(merged);
+}  /* Region_report */
+
+/*-------------------------------------------------------------------
+ * Function:    Report_at_exit
+ * Purpose:     Print the summary to stderr when the program exits
+ */
+static void Report_at_exit(void) {
+   Region_report(stderr);
+}  /* Report_at_exit */
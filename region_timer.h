@@ -0,0 +1,71 @@
+/* File:     region_timer.h
+ *
+ * Purpose:  Time named regions of a program.  Regions can be nested,
+ *           and each thread keeps its own times, so no locking is
+ *           needed while timing.  Each execution of a region is one
+ *           sample.  When the program exits, a table is printed to
+ *           stderr that shows, for each region, the number of threads
+ *           that executed it, the number of samples, the total time,
+ *           the largest total time for a single thread, and the
+ *           minimum, median, and maximum time of a sample.
+ *
+ * Compile:  Compile the program with -DREGIONS and link with
+ *           region_timer.c, e.g.
+ *           gcc -g -Wall -DREGIONS -o pth_bitonic pth_bitonic.c
+ *              region_timer.c -lpthread
+ *           Without -DREGIONS the macros expand to nothing, and
+ *           region_timer.c isn't needed.
+ *
+ * Example:
+ *    #include "region_timer.h"
+ *    . . .
+ *    REGION_BEGIN("sort");
+ *    for (phase = 0; phase < p; phase++) {
+ *       REGION_BEGIN("merge");
+ *       . . .
+ *       REGION_END("merge");
+ *    }
+ *    REGION_END("sort");
+ *
+ * Notes:
+ * 1.  Regions are identified by their names and the regions that
+ *     enclose them:  "merge" inside "sort" is different from "merge"
+ *     at the top level.  In the table, nested regions are indented
+ *     under the enclosing region.
+ * 2.  REGION_END should be called with the name of the innermost
+ *     open region.  If it isn't, a warning is printed.
+ * 3.  On x86 the times are taken with rdtsc, which is calibrated
+ *     against clock_gettime the first time it's used.  This assumes
+ *     the processor has an invariant TSC (all recent x86 processors
+ *     do).  Compile with -DREGION_NO_TSC to always use clock_gettime
+ *     (see timer.h).
+ * 4.  At most REGION_MAX_SAMPLES samples are kept for each region on
+ *     each thread.  After that the min, max, and total are still
+ *     updated, but the median is computed from the samples kept.
+ *     Compile with -DREGION_MAX_SAMPLES=<count> to change the limit.
+ *     If no samples are kept, the median is printed as "-".
+ */
+#ifndef _REGION_TIMER_H_
+#define _REGION_TIMER_H_
+
+#include <stdio.h>
+
+#define REGION_MAX_DEPTH 32
+#ifndef REGION_MAX_SAMPLES
+#define REGION_MAX_SAMPLES (1 << 20)
+#endif
+
+void   Region_begin(const char* name);
+void   Region_end(const char* name);
+double Region_now(void);
+void   Region_report(FILE* fp);
+
+#ifdef REGIONS
+#define REGION_BEGIN(name) Region_begin(name)
+#define REGION_END(name) Region_end(name)
+#else
+#define REGION_BEGIN(name)
+#define REGION_END(name)
+#endif
+
+#endif
@@ -4,26 +4,31 @@
  * Compile:  gcc -g -Wall -o reverse reverse.c
  * Run:      ./reverse
  *
- * Input:    The number of elements in the array (<= 20) and the elements
+ * Input:    The number of elements in the array and the elements
  *           of the array.
  * Output:   The input array and the array with the elements reversed.
  *
- * Note:     The maximum number of elements in the array is 20.
+ * Note:     Storage for the array is allocated with malloc, so there's
+ *           no limit on the number of elements.  For a parallel
+ *           version that reverses very large arrays, see pth_permute.c.
  */
 #include <stdio.h>
-
-const int MAX_ARR = 20;
+#include <stdlib.h>
 
 void Read_arr(int arr[], int n);
 void Reverse_arr(int arr[], int n);
 void Print_arr(int arr[], int n);
 
 int main(void) {
-   int arr[MAX_ARR];
+   int* arr;
    int n;
 
    printf("How many elements in the array?\n");
-   scanf("%d", &n);
+   if (scanf("%d", &n) != 1 || n < 0) {
+      fprintf(stderr, "The number of elements should be >= 0\n");
+      return 1;
+   }
+   arr = malloc((n + 1)*sizeof(int));
    printf("Enter the elements of the array\n");
    Read_arr(arr, n);
    printf("The original array is\n");
@@ -34,6 +39,7 @@ int main(void) {
    printf("The array with the elements reversed is\n");
    Print_arr(arr, n);
 
+   free(arr);
    return 0;
 }  /* main */
 
@@ -0,0 +1,158 @@
+/* File:     sort_bench.c
+ *
+ * Purpose:  Compare the time taken by the qsort library function, the
+ *           sorting networks Net_sort, and the quicksort/mergesort
+ *           hybrid Hybrid_sort to sort lists of random ints of various
+ *           sizes.  See sort_net.h.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o sort_bench sort_bench.c
+ *              sort_net.c
+ * Run:      ./sort_bench [n ...]
+ *              n:  the number of ints in a list (default 8 16 32 64 100
+ *                 1000 10000 100000)
+ *
+ * Input:    None
+ * Output:   For each n, the best time over REPS runs of each sort, in
+ *           nanoseconds per list, the speedup of Hybrid_sort over qsort,
+ *           and whether the sorts agree with qsort.  Net_sort is only
+ *           timed if n <= SORT_NET_MAX.
+ *
+ * Notes:
+ * 1.  Each run sorts TOTAL/n lists (at least 1), so the times of short
+ *     lists aren't dominated by the timer.  The lists are restored from
+ *     a copy between runs, and the copying isn't timed.
+ * 2.  The ints are in the range 0 to RMAX-1.  Compile with -DRMAX=100
+ *     to time lists with many duplicates, like the lists in
+ *     parallel_odd_even.c.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+#include "sort_net.h"
+
+#define REPS 3
+#define TOTAL (1 << 22)
+#ifndef RMAX
+#define RMAX 1000000000
+#endif
+
+typedef enum {QSORT, NET, HYBRID} method_t;
+
+void   Usage(char* prog_name);
+int    Compare(const void* a_p, const void* b_p);
+double Run(method_t method, int lists[], const int orig[], int n,
+         int count);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   int default_sizes[] = {8, 16, 32, 64, 100, 1000, 10000, 100000};
+   int *sizes = default_sizes, size_count = 8;
+   int s, n, count, ok;
+   size_t i, total;
+   int *orig, *lists, *expected;
+   double q_time, net_time = 0.0, hybrid_time;
+
+   if (argc > 1) {
+      size_count = argc - 1;
+      sizes = malloc(size_count*sizeof(int));
+      for (s = 0; s < size_count; s++) {
+         sizes[s] = strtol(argv[s+1], NULL, 10);
+         if (sizes[s] <= 0) Usage(argv[0]);
+      }
+   }
+
+   printf("       n      qsort   Net_sort     Hybrid  speedup\n");
+   for (s = 0; s < size_count; s++) {
+      n = sizes[s];
+      count = (TOTAL/n > 0) ? TOTAL/n : 1;
+      total = ((size_t) n)*count;
+      orig = malloc(total*sizeof(int));
+      lists = malloc(total*sizeof(int));
+      expected = malloc(total*sizeof(int));
+      srandom(1);
+      for (i = 0; i < total; i++)
+         orig[i] = random() % RMAX;
+
+      q_time = Run(QSORT, lists, orig, n, count);
+      memcpy(expected, lists, total*sizeof(int));
+      ok = 1;
+      if (n <= SORT_NET_MAX) {
+         net_time = Run(NET, lists, orig, n, count);
+         ok = ok && memcmp(lists, expected, total*sizeof(int)) == 0;
+      }
+      hybrid_time = Run(HYBRID, lists, orig, n, count);
+      ok = ok && memcmp(lists, expected, total*sizeof(int)) == 0;
+
+      printf("%8d  %9.1f  ", n, 1.0e9*q_time/count);
+      if (n <= SORT_NET_MAX)
+         printf("%9.1f  ", 1.0e9*net_time/count);
+      else
+         printf("%9s  ", "-");
+      printf("%9.1f  %7.2f%s\n", 1.0e9*hybrid_time/count,
+            q_time/hybrid_time, ok ? "" : "  RESULTS DIFFER");
+
+      free(orig);
+      free(lists);
+      free(expected);
+   }
+
+   if (sizes != default_sizes) free(sizes);
+   return 0;
+}  /* main */
+
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print a message showing how to run the program and quit
+ * In arg:    prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s [n ...]\n", prog_name);
+   exit(0);
+}  /* Usage */
+
+/*-------------------------------------------------------------------
+ * Function:    Compare
+ * Purpose:     Compare 2 ints, return -1, 0, or 1, respectively, when
+ *              the first int is less than, equal, or greater than
+ *              the second.  Used by qsort.
+ */
+int Compare(const void* a_p, const void* b_p) {
+   int a = *((int*)a_p);
+   int b = *((int*)b_p);
+
+   if (a < b)
+      return -1;
+   else if (a == b)
+      return 0;
+   else /* a > b */
+      return 1;
+}  /* Compare */
+
+/*-------------------------------------------------------------------
+ * Function:  Run
+ * Purpose:   Sort each of the count lists of n ints REPS times with
+ *            method, and return the best time
+ * In args:   method, orig, n, count
+ * Out arg:   lists:  the sorted lists
+ */
+double Run(method_t method, int lists[], const int orig[], int n,
+      int count) {
+   double start, finish, best = 1.0e30;
+   int rep, l;
+
+   for (rep = 0; rep < REPS; rep++) {
+      memcpy(lists, orig, ((size_t) n)*count*sizeof(int));
+      GET_TIME(start);
+      for (l = 0; l < count; l++)
+         if (method == QSORT)
+            qsort(lists + ((size_t) l)*n, n, sizeof(int), Compare);
+         else if (method == NET)
+            Net_sort(lists + ((size_t) l)*n, n);
+         else
+            Hybrid_sort(lists + ((size_t) l)*n, n);
+      GET_TIME(finish);
+      if (finish - start < best) best = finish - start;
+   }
+   return best;
+}  /* Run */
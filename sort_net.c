@@ -0,0 +1,337 @@
+/* File:     sort_net.c
+ *
+ * Purpose:  Implement bitonic sorting networks for up to 64 ints, and a
+ *           quicksort/mergesort hybrid that uses them for its leaves.
+ *           See sort_net.h.
+ *
+ * Compile:  Compile and link with a program that uses the sorts, e.g.
+ *           gcc -g -Wall -O3 -march=native -o sort_bench sort_bench.c
+ *              sort_net.c
+ *
+ * Algorithm (AVX2 network for 8*vecs ints, vecs = 1, 2, 4, or 8):
+ *    Load the ints into vecs registers of 8 ints
+ *    Sort each register with a bitonic network on its lanes
+ *    for (w = 1; w < vecs; w *= 2)
+ *       for each pair of adjacent sorted runs A, B of w registers
+ *          Compare A with B reversed:  the smaller ints of each
+ *             pair go in A, and the larger in B.  Now A and B are
+ *             bitonic, and every int in A is <= every int in B.
+ *          Bitonic merge A and B:  compare-exchange registers w/2,
+ *             w/4, ..., 1 apart, and then lanes 4, 2, 1 apart in
+ *             each register
+ *    Store the registers
+ *
+ * Notes:
+ * 1.  A compare-exchange of the lanes of a register v that are j apart
+ *     computes min and max of v and v with its lanes permuted, and
+ *     blends them:  the immediate argument of the blend has bit i set
+ *     if lane i gets the max.
+ * 2.  A list whose size isn't 8, 16, 32, or 64 is padded with INT_MAX,
+ *     so the padding ends up at the end.  With AVX2 the padding is
+ *     only in the registers:  the last, partial, register is loaded
+ *     and stored with a mask.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "sort_net.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if SORT_LEAF > SORT_NET_MAX
+#error "SORT_LEAF can't be more than SORT_NET_MAX"
+#endif
+
+static void Network(int a[], int n, int vecs);
+static void Quicksort(int a[], int n, int depth);
+static int  Partition(int a[], int n);
+static void Mergesort(int a[], int n);
+static void Merge(const int A[], int m, const int B[], int k, int C[]);
+
+#if defined(__AVX2__)
+/* Compare-exchange the lanes of v that are 1, 2, or 4 apart */
+#define STEP(v, partner, imm)                                           \
+   _mm256_blend_epi32(_mm256_min_epi32(v, partner),                     \
+         _mm256_max_epi32(v, partner), imm)
+#define SWAP1(v) _mm256_shuffle_epi32(v, 0xB1)
+#define SWAP2(v) _mm256_shuffle_epi32(v, 0x4E)
+#define SWAP4(v) _mm256_permute2x128_si256(v, v, 0x01)
+
+/*-------------------------------------------------------------------
+ * Function:   Merge8
+ * Purpose:    Sort the lanes of a register whose lanes are a bitonic
+ *             sequence
+ * In arg:     v
+ * Ret val:    v sorted
+ */
+static inline __m256i Merge8(__m256i v) {
+   v = STEP(v, SWAP4(v), 0xF0);
+   v = STEP(v, SWAP2(v), 0xCC);
+   return STEP(v, SWAP1(v), 0xAA);
+}  /* Merge8 */
+
+/*-------------------------------------------------------------------
+ * Function:   Sort8
+ * Purpose:    Sort the lanes of a register:  make ascending and
+ *             descending pairs, then ascending and descending
+ *             quadruples, then merge the bitonic octuple
+ * In arg:     v
+ * Ret val:    v sorted
+ */
+static inline __m256i Sort8(__m256i v) {
+   v = STEP(v, SWAP1(v), 0x66);
+   v = STEP(v, SWAP2(v), 0x3C);
+   v = STEP(v, SWAP1(v), 0x5A);
+   return Merge8(v);
+}  /* Sort8 */
+
+/*-------------------------------------------------------------------
+ * Function:   Network
+ * Purpose:    Sort n ints with the network for 8*vecs ints in
+ *             registers.  The lanes past n are set to INT_MAX, and a
+ *             partial register is loaded and stored with a mask.
+ * In args:    n:  n <= 8*vecs
+ *             vecs:  1, 2, 4, or 8
+ * In/out arg: a
+ */
+static void Network(int a[], int n, int vecs) {
+   const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+   const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+   __m256i v[SORT_NET_MAX/8], lo[SORT_NET_MAX/16], hi[SORT_NET_MAX/16];
+   __m256i b, t, mask = _mm256_setzero_si256();
+   int i, r, w, d, full = n/8;
+
+   for (i = 0; i < full; i++)
+      v[i] = Sort8(_mm256_loadu_si256((__m256i*) (a + 8*i)));
+   if (full < vecs) {
+      /* mask has lane j set if 8*full + j < n */
+      mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - 8*full), lane);
+      v[full] = Sort8(_mm256_blendv_epi8(_mm256_set1_epi32(INT_MAX),
+               _mm256_maskload_epi32(a + 8*full, mask), mask));
+      for (i = full + 1; i < vecs; i++)
+         v[i] = _mm256_set1_epi32(INT_MAX);
+   }
+
+   for (w = 1; w < vecs; w *= 2)
+      for (r = 0; r < vecs; r += 2*w) {
+         for (i = 0; i < w; i++) {
+            b = _mm256_permutevar8x32_epi32(v[r + 2*w - 1 - i], rev);
+            lo[i] = _mm256_min_epi32(v[r + i], b);
+            hi[i] = _mm256_max_epi32(v[r + i], b);
+         }
+         for (i = 0; i < w; i++) {
+            v[r + i] = lo[i];
+            v[r + w + i] = hi[i];
+         }
+         for (d = w/2; d > 0; d /= 2)
+            for (i = r; i < r + 2*w; i++)
+               if ((i & d) == 0) {
+                  t = v[i];
+                  v[i] = _mm256_min_epi32(t, v[i + d]);
+                  v[i + d] = _mm256_max_epi32(t, v[i + d]);
+               }
+         for (i = r; i < r + 2*w; i++)
+            v[i] = Merge8(v[i]);
+      }
+
+   for (i = 0; i < full; i++)
+      _mm256_storeu_si256((__m256i*) (a + 8*i), v[i]);
+   if (full < vecs)
+      _mm256_maskstore_epi32(a + 8*full, mask, v[full]);
+}  /* Network */
+
+#else
+/*-------------------------------------------------------------------
+ * Function:   Network
+ * Purpose:    Sort n ints with a bitonic network for 8*vecs ints:
+ *             without AVX2, a loop over the compare-exchanges on a
+ *             copy of a padded with INT_MAX.  The min and max don't
+ *             need branches.
+ * In args:    n:  n <= 8*vecs
+ *             vecs:  1, 2, 4, or 8
+ * In/out arg: a
+ */
+static void Network(int a[], int n, int vecs) {
+   int buf[SORT_NET_MAX];
+   int size = 8*vecs, k, j, i, l, x, y, mn, mx;
+
+   memcpy(buf, a, n*sizeof(int));
+   for (i = n; i < size; i++)
+      buf[i] = INT_MAX;
+
+   for (k = 2; k <= size; k *= 2)
+      for (j = k/2; j > 0; j /= 2)
+         for (i = 0; i < size; i++) {
+            l = i ^ j;
+            if (l < i) continue;
+            x = buf[i];
+            y = buf[l];
+            mn = (x < y) ? x : y;
+            mx = (x < y) ? y : x;
+            buf[i] = ((i & k) == 0) ? mn : mx;
+            buf[l] = ((i & k) == 0) ? mx : mn;
+         }
+
+   memcpy(a, buf, n*sizeof(int));
+}  /* Network */
+#endif
+
+/*-------------------------------------------------------------------
+ * Function:   Net_sort8, Net_sort16, Net_sort32, Net_sort64
+ * Purpose:    Sort exactly 8, 16, 32, or 64 ints
+ * In/out arg: a
+ */
+void Net_sort8(int a[])  { Network(a, 8, 1); }
+void Net_sort16(int a[]) { Network(a, 16, 2); }
+void Net_sort32(int a[]) { Network(a, 32, 4); }
+void Net_sort64(int a[]) { Network(a, 64, 8); }
+
+/*-------------------------------------------------------------------
+ * Function:   Net_sort
+ * Purpose:    Sort n <= SORT_NET_MAX ints with the smallest network
+ *             that's big enough.  (Larger lists are sorted with
+ *             Hybrid_sort.)
+ * In arg:     n
+ * In/out arg: a
+ */
+void Net_sort(int a[], int n) {
+   int vecs = 1;
+
+   if (n <= 1) return;
+   if (n > SORT_NET_MAX) {
+      Hybrid_sort(a, n);
+      return;
+   }
+   while (8*vecs < n) vecs *= 2;
+   Network(a, n, vecs);
+}  /* Net_sort */
+
+/*-------------------------------------------------------------------
+ * Function:   Hybrid_sort
+ * Purpose:    Sort a list of ints:  quicksort with Net_sort for the
+ *             leaves, switching to mergesort if the recursion is more
+ *             than 2*log2(n) deep
+ * In arg:     n
+ * In/out arg: a
+ */
+void Hybrid_sort(int a[], int n) {
+   int depth = 0, m;
+
+   for (m = n; m > 1; m /= 2)
+      depth += 2;
+   Quicksort(a, n, depth);
+}  /* Hybrid_sort */
+
+/*-------------------------------------------------------------------
+ * Function:   Quicksort
+ * Purpose:    Sort a by partitioning until the sublists have at most
+ *             SORT_LEAF elements.  Recurse on the shorter side of each
+ *             partition and loop on the longer, so the stack stays
+ *             O(log n).
+ * In args:    n, depth:  the number of partitions left before
+ *                switching to Mergesort
+ * In/out arg: a
+ */
+static void Quicksort(int a[], int n, int depth) {
+   int split;
+
+   while (n > SORT_LEAF) {
+      if (depth-- == 0) {
+         Mergesort(a, n);
+         return;
+      }
+      split = Partition(a, n);
+      if (split < n - split) {
+         Quicksort(a, split, depth);
+         a += split;
+         n -= split;
+      } else {
+         Quicksort(a + split, n - split, depth);
+         n = split;
+      }
+   }
+   Net_sort(a, n);
+}  /* Quicksort */
+
+/*-------------------------------------------------------------------
+ * Function:   Partition
+ * Purpose:    Hoare partition of a around the median of a[0], a[n/2],
+ *             and a[n-1]
+ * In arg:     n:  n >= 3
+ * In/out arg: a
+ * Ret val:    split:  0 < split < n, every element of a[0..split-1] is
+ *             <= every element of a[split..n-1]
+ * Note:       After the median of three is found, a[0] <= pivot <=
+ *             a[n-1], so the scans don't need bounds checks.
+ */
+static int Partition(int a[], int n) {
+   int mid = n/2, i = 0, j = n - 1, pivot, t;
+
+   if (a[mid] < a[0]) { t = a[mid]; a[mid] = a[0]; a[0] = t; }
+   if (a[n-1] < a[0]) { t = a[n-1]; a[n-1] = a[0]; a[0] = t; }
+   if (a[n-1] < a[mid]) { t = a[n-1]; a[n-1] = a[mid]; a[mid] = t; }
+   pivot = a[mid];
+
+   while (1) {
+      do i++; while (a[i] < pivot);
+      do j--; while (a[j] > pivot);
+      if (i >= j) return j + 1;
+      t = a[i];
+      a[i] = a[j];
+      a[j] = t;
+   }
+}  /* Partition */
+
+/*-------------------------------------------------------------------
+ * Function:   Mergesort
+ * Purpose:    Bottom-up mergesort:  sort leaves of SORT_LEAF elements
+ *             with Net_sort, and then merge pairs of runs, alternating
+ *             between a and a scratch list
+ * In arg:     n
+ * In/out arg: a
+ */
+static void Mergesort(int a[], int n) {
+   int *temp = malloc(n*sizeof(int));
+   int *src = a, *dst = temp, *swap;
+   int first, mid, last, width;
+
+   for (first = 0; first < n; first += SORT_LEAF)
+      Net_sort(a + first, (n - first < SORT_LEAF) ? n - first : SORT_LEAF);
+
+   for (width = SORT_LEAF; width < n; width *= 2) {
+      for (first = 0; first < n; first += 2*width) {
+         mid = (first + width < n) ? first + width : n;
+         last = (first + 2*width < n) ? first + 2*width : n;
+         Merge(src + first, mid - first, src + mid, last - mid,
+               dst + first);
+      }
+      swap = src;
+      src = dst;
+      dst = swap;
+   }
+
+   if (src != a) memcpy(a, src, n*sizeof(int));
+   free(temp);
+}  /* Mergesort */
+
+/*-------------------------------------------------------------------
+ * Function:   Merge
+ * Purpose:    Merge the sorted lists A and B into C
+ * In args:    A, m:  A has m elements
+ *             B, k:  B has k elements
+ * Out arg:    C:  C has m + k elements
+ */
+static void Merge(const int A[], int m, const int B[], int k, int C[]) {
+   int ai = 0, bi = 0, ci = 0;
+
+   while (ai < m && bi < k)
+      if (B[bi] < A[ai])
+         C[ci++] = B[bi++];
+      else
+         C[ci++] = A[ai++];
+   while (ai < m)
+      C[ci++] = A[ai++];
+   while (bi < k)
+      C[ci++] = B[bi++];
+}  /* Merge */
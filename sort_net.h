@@ -0,0 +1,58 @@
+/* File:     sort_net.h
+ *
+ * Purpose:  Declare sorting networks for 8, 16, 32, and 64 ints, and a
+ *           quicksort/mergesort hybrid that uses them to sort the short
+ *           sublists at the bottom of the recursion.  The parallel sorts
+ *           pth_bitonic.c, parallel_odd_even.c, and mpi_pth_odd_even.c
+ *           use Hybrid_sort for their local sorts.
+ *
+ *           The networks are bitonic sorting networks.  If the compiler
+ *           targets AVX2, the ints are kept in 8-int registers, and each
+ *           compare-exchange step of the network is a shuffle, a min, a
+ *           max, and a blend.  So there are no branches to mispredict,
+ *           and the cost doesn't depend on the order of the input.
+ *
+ * Example:
+ *    #include "sort_net.h"
+ *    . . .
+ *    Hybrid_sort(list, n);   // Sort list[0], ..., list[n-1]
+ *    Net_sort(list, 20);     // Any n <= SORT_NET_MAX
+ *
+ * Compile:  Link with sort_net.c.
+ *
+ * Notes:
+ * 1.  If the compiler targets AVX2 (e.g. gcc -O3 -march=native or
+ *     -mavx2), the networks use AVX2 intrinsics.  Otherwise they use a
+ *     loop over the compare-exchanges of a bitonic network.
+ * 2.  Hybrid_sort is a quicksort that stops partitioning when a sublist
+ *     has at most SORT_LEAF elements, and sorts it with Net_sort.  If
+ *     the recursion gets too deep (as it does for inputs built to
+ *     defeat the choice of pivots), the sublist is sorted with a
+ *     mergesort instead, whose runs start as Net_sort'ed leaves.  So
+ *     the worst case is O(n log n).
+ * 3.  The default leaf size is 64 with AVX2 and 16 without, since the
+ *     plain C network is a lot slower per element.  Compile sort_net.c
+ *     with -DSORT_LEAF=<size> to change it.  It can't be more than
+ *     SORT_NET_MAX.
+ */
+#ifndef _SORT_NET_H_
+#define _SORT_NET_H_
+
+#define SORT_NET_MAX 64
+
+#ifndef SORT_LEAF
+#if defined(__AVX2__)
+#define SORT_LEAF 64
+#else
+#define SORT_LEAF 16
+#endif
+#endif
+
+void Net_sort8(int a[]);
+void Net_sort16(int a[]);
+void Net_sort32(int a[]);
+void Net_sort64(int a[]);
+void Net_sort(int a[], int n);
+void Hybrid_sort(int a[], int n);
+
+#endif
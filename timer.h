@@ -1,13 +1,13 @@
 /* File:     timer.h
  *
- * Purpose:  Define a macro that returns the number of seconds that 
+ * Purpose:  Define a macro that returns the number of seconds that
  *           have elapsed since some point in the past.  The timer
- *           should return times with microsecond accuracy.
+ *           should return times with nanosecond resolution.
  *
  * Note:     The argument passed to the GET_TIME macro should be
  *           a double, *not* a pointer to a double.
  *
- * Example:  
+ * Example:
  *    #include "timer.h"
  *    . . .
  *    double start, finish, elapsed;
@@ -19,16 +19,40 @@
  *    GET_TIME(finish);
  *    elapsed = finish - start;
  *    printf("The code to be timed took %e seconds\n", elapsed);
+ *
+ * Notes:
+ * 1.  The clock is CLOCK_MONOTONIC_RAW if it's available, and otherwise
+ *     CLOCK_MONOTONIC:  unlike gettimeofday, it isn't changed when
+ *     the system time is adjusted.  Systems without clock_gettime
+ *     use gettimeofday, which only has microsecond resolution.
+ * 2.  To time named, nested regions of a program and get a summary
+ *     of the times, see region_timer.h.  To see a timeline of what
+ *     each thread is doing, see trace.h.
  */
 #ifndef _TIMER_H_
 #define _TIMER_H_
 
+#include <time.h>
 #include <sys/time.h>
 
+#if defined(CLOCK_MONOTONIC_RAW)
+#define TIMER_CLOCK CLOCK_MONOTONIC_RAW
+#elif defined(CLOCK_MONOTONIC)
+#define TIMER_CLOCK CLOCK_MONOTONIC
+#endif
+
+#ifdef TIMER_CLOCK
+#define GET_TIME(now) { \
+   struct timespec t; \
+   clock_gettime(TIMER_CLOCK, &t); \
+   now = t.tv_sec + t.tv_nsec/1000000000.0; \
+}
+#else
 #define GET_TIME(now) { \
    struct timeval t; \
    gettimeofday(&t, NULL); \
    now = t.tv_sec + t.tv_usec/1000000.0; \
 }
+#endif
 
-#endif
\ No newline at end of file
+#endif
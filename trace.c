@@ -0,0 +1,189 @@
+/* File:     trace.c
+ *
+ * Purpose:  Implement the event trace declared in trace.h
+ *
+ * Compile:  Link with a program compiled with -DTRACE (see trace.h).
+ *           Needs -lpthread.
+ *
+ * Data structures:
+ *    Each thread has a trace_buf_t, which is created the first time
+ *    the thread records an event.  Its events are stored in a ring
+ *    buffer:  next is the total number of events the thread has
+ *    recorded, and event i is stored in events[i % TRACE_BUF_EVENTS].
+ *    Only the thread itself writes to its buffer.  The buffers are
+ *    linked into a global list (protected by a mutex) so that they can
+ *    be found at exit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "timer.h"
+#include "trace.h"
+
+typedef struct {
+   double      time;
+   const char* name;
+   long        arg;
+   char        phase;    /* 'B' for begin, 'E' for end */
+} trace_event_t;
+
+typedef struct trace_buf_s {
+   trace_event_t*      events;
+   unsigned long       next;
+   long                tid;
+   struct trace_buf_s* next_buf;
+} trace_buf_t;
+
+static __thread trace_buf_t* my_buf = NULL;
+static trace_buf_t* all_bufs = NULL;
+static long buf_count = 0;
+static int trace_pid = -1;
+static pthread_mutex_t bufs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+static void Init(void);
+static trace_buf_t* Get_buf(void);
+static void Record(const char* name, long arg, char phase);
+
+/*-------------------------------------------------------------------
+ * Function:    Init
+ * Purpose:     Arrange for the trace to be written at exit
+ */
+static void Init(void) {
+   atexit(Trace_write);
+}  /* Init */
+
+/*-------------------------------------------------------------------
+ * Function:    Get_buf
+ * Purpose:     Return the calling thread's buffer, creating it if
+ *              necessary.  By default the thread ids are assigned in
+ *              the order in which the threads record their first
+ *              events.
+ */
+static trace_buf_t* Get_buf(void) {
+   if (my_buf == NULL) {
+      pthread_once(&init_once, Init);
+      my_buf = malloc(sizeof(trace_buf_t));
+      my_buf->events = malloc(TRACE_BUF_EVENTS*sizeof(trace_event_t));
+      my_buf->next = 0;
+      pthread_mutex_lock(&bufs_mutex);
+      my_buf->tid = buf_count++;
+      my_buf->next_buf = all_bufs;
+      all_bufs = my_buf;
+      pthread_mutex_unlock(&bufs_mutex);
+   }
+   return my_buf;
+}  /* Get_buf */
+
+/*-------------------------------------------------------------------
+ * Function:    Record
+ * Purpose:     Add an event to the calling thread's buffer
+ */
+static void Record(const char* name, long arg, char phase) {
+   trace_buf_t* buf = Get_buf();
+   trace_event_t* event = &buf->events[buf->next & (TRACE_BUF_EVENTS-1)];
+
+   GET_TIME(event->time);
+   event->name = name;
+   event->arg = arg;
+   event->phase = phase;
+   buf->next++;
+}  /* Record */
+
+/*-------------------------------------------------------------------
+ * Function:    Trace_process
+ * Purpose:     Set the process id used in the trace and its file name
+ */
+void Trace_process(int pid) {
+   trace_pid = pid;
+}  /* Trace_process */
+
+/*-------------------------------------------------------------------
+ * Function:    Trace_thread
+ * Purpose:     Set the thread id of the calling thread in the trace
+ */
+void Trace_thread(long tid) {
+   Get_buf()->tid = tid;
+}  /* Trace_thread */
+
+/*-------------------------------------------------------------------
+ * Function:    Trace_begin
+ * Purpose:     Record the start of the event name
+ */
+void Trace_begin(const char* name, long arg) {
+   Record(name, arg, 'B');
+}  /* Trace_begin */
+
+/*-------------------------------------------------------------------
+ * Function:    Trace_end
+ * Purpose:     Record the end of the event name
+ */
+void Trace_end(const char* name) {
+   Record(name, 0, 'E');
+}  /* Trace_end */
+
+/*-------------------------------------------------------------------
+ * Function:    Trace_write
+ * Purpose:     Write the events in all the threads' buffers to
+ *              trace.<pid>.json
+ * Note:        Should only be called when no thread is recording
+ *              events.  Called automatically at exit.
+ */
+void Trace_write(void) {
+   char file_name[64];
+   FILE* fp;
+   trace_buf_t* buf;
+   trace_event_t* event;
+   unsigned long first, i;
+   int pid = (trace_pid >= 0) ? trace_pid : (int) getpid();
+   int depth;
+
+   pthread_mutex_lock(&bufs_mutex);
+   if (all_bufs == NULL) {
+      pthread_mutex_unlock(&bufs_mutex);
+      return;
+   }
+   sprintf(file_name, "trace.%d.json", pid);
+   fp = fopen(file_name, "w");
+   if (fp == NULL) {
+      fprintf(stderr, "Trace_write:  can't open %s\n", file_name);
+      pthread_mutex_unlock(&bufs_mutex);
+      return;
+   }
+
+   fprintf(fp, "{\"traceEvents\":[\n");
+   fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+         "\"args\":{\"name\":\"process %d\"}}", pid, pid);
+   for (buf = all_bufs; buf != NULL; buf = buf->next_buf) {
+      fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"tid\":%ld,\"args\":{\"name\":\"thread %ld\"}}", pid,
+            buf->tid, buf->tid);
+      first = 0;
+      if (buf->next > TRACE_BUF_EVENTS) {
+         first = buf->next - TRACE_BUF_EVENTS;
+         fprintf(stderr, "Trace_write:  process %d thread %ld lost %lu "
+               "events\n", pid, buf->tid, first);
+      }
+
+      depth = 0;
+      for (i = first; i < buf->next; i++) {
+         event = &buf->events[i & (TRACE_BUF_EVENTS-1)];
+         if (event->phase == 'E' && depth == 0) continue;
+         depth += (event->phase == 'B') ? 1 : -1;
+         fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+               "\"pid\":%d,\"tid\":%ld", event->name, event->phase,
+               event->time*1.0e6, pid, buf->tid);
+         if (event->phase == 'B')
+            fprintf(fp, ",\"args\":{\"arg\":%ld}", event->arg);
+         fprintf(fp, "}");
+      }
+   }
+   fprintf(fp, "\n]}\n");
+   fclose(fp);
+
+   /* Don't write the events again if Trace_write is called twice */
+   for (buf = all_bufs; buf != NULL; buf = buf->next_buf)
+      buf->next = 0;
+   pthread_mutex_unlock(&bufs_mutex);
+}  /* Trace_write */
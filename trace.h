@@ -0,0 +1,74 @@
+/* File:     trace.h
+ *
+ * Purpose:  Record a timeline of what each thread and process is doing
+ *           -- computing, communicating, or waiting -- and write it in
+ *           the Chrome trace format, so that it can be viewed with
+ *           https://ui.perfetto.dev or chrome://tracing.  Stragglers
+ *           and idle threads show up as gaps and long waits.
+ *
+ * Compile:  Compile the program with -DTRACE and link with trace.c,
+ *           e.g.
+ *           gcc -g -Wall -DTRACE -o pth_bitonic pth_bitonic.c trace.c
+ *              -lpthread
+ *           Without -DTRACE the macros expand to nothing, and trace.c
+ *           isn't needed.
+ *
+ * Example:
+ *    #include "trace.h"
+ *    . . .
+ *    TRACE_PROCESS(my_rank);        // Optional:  MPI programs
+ *    . . .
+ *    TRACE_THREAD(my_rank);         // Optional:  Pthreads programs
+ *    TRACE_BEGIN("merge", phase);   // arg is shown with the event
+ *    . . .
+ *    TRACE_END("merge");
+ *
+ * Output:   When the program exits, each process writes the file
+ *           trace.<process>.json, where <process> is the value passed
+ *           to TRACE_PROCESS or, by default, the process id.  The
+ *           files from an MPI program can be combined with jq:
+ *              jq -s '{traceEvents: [.[].traceEvents[]]}'
+ *                 trace.*.json > trace.json
+ *
+ * Notes:
+ * 1.  Each thread stores its events in its own ring buffer of
+ *     TRACE_BUF_EVENTS events, so recording an event takes no locks
+ *     and no system calls:  just a clock_gettime and a store.  A
+ *     thread's buffer is only allocated (and linked into a list with a
+ *     mutex) the first time it records an event.
+ * 2.  If a thread records more than TRACE_BUF_EVENTS events, the
+ *     oldest are overwritten, and the number lost is printed to stderr
+ *     when the trace is written.  Ends whose begins were overwritten
+ *     are dropped.
+ * 3.  Times are taken with GET_TIME (see timer.h), which reads a clock
+ *     shared by all the processes on a node, so the timelines of
+ *     processes running on the same node line up.
+ * 4.  Event names should be string constants:  only the pointer is
+ *     stored.
+ * 5.  The buffers are written by an atexit function, so the threads
+ *     should have finished.
+ */
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#define TRACE_BUF_EVENTS (1 << 16)  /* Must be a power of 2 */
+
+void Trace_process(int pid);
+void Trace_thread(long tid);
+void Trace_begin(const char* name, long arg);
+void Trace_end(const char* name);
+void Trace_write(void);
+
+#ifdef TRACE
+#define TRACE_PROCESS(pid) Trace_process(pid)
+#define TRACE_THREAD(tid) Trace_thread(tid)
+#define TRACE_BEGIN(name, arg) Trace_begin(name, arg)
+#define TRACE_END(name) Trace_end(name)
+#else
+#define TRACE_PROCESS(pid)
+#define TRACE_THREAD(tid)
+#define TRACE_BEGIN(name, arg)
+#define TRACE_END(name)
+#endif
+
+#endif
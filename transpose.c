@@ -0,0 +1,167 @@
+/* File:     transpose.c
+ *
+ * Purpose:  Implement serial cache-oblivious and Pthreads transposes
+ *           B = A^T for ints, floats, and doubles.  See transpose.h.
+ *
+ * Compile:  Compile and link with a program that uses the transposes,
+ *           e.g.
+ *           gcc -g -Wall -O3 -march=native -o transpose_bench
+ *              transpose_bench.c transpose.c -lpthread
+ *
+ * Algorithm (serial):
+ *    Transpose(rows, cols, A, B):
+ *       if rows <= LEAF and cols <= LEAF
+ *          B[j][i] = A[i][j] for all i, j
+ *       else if rows >= cols
+ *          Transpose the top half of A into the left half of B
+ *          Transpose the bottom half of A into the right half of B
+ *       else
+ *          Transpose the left half of A into the top half of B
+ *          Transpose the right half of A into the bottom half of B
+ *
+ * Notes:
+ * 1.  The three versions differ only in the type of the entries, so
+ *     they're generated by the macro DEFINE_TRANSPOSE.
+ * 2.  When the longer dimension is split among the threads, each
+ *     block is a multiple of TRANS_LEAF (except the last), so the
+ *     threads' blocks are split into leaves the same way the serial
+ *     transpose would split them.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "transpose.h"
+
+/*-------------------------------------------------------------------
+ * Macro:     DEFINE_TRANSPOSE
+ * Purpose:   Define the functions for matrices with entries of type
+ *            type:
+ *               Rec_transpose_<name>:  the recursive serial transpose
+ *               Transpose_<name>:  the serial transpose
+ *               Thread_transpose_<name>:  the thread function, which
+ *                  transposes the thread's block of A
+ *               Pth_transpose_<name>:  start the threads
+ *            <name>_args_t holds the arguments to a thread.
+ */
+#define DEFINE_TRANSPOSE(type, name)                                    \
+                                                                        \
+static void Rec_transpose_##name(int rows, int cols, const type A[],    \
+      int lda, type B[], int ldb) {                                     \
+   int i, j, half;                                                      \
+                                                                        \
+   if (rows <= TRANS_LEAF && cols <= TRANS_LEAF) {                      \
+      for (i = 0; i < rows; i++)                                        \
+         for (j = 0; j < cols; j++)                                     \
+            B[((size_t) j)*ldb + i] = A[((size_t) i)*lda + j];          \
+   } else if (rows >= cols) {                                           \
+      half = rows/2;                                                    \
+      Rec_transpose_##name(half, cols, A, lda, B, ldb);                 \
+      Rec_transpose_##name(rows - half, cols,                           \
+            A + ((size_t) half)*lda, lda, B + half, ldb);               \
+   } else {                                                             \
+      half = cols/2;                                                    \
+      Rec_transpose_##name(rows, half, A, lda, B, ldb);                 \
+      Rec_transpose_##name(rows, cols - half, A + half, lda,            \
+            B + ((size_t) half)*ldb, ldb);                              \
+   }                                                                    \
+}                                                                       \
+                                                                        \
+void Transpose_##name(int rows, int cols, const type A[], int lda,      \
+      type B[], int ldb) {                                              \
+   Rec_transpose_##name(rows, cols, A, lda, B, ldb);                    \
+}                                                                       \
+                                                                        \
+typedef struct {                                                        \
+   int rows, cols, lda, ldb;                                            \
+   const type* A;                                                       \
+   type* B;                                                             \
+   long my_rank;                                                        \
+   int thread_count;                                                    \
+} name##_args_t;                                                        \
+                                                                        \
+static void* Thread_transpose_##name(void* args_p) {                   \
+   name##_args_t* args = (name##_args_t*) args_p;                       \
+   int first, last;                                                     \
+                                                                        \
+   if (args->rows >= args->cols) {                                      \
+      Get_block(args->rows, args->my_rank, args->thread_count,          \
+            &first, &last);                                             \
+      Rec_transpose_##name(last - first, args->cols,                    \
+            args->A + ((size_t) first)*args->lda, args->lda,            \
+            args->B + first, args->ldb);                                \
+   } else {                                                             \
+      Get_block(args->cols, args->my_rank, args->thread_count,          \
+            &first, &last);                                             \
+      Rec_transpose_##name(args->rows, last - first,                    \
+            args->A + first, args->lda,                                 \
+            args->B + ((size_t) first)*args->ldb, args->ldb);           \
+   }                                                                    \
+   return NULL;                                                         \
+}                                                                       \
+                                                                        \
+void Pth_transpose_##name(int rows, int cols, const type A[], int lda,  \
+      type B[], int ldb, int thread_count) {                            \
+   long thread;                                                         \
+   pthread_t* thread_handles;                                           \
+   name##_args_t* args;                                                 \
+                                                                        \
+   if (thread_count <= 1) {                                             \
+      Rec_transpose_##name(rows, cols, A, lda, B, ldb);                 \
+      return;                                                           \
+   }                                                                    \
+   thread_handles = malloc(thread_count*sizeof(pthread_t));             \
+   args = malloc(thread_count*sizeof(name##_args_t));                   \
+   for (thread = 0; thread < thread_count; thread++) {                  \
+      args[thread].rows = rows;                                         \
+      args[thread].cols = cols;                                         \
+      args[thread].A = A;                                               \
+      args[thread].lda = lda;                                           \
+      args[thread].B = B;                                               \
+      args[thread].ldb = ldb;                                           \
+      args[thread].my_rank = thread;                                    \
+      args[thread].thread_count = thread_count;                         \
+      pthread_create(&thread_handles[thread], NULL,                     \
+            Thread_transpose_##name, &args[thread]);                    \
+   }                                                                    \
+   for (thread = 0; thread < thread_count; thread++)                    \
+      pthread_join(thread_handles[thread], NULL);                       \
+   free(args);                                                          \
+   free(thread_handles);                                                \
+}
+
+static void Get_block(int total, long my_rank, int thread_count,
+      int* first_p, int* last_p);
+
+DEFINE_TRANSPOSE(int, int)
+DEFINE_TRANSPOSE(float, float)
+DEFINE_TRANSPOSE(double, double)
+
+
+/*-------------------------------------------------------------------
+ * Function:    Get_block
+ * Purpose:     Divide 0, 1, ..., total-1 into thread_count blocks
+ *              whose sizes are multiples of TRANS_LEAF, except the
+ *              last nonempty block, and find the block assigned to
+ *              my_rank
+ * In args:     total, my_rank, thread_count
+ * Out args:    first_p, last_p:  the thread's block is
+ *              first <= i < last.  It may be empty.
+ */
+static void Get_block(int total, long my_rank, int thread_count,
+      int* first_p, int* last_p) {
+   int leaves = (total + TRANS_LEAF - 1)/TRANS_LEAF;
+   int quotient = leaves/thread_count, rem = leaves % thread_count;
+   int first, last;
+
+   if (my_rank < rem) {
+      first = my_rank*(quotient + 1);
+      last = first + quotient + 1;
+   } else {
+      first = my_rank*quotient + rem;
+      last = first + quotient;
+   }
+   first *= TRANS_LEAF;
+   last *= TRANS_LEAF;
+   *first_p = (first < total) ? first : total;
+   *last_p = (last < total) ? last : total;
+}  /* Get_block */
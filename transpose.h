@@ -0,0 +1,55 @@
+/* File:     transpose.h
+ *
+ * Purpose:  Declare serial and Pthreads matrix transposes B = A^T for
+ *           matrices of ints, floats, and doubles.
+ *
+ *           The serial transposes are cache-oblivious:  they split the
+ *           longer dimension of A in half, recursively, until a block
+ *           fits in a TRANS_LEAF x TRANS_LEAF tile, and then transpose
+ *           the tile with a pair of loops.  So at some level of the
+ *           recursion the rows of a block of A and of B fit in each
+ *           level of cache, without tuning a block size for each cache.
+ *
+ *           The Pthreads transposes divide the longer dimension of A
+ *           among thread_count threads by blocks, and each thread calls
+ *           the serial transpose on its block.
+ *
+ * Example:
+ *    #include "transpose.h"
+ *    . . .
+ *    // A is m x n, B is n x m, both stored by rows
+ *    Transpose_double(m, n, A, lda, B, ldb);
+ *    Pth_transpose_double(m, n, A, lda, B, ldb, thread_count);
+ *
+ * Compile:  Link with transpose.c.  Needs -lpthread.
+ *
+ * Notes:
+ * 1.  Matrices are stored by rows:  the entry in row i and column j of
+ *     A is A[i*lda + j].  lda and ldb are the row strides, so the
+ *     functions can transpose a block of a larger matrix.
+ * 2.  A and B shouldn't overlap.
+ * 3.  Compile transpose.c with -DTRANS_LEAF=<size> to change the leaf
+ *     size.
+ */
+#ifndef _TRANSPOSE_H_
+#define _TRANSPOSE_H_
+
+#ifndef TRANS_LEAF
+#define TRANS_LEAF 16
+#endif
+
+void Transpose_int(int rows, int cols, const int A[], int lda,
+      int B[], int ldb);
+void Transpose_float(int rows, int cols, const float A[], int lda,
+      float B[], int ldb);
+void Transpose_double(int rows, int cols, const double A[], int lda,
+      double B[], int ldb);
+
+void Pth_transpose_int(int rows, int cols, const int A[], int lda,
+      int B[], int ldb, int thread_count);
+void Pth_transpose_float(int rows, int cols, const float A[], int lda,
+      float B[], int ldb, int thread_count);
+void Pth_transpose_double(int rows, int cols, const double A[], int lda,
+      double B[], int ldb, int thread_count);
+
+#endif
@@ -0,0 +1,248 @@
+/* File:     transpose_bench.c
+ *
+ * Purpose:  Compare the bandwidth of three transposes B = A^T of a
+ *           rows x cols matrix of ints, floats or doubles:
+ *              - naive:  a serial pair of loops over the rows and
+ *                columns of A,
+ *              - the serial cache-oblivious transpose Transpose_<type>,
+ *              - the Pthreads transpose Pth_transpose_<type>,
+ *           and a serial copy B = A of the same matrix.  See
+ *           transpose.h.
+ *
+ * Compile:  gcc -g -Wall -O3 -march=native -o transpose_bench
+ *              transpose_bench.c transpose.c -lpthread
+ * Run:      ./transpose_bench <thread_count> <rows> <cols> <i|f|d>
+ *              i, f, d:  the entries are ints, floats, or doubles
+ *
+ * Input:    none
+ * Output:   The best time over REPS runs of each method, its bandwidth
+ *           in GB/s, and whether the transposes are correct.
+ *
+ * Notes:
+ * 1.  The bandwidth counts reading A and writing B once:
+ *     2*rows*cols*sizeof(entry) bytes.
+ * 2.  The naive transpose reads A by rows and writes B by columns, so
+ *     when the matrices don't fit in cache, most of the stores to B
+ *     miss.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+#include "transpose.h"
+
+#define REPS 10
+
+typedef enum {NAIVE, SERIAL, PARALLEL, COPY} method_t;
+
+/* Global variables */
+int    thread_count, rows, cols;
+char   type;
+size_t size;
+
+void   Usage(char* prog_name);
+void   Get_args(int argc, char* argv[]);
+void   Init_matrix(void* A);
+void   Transpose(method_t method, void* A, void* B);
+double Run(method_t method, void* A, void* B);
+int    Check(void* A, void* B);
+void   Print_result(char title[], double elapsed);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   void *A, *B;
+   double elapsed;
+
+   Get_args(argc, argv);
+   A = malloc(((size_t) rows)*cols*size);
+   B = malloc(((size_t) rows)*cols*size);
+   if (A == NULL || B == NULL) {
+      fprintf(stderr, "Can't allocate the matrices\n");
+      exit(-1);
+   }
+   Init_matrix(A);
+   memset(B, 0, ((size_t) rows)*cols*size);
+
+   elapsed = Run(COPY, A, B);
+   Print_result("Copy:", elapsed);
+
+   elapsed = Run(NAIVE, A, B);
+   Print_result("Naive transpose:", elapsed);
+   if (!Check(A, B)) printf("   The naive transpose is NOT correct\n");
+
+   memset(B, 0, ((size_t) rows)*cols*size);
+   elapsed = Run(SERIAL, A, B);
+   Print_result("Cache-oblivious:", elapsed);
+   if (!Check(A, B)) printf("   The serial transpose is NOT correct\n");
+
+   memset(B, 0, ((size_t) rows)*cols*size);
+   elapsed = Run(PARALLEL, A, B);
+   Print_result("Pthreads:", elapsed);
+   if (!Check(A, B)) printf("   The Pthreads transpose is NOT correct\n");
+
+   free(A);
+   free(B);
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   print a message showing what the command line should
+ *            be, and terminate
+ * In arg :   prog_name
+ */
+void Usage(char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <rows> <cols> <i|f|d>\n",
+         prog_name);
+   fprintf(stderr, "   i, f, d:  the entries are ints, floats or doubles\n");
+   exit(0);
+}  /* Usage */
+
+
+/*------------------------------------------------------------------
+ * Function:    Get_args
+ * Purpose:     Get and check command line args
+ * In args:     argc, argv
+ * Out globals: thread_count, rows, cols, type, size
+ */
+void Get_args(int argc, char* argv[]) {
+   if (argc != 5) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   rows = strtol(argv[2], NULL, 10);
+   cols = strtol(argv[3], NULL, 10);
+   type = argv[4][0];
+   if (thread_count <= 0 || rows <= 0 || cols <= 0) Usage(argv[0]);
+   if (type == 'i')
+      size = sizeof(int);
+   else if (type == 'f')
+      size = sizeof(float);
+   else if (type == 'd')
+      size = sizeof(double);
+   else
+      Usage(argv[0]);
+}  /* Get_args */
+
+
+/*------------------------------------------------------------------
+ * Function:    Init_matrix
+ * Purpose:     Set entry k of A to k, so that a transposed entry can
+ *              be checked by its value
+ * In globals:  rows, cols, type
+ * Out arg:     A
+ */
+void Init_matrix(void* A) {
+   size_t k, count = ((size_t) rows)*cols;
+
+   for (k = 0; k < count; k++)
+      if (type == 'i')
+         ((int*) A)[k] = (int) k;
+      else if (type == 'f')
+         ((float*) A)[k] = (float) k;
+      else
+         ((double*) A)[k] = (double) k;
+}  /* Init_matrix */
+
+
+/*------------------------------------------------------------------
+ * Function:    Transpose
+ * Purpose:     Transpose A into B (or copy A into B) using method
+ * In args:     method, A
+ * Out arg:     B
+ * In globals:  thread_count, rows, cols, type, size
+ */
+void Transpose(method_t method, void* A, void* B) {
+   long i, j;
+
+   switch (method) {
+      case COPY:
+         memcpy(B, A, ((size_t) rows)*cols*size);
+         break;
+      case NAIVE:
+         for (i = 0; i < rows; i++)
+            for (j = 0; j < cols; j++)
+               if (type == 'i')
+                  ((int*) B)[j*rows + i] = ((int*) A)[i*cols + j];
+               else if (type == 'f')
+                  ((float*) B)[j*rows + i] = ((float*) A)[i*cols + j];
+               else
+                  ((double*) B)[j*rows + i] = ((double*) A)[i*cols + j];
+         break;
+      case SERIAL:
+         if (type == 'i')
+            Transpose_int(rows, cols, A, cols, B, rows);
+         else if (type == 'f')
+            Transpose_float(rows, cols, A, cols, B, rows);
+         else
+            Transpose_double(rows, cols, A, cols, B, rows);
+         break;
+      case PARALLEL:
+         if (type == 'i')
+            Pth_transpose_int(rows, cols, A, cols, B, rows, thread_count);
+         else if (type == 'f')
+            Pth_transpose_float(rows, cols, A, cols, B, rows,
+                  thread_count);
+         else
+            Pth_transpose_double(rows, cols, A, cols, B, rows,
+                  thread_count);
+         break;
+   }
+}  /* Transpose */
+
+
+/*------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Run method REPS times and return the best time
+ * In args:     method, A
+ * Out arg:     B
+ * Ret val:     The minimum elapsed time
+ */
+double Run(method_t method, void* A, void* B) {
+   int rep;
+   double start, finish, best = 1.0e30;
+
+   for (rep = 0; rep < REPS; rep++) {
+      GET_TIME(start);
+      Transpose(method, A, B);
+      GET_TIME(finish);
+      if (finish - start < best) best = finish - start;
+   }
+   return best;
+}  /* Run */
+
+
+/*------------------------------------------------------------------
+ * Function:    Check
+ * Purpose:     Check that B = A^T
+ * In args:     A, B
+ * In globals:  rows, cols, type
+ * Ret val:     1 if B = A^T, 0 otherwise
+ */
+int Check(void* A, void* B) {
+   long i, j;
+
+   for (i = 0; i < rows; i++)
+      for (j = 0; j < cols; j++)
+         if ((type == 'i' &&
+                  ((int*) B)[j*rows + i] != ((int*) A)[i*cols + j]) ||
+               (type == 'f' &&
+                  ((float*) B)[j*rows + i] != ((float*) A)[i*cols + j]) ||
+               (type == 'd' &&
+                  ((double*) B)[j*rows + i] != ((double*) A)[i*cols + j]))
+            return 0;
+   return 1;
+}  /* Check */
+
+
+/*------------------------------------------------------------------
+ * Function:    Print_result
+ * Purpose:     Print the elapsed time and bandwidth of a method
+ * In args:     title, elapsed
+ * In globals:  rows, cols, size
+ */
+void Print_result(char title[], double elapsed) {
+   double bytes = 2.0*rows*cols*size;
+
+   printf("%-18s %e seconds, %7.2f GB/s\n", title, elapsed,
+         bytes/elapsed/1.0e9);
+}  /* Print_result */
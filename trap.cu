@@ -6,41 +6,73 @@
  *           blocks_per_grid are powers of 2.
  *
  * Compile:  nvcc  -arch=sm_21 -o trap trap.cu 
- * Run:      ./trap <n> <a> <b> <blocks> <threads_per_block>
+ * Run:      ./trap <n> <a> <b> <blocks> <threads_per_block> [integrand]
  *              n is the number of trapezoids
  *              a is the left endpoint
  *              b is the right endpoint
+ *              integrand is the name of the function to integrate
+ *                 (default "x^2+1").  Run with an unknown name to
+ *                 get the list of available integrands.
  *
  * Input:    None
- * Output:   Result of trapezoidal applied to f(x).
+ * Output:   Result of trapezoidal applied to f(x), and the error
+ *           in the result compared with the exact integral.
  *
  * Notes:
- * 1.  The function f(x) = x^2 + 1 is hardwired
+ * 1.  Each integrand is a struct with a static member function F
+ *     that can be called on both the host and the device, and a
+ *     static member function Antideriv that is used to compute the
+ *     exact value of the integral.  The kernel and the serial trap
+ *     function are templates over the integrand, so F is inlined into
+ *     the loops:  there is no call through a function pointer for
+ *     each sample.  The integrand is selected by name once, at the 
+ *     start of the run, using the table integrands[].
+ * 2.  To add an integrand, define its struct and add a line to
+ *     integrands[].
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "timer.h"
 
 #define MAX_BLOCK_SZ 512
 
 /*-------------------------------------------------------------------
- * Function:    Dev_f
- * Purpose:     The function we're integrating
- * In arg:      x
+ * Integrands:  F is the function we're integrating, Antideriv is
+ * an antiderivative of F.
  */
-__device__ float Dev_f(float x) {
-   return x*x + 1;
-}  /* Dev_f */
+struct Sq_plus_1 {
+   __host__ __device__ static float F(float x) { return x*x + 1; }
+   static double Antideriv(double x) { return x*x*x/3.0 + x; }
+};
 
-/*-------------------------------------------------------------------
- * Function:    f
- * Purpose:     The function we're integrating
- * In arg:      x
- */
-float f(float x) {
-   return x*x + 1;
-}  /* f */
+struct Cube {
+   __host__ __device__ static float F(float x) { return x*x*x; }
+   static double Antideriv(double x) { return x*x*x*x/4.0; }
+};
+
+struct Sine {
+   __host__ __device__ static float F(float x) { return sinf(x); }
+   static double Antideriv(double x) { return -cos(x); }
+};
+
+struct Exponential {
+   __host__ __device__ static float F(float x) { return expf(x); }
+   static double Antideriv(double x) { return exp(x); }
+};
 
+/* a and b should be positive */
+struct Reciprocal {
+   __host__ __device__ static float F(float x) { return 1.0f/x; }
+   static double Antideriv(double x) { return log(x); }
+};
+
+/* a and b should be nonnegative */
+struct Square_root {
+   __host__ __device__ static float F(float x) { return sqrtf(x); }
+   static double Antideriv(double x) { return 2.0*x*sqrt(x)/3.0; }
+};
 
 
 /*-------------------------------------------------------------------
@@ -50,6 +82,7 @@ float f(float x) {
  * Out arg:     z
  *
  */
+template <class Integrand>
 __global__ void Dev_trap(float a, float b, float h, int n, float z[]) {
    /* Use tmp to store each thread's trapezoid area */
    /* Can't use variable dimension here             */
@@ -58,7 +91,7 @@ __global__ void Dev_trap(float a, float b, float h, int n, float z[]) {
    int loc_t = threadIdx.x;
    float my_a = a + t*h;
    
-   if (t < n) tmp[loc_t] = 0.5*h*(Dev_f(my_a) + Dev_f(my_a+h));
+   if (t < n) tmp[loc_t] = 0.5*h*(Integrand::F(my_a) + Integrand::F(my_a+h));
    __syncthreads();
 
    /* This uses a tree structure to do the additions */
@@ -76,12 +109,42 @@ __global__ void Dev_trap(float a, float b, float h, int n, float z[]) {
 /*-------------------------------------------------------------------
  * Host code 
  */
-void Get_args(int argc, char* argv[], int* n_p, float* a_p, float* b_p,
-      int* threads_per_block_p, int* blocks_p);
+template <class Integrand>
 float Serial_trap(float a, float b, int n);
+template <class Integrand>
 float Trap_wrapper(float a, float b, int n, float z_d[],
       int blocks, int threads);
 
+/* One entry for each integrand:  the instantiations of the host 
+ * functions for the integrand */
+typedef struct {
+   const char* name;
+   float (*trap_wrapper)(float a, float b, int n, float z_d[],
+         int blocks, int threads);
+   float (*serial_trap)(float a, float b, int n);
+   double (*antideriv)(double x);
+} integrand_t;
+
+#define INTEGRAND(name, Integrand) \
+   {name, Trap_wrapper<Integrand>, Serial_trap<Integrand>, \
+    Integrand::Antideriv}
+
+const integrand_t integrands[] = {
+   INTEGRAND("x^2+1", Sq_plus_1),
+   INTEGRAND("x^3",   Cube),
+   INTEGRAND("sin",   Sine),
+   INTEGRAND("exp",   Exponential),
+   INTEGRAND("1/x",   Reciprocal),
+   INTEGRAND("sqrt",  Square_root)
+};
+const int integrand_count = sizeof(integrands)/sizeof(integrand_t);
+
+void Usage(char* prog_name);
+void Get_args(int argc, char* argv[], int* n_p, float* a_p, float* b_p,
+      int* threads_per_block_p, int* blocks_p, 
+      const integrand_t** integrand_p);
+void Print_error(const char* title, float trap, double exact);
+
 
 /*-------------------------------------------------------------------
  * main
@@ -90,21 +153,28 @@ int main(int argc, char* argv[]) {
    int n, threads_per_block, blocks;
    float a, b, *z_d, trap;
    double start, finish;  /* Only used on host */
+   double exact;
+   const integrand_t* integrand;
 
-   Get_args(argc, argv, &n, &a, &b, &threads_per_block, &blocks);
+   Get_args(argc, argv, &n, &a, &b, &threads_per_block, &blocks,
+         &integrand);
    cudaMalloc(&z_d, blocks*sizeof(float));
+   exact = integrand->antideriv(b) - integrand->antideriv(a);
+   printf("Integrand = %s, exact area = %e\n", integrand->name, exact);
 
    GET_TIME(start);
-   trap = Trap_wrapper(a, b, n, z_d, blocks, threads_per_block);
+   trap = integrand->trap_wrapper(a, b, n, z_d, blocks, threads_per_block);
    GET_TIME(finish);
 
    printf("The area as computed by cuda is: %e\n", trap);
+   Print_error("cuda", trap, exact);
    printf("Elapsed time for cuda = %e seconds\n", finish-start);
 
    GET_TIME(start)
-   trap = Serial_trap(a, b, n);
+   trap = integrand->serial_trap(a, b, n);
    GET_TIME(finish);
    printf("The area as computed by cpu is: %e\n", trap);
+   Print_error("cpu", trap, exact);
    printf("Elapsed time for cpu = %e seconds\n", finish-start);
 
    cudaFree(z_d);
@@ -113,32 +183,74 @@ int main(int argc, char* argv[]) {
 }  /* main */
 
 
+/*-------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   Print the command line and the names of the available
+ *            integrands, and quit
+ */
+void Usage(char* prog_name) {
+   int i;
+
+   fprintf(stderr, 
+         "usage: %s <n> <a> <b> <blocks> <threads per block> [integrand]\n",
+         prog_name);
+   fprintf(stderr, "integrands:");
+   for (i = 0; i < integrand_count; i++)
+      fprintf(stderr, " %s", integrands[i].name);
+   fprintf(stderr, "\n");
+   exit(0);
+}  /* Usage */
+
+
 /*-------------------------------------------------------------------
  * Function:  Get_args
  * Purpose:   Get and check command line args.  If there's an error
  *            quit.
  */
 void Get_args(int argc, char* argv[], int* n_p, float* a_p, float* b_p,
-      int* threads_per_block_p, int* blocks_p) {
+      int* threads_per_block_p, int* blocks_p, 
+      const integrand_t** integrand_p) {
+   int i;
 
-   if (argc != 6) {
-      fprintf(stderr, "usage: %s <n> <a> <b> <blocks> <threads per block>\n", 
-            argv[0]);
-      exit(0);
-   }
+   if (argc != 6 && argc != 7) Usage(argv[0]);
    *n_p = strtol(argv[1], NULL, 10);
    *a_p = strtod(argv[2], NULL);
    *b_p = strtod(argv[3], NULL);
    *blocks_p = strtol(argv[4], NULL, 10);
    *threads_per_block_p = strtol(argv[5], NULL, 10);
+
+   *integrand_p = &integrands[0];
+   if (argc == 7) {
+      for (i = 0; i < integrand_count; i++)
+         if (strcmp(argv[6], integrands[i].name) == 0) break;
+      if (i == integrand_count) Usage(argv[0]);
+      *integrand_p = &integrands[i];
+   }
 }  /* Get_args */
 
 
+/*-------------------------------------------------------------------
+ * Function:  Print_error
+ * Purpose:   Print the absolute and relative errors in a computed
+ *            area
+ */
+void Print_error(const char* title, float trap, double exact) {
+   double err = fabs(trap - exact);
+
+   if (exact != 0.0)
+      printf("Error for %s = %e, relative error = %e\n", title, err,
+            err/fabs(exact));
+   else
+      printf("Error for %s = %e\n", title, err);
+}  /* Print_error */
+
+
 /*-------------------------------------------------------------------
  * Function:  Trap_wrapper
  * Purpose:   CPU wrapper function for GPU trapezoidal rule
  * Note:      Assumes z_d has been allocated.
  */
+template <class Integrand>
 float Trap_wrapper(float a, float b, int n, float z_d[], 
       int blocks, int threads) {
    int i;
@@ -147,7 +259,7 @@ float Trap_wrapper(float a, float b, int n, float z_d[],
 
    /* Invoke kernel */
    h = (b-a)/n;
-   Dev_trap<<<blocks, threads>>>(a, b, h, n, z_d);
+   Dev_trap<Integrand><<<blocks, threads>>>(a, b, h, n, z_d);
    cudaThreadSynchronize();
 
    cudaMemcpy(&z_h, z_d, blocks*sizeof(float), cudaMemcpyDeviceToHost);
@@ -159,19 +271,20 @@ float Trap_wrapper(float a, float b, int n, float z_d[],
 
 
 /*-------------------------------------------------------------------
- * Function:  Serial_dot
- * Purpose:   Compute a dot product on the cpu
+ * Function:  Serial_trap
+ * Purpose:   Implement the trapezoidal rule on the cpu
  */
+template <class Integrand>
 float Serial_trap(float a, float b, int n) {
    int i;
    float x, h, trap = 0;
 
    h = (b-a)/n;
 
-   trap = (f(a) + f(b))/2.0;
+   trap = (Integrand::F(a) + Integrand::F(b))/2.0;
    for (i = 1; i <= n-1; i++) {
        x = a + i*h;
-       trap = trap + f(x);
+       trap = trap + Integrand::F(x);
    }
    trap = trap*h;
    
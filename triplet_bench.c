@@ -0,0 +1,263 @@
+/* File:
+ *     triplet_bench.c
+ *
+ * Purpose:
+ *     Compare storing the nonzeroes of a sparse matrix as an array of
+ *     element_t structs (AoS) with storing them in a triplets_t, which
+ *     keeps the rows, cols, and values in separate arrays (SoA).  See
+ *     triplets.h.
+ *
+ *     The threads generate nnz random triplets, and append them to a
+ *     triplets_t while storing them in an array of element_t's.  Then
+ *     the program times
+ *        - two loops over the triplets that only use some of the
+ *          members:  the sum of the values in the first half of the
+ *          rows, and the number of triplets on the diagonal,
+ *        - sorting by (row, col) and adding the duplicates:  qsort
+ *          of the element_t's vs. the parallel radix sort Trip_sort,
+ *        - converting the sorted triplets to CSR format.
+ *     Finally it checks that the CSR matrix is the same as the sorted
+ *     array of element_t's.
+ *
+ * Input:
+ *     none
+ *
+ * Output:
+ *     The times for each step and the triplets processed per second.
+ *
+ * Compile:
+ *    gcc -g -Wall -O3 -o triplet_bench triplet_bench.c triplets.c
+ *       -lpthread -lm
+ * Usage:
+ *    ./triplet_bench <thread_count> <m> <n> <nnz>
+ *       The matrix is m x n with nnz random triplets
+ *
+ * Notes:
+ *     1.  The triplets are appended in batches of BATCH, and the
+ *         triplets_t starts small, so appending includes growing the
+ *         arrays.
+ *     2.  When nnz is close to m*n there are many duplicates.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "timer.h"
+#include "triplets.h"
+
+#define BATCH 1024
+
+/* Global variables */
+int        thread_count;
+int        m, n;
+long       nnz;
+element_t* elements;
+triplets_t trip;
+
+/* Serial functions */
+void Usage(char* prog_name);
+int  Compare_elements(const void* a_p, const void* b_p);
+long Sort_elements(element_t elts[], long count);
+int  Check_csr(csr_t* csr, element_t elts[], long count);
+
+/* Parallel function */
+void *Gen_triplets(void* rank);
+
+/*------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long       thread, i, aos_count, diag;
+   pthread_t* thread_handles;
+   double start, finish, sum;
+   csr_t csr;
+
+   if (argc != 5) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   m = strtol(argv[2], NULL, 10);
+   n = strtol(argv[3], NULL, 10);
+   nnz = strtol(argv[4], NULL, 10);
+   if (thread_count < 1 || m < 1 || n < 1 || nnz < 1) Usage(argv[0]);
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   elements = malloc(nnz*sizeof(element_t));
+   Trip_init(&trip, 0);
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+         Gen_triplets, (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   GET_TIME(finish);
+   printf("Generate and append:      %e seconds\n", finish - start);
+
+   /* Loops that use some of the members */
+   GET_TIME(start);
+   sum = 0.0;
+   for (i = 0; i < nnz; i++)
+      if (elements[i].row < m/2) sum += elements[i].value;
+   GET_TIME(finish);
+   printf("Half row sum, AoS:        %e seconds, %.1f M triplets/s"
+         " (sum = %.6e)\n", finish - start, nnz/(finish - start)/1.0e6,
+         sum);
+   GET_TIME(start);
+   sum = 0.0;
+   for (i = 0; i < trip.count; i++)
+      if (trip.rows[i] < m/2) sum += trip.values[i];
+   GET_TIME(finish);
+   printf("Half row sum, SoA:        %e seconds, %.1f M triplets/s"
+         " (sum = %.6e)\n", finish - start, nnz/(finish - start)/1.0e6,
+         sum);
+
+   GET_TIME(start);
+   diag = 0;
+   for (i = 0; i < nnz; i++)
+      if (elements[i].row == elements[i].col) diag++;
+   GET_TIME(finish);
+   printf("Diagonal count, AoS:      %e seconds, %.1f M triplets/s"
+         " (count = %ld)\n", finish - start, nnz/(finish - start)/1.0e6,
+         diag);
+   GET_TIME(start);
+   diag = 0;
+   for (i = 0; i < trip.count; i++)
+      diag += (trip.rows[i] == trip.cols[i]);
+   GET_TIME(finish);
+   printf("Diagonal count, SoA:      %e seconds, %.1f M triplets/s"
+         " (count = %ld)\n", finish - start, nnz/(finish - start)/1.0e6,
+         diag);
+
+   /* Sort and add duplicates */
+   GET_TIME(start);
+   aos_count = Sort_elements(elements, nnz);
+   GET_TIME(finish);
+   printf("Sort, AoS qsort:          %e seconds, %.1f M triplets/s\n",
+         finish - start, nnz/(finish - start)/1.0e6);
+   GET_TIME(start);
+   Trip_sort(&trip, n, thread_count);
+   GET_TIME(finish);
+   printf("Sort, SoA radix:          %e seconds, %.1f M triplets/s\n",
+         finish - start, nnz/(finish - start)/1.0e6);
+   printf("%ld distinct (row, col) of %ld triplets\n", trip.count, nnz);
+
+   GET_TIME(start);
+   Trip_to_csr(&trip, m, &csr, thread_count);
+   GET_TIME(finish);
+   printf("Convert to CSR:           %e seconds\n", finish - start);
+
+   if (Check_csr(&csr, elements, aos_count))
+      printf("CSR matches the sorted AoS triplets\n");
+   else
+      printf("CSR doesn't match the sorted AoS triplets\n");
+
+   Csr_free(&csr);
+   Trip_free(&trip);
+   free(elements);
+   free(thread_handles);
+
+   return 0;
+}  /* main */
+
+
+/*------------------------------------------------------------------
+ * Function:  Usage
+ * Purpose:   print a message showing what the command line should
+ *            be, and terminate
+ * In arg :   prog_name
+ */
+void Usage (char* prog_name) {
+   fprintf(stderr, "usage: %s <thread_count> <m> <n> <nnz>\n", prog_name);
+   fprintf(stderr, "   The matrix is m x n with nnz random triplets\n");
+   exit(0);
+}  /* Usage */
+
+
+/*------------------------------------------------------------------
+ * Function:       Gen_triplets
+ * Purpose:        Generate the thread's block of triplets, store them
+ *                 in elements, and append them to trip in batches
+ * In arg:         rank
+ * Global in vars: m, n, nnz, thread_count
+ * Global out var: elements, trip
+ */
+void *Gen_triplets(void* rank) {
+   long my_rank = (long) rank;
+   long my_first = nnz*my_rank/thread_count;
+   long my_last = nnz*(my_rank + 1)/thread_count;
+   unsigned seed = my_rank + 1;
+   int rows[BATCH], cols[BATCH];
+   double values[BATCH];
+   long i;
+   int b = 0;
+
+   for (i = my_first; i < my_last; i++) {
+      rows[b] = elements[i].row = rand_r(&seed) % m;
+      cols[b] = elements[i].col = rand_r(&seed) % n;
+      values[b] = elements[i].value = rand_r(&seed)/((double) RAND_MAX);
+      if (++b == BATCH) {
+         Trip_append(&trip, rows, cols, values, b);
+         b = 0;
+      }
+   }
+   if (b > 0) Trip_append(&trip, rows, cols, values, b);
+
+   return NULL;
+}  /* Gen_triplets */
+
+
+/*------------------------------------------------------------------
+ * Function:    Compare_elements
+ * Purpose:     Compare two element_t's by row and then col for qsort
+ */
+int Compare_elements(const void* a_p, const void* b_p) {
+   const element_t* a = (const element_t*) a_p;
+   const element_t* b = (const element_t*) b_p;
+
+   if (a->row != b->row) return (a->row < b->row) ? -1 : 1;
+   if (a->col != b->col) return (a->col < b->col) ? -1 : 1;
+   return 0;
+}  /* Compare_elements */
+
+
+/*------------------------------------------------------------------
+ * Function:    Sort_elements
+ * Purpose:     Sort elts by (row, col) and replace elements with the
+ *              same row and col by one element with the sum of their
+ *              values
+ * Return val:  The number of elements left
+ */
+long Sort_elements(element_t elts[], long count) {
+   long i, dest = 0;
+
+   qsort(elts, count, sizeof(element_t), Compare_elements);
+   for (i = 0; i < count; i++)
+      if (dest > 0 && elts[dest-1].row == elts[i].row &&
+            elts[dest-1].col == elts[i].col)
+         elts[dest-1].value += elts[i].value;
+      else
+         elts[dest++] = elts[i];
+   return dest;
+}  /* Sort_elements */
+
+
+/*------------------------------------------------------------------
+ * Function:    Check_csr
+ * Purpose:     Check that csr has the same entries as the sorted
+ *              elements
+ * Return val:  1 if they're the same, 0 otherwise
+ * Note:        The values may have been added in different orders, so
+ *              they're compared with a relative tolerance.
+ */
+int Check_csr(csr_t* csr, element_t elts[], long count) {
+   long e = 0, k;
+   int i;
+
+   if (csr->nnz != count || csr->row_ptr[0] != 0) return 0;
+   for (i = 0; i < csr->m; i++)
+      for (k = csr->row_ptr[i]; k < csr->row_ptr[i+1]; k++, e++)
+         if (elts[e].row != i || elts[e].col != csr->col_idx[k] ||
+               fabs(elts[e].value - csr->values[k]) >
+               1.0e-12*fabs(elts[e].value))
+            return 0;
+   return e == count;
+}  /* Check_csr */
@@ -0,0 +1,411 @@
+/* File:     triplets.c
+ *
+ * Purpose:  Implement the triplet container and the COO to CSR
+ *           conversion declared in triplets.h
+ *
+ * Compile:  Link with a program that uses triplets.h.  Needs -lpthread.
+ *
+ * Notes:
+ * 1.  Trip_sort and Trip_to_csr start thread_count threads, which
+ *     divide the triplets into contiguous blocks and synchronize with a
+ *     barrier between steps.  Everything the threads share is stored in
+ *     a team_t.
+ * 2.  Trip_sort uses two arrays of keys and two arrays of values as
+ *     scratch:  32 bytes per triplet.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "triplets.h"
+
+#define RADIX_BITS 8
+#define RADIX (1 << RADIX_BITS)
+
+typedef struct {
+   triplets_t* trip;
+   csr_t*  csr;
+   int     n;                    /* Number of cols */
+   int     thread_count;
+   pthread_barrier_t barrier;
+   unsigned long *keys, *keys_tmp;
+   double  *vals, *vals_tmp;
+   unsigned long* max_keys;      /* One per thread */
+   long*   hist;                 /* RADIX per thread */
+   long*   block_sums;           /* thread_count + 1 */
+} team_t;
+
+typedef struct {
+   team_t* team;
+   int     rank;
+} member_t;
+
+static void  Run_team(team_t* team, void* (*fn)(void*));
+static void  Block(int rank, int thread_count, long total, long* first_p,
+      long* last_p);
+static long  Exclusive_scan(long x[], int count);
+static void* Sort_thread(void* member);
+static void* Csr_thread(void* member);
+
+/*-------------------------------------------------------------------
+ * Function:   Trip_init
+ * Purpose:    Initialize an empty container with room for capacity
+ *             triplets
+ */
+void Trip_init(triplets_t* trip, long capacity) {
+   if (capacity < 1024) capacity = 1024;
+   trip->rows = malloc(capacity*sizeof(int));
+   trip->cols = malloc(capacity*sizeof(int));
+   trip->values = malloc(capacity*sizeof(double));
+   trip->count = 0;
+   trip->capacity = capacity;
+   pthread_rwlock_init(&trip->lock, NULL);
+}  /* Trip_init */
+
+/*-------------------------------------------------------------------
+ * Function:   Trip_free
+ * Purpose:    Free the storage used by a container
+ */
+void Trip_free(triplets_t* trip) {
+   free(trip->rows);
+   free(trip->cols);
+   free(trip->values);
+   pthread_rwlock_destroy(&trip->lock);
+}  /* Trip_free */
+
+/*-------------------------------------------------------------------
+ * Function:   Trip_append
+ * Purpose:    Add count triplets to the end of a container.  Can be
+ *             called by several threads at the same time.
+ * Note:       Space for the triplets is reserved before the arrays are
+ *             checked, so the reservation stays valid if the arrays
+ *             have to grow:  the thread that grows them waits for the
+ *             write lock, i.e., until no thread is copying.
+ */
+void Trip_append(triplets_t* trip, const int rows[], const int cols[],
+      const double values[], long count) {
+   long start, new_capacity;
+
+   pthread_rwlock_rdlock(&trip->lock);
+   start = __atomic_fetch_add(&trip->count, count, __ATOMIC_RELAXED);
+   while (start + count > trip->capacity) {
+      pthread_rwlock_unlock(&trip->lock);
+      pthread_rwlock_wrlock(&trip->lock);
+      if (start + count > trip->capacity) {
+         new_capacity = 2*trip->capacity;
+         while (new_capacity < start + count)
+            new_capacity *= 2;
+         trip->rows = realloc(trip->rows, new_capacity*sizeof(int));
+         trip->cols = realloc(trip->cols, new_capacity*sizeof(int));
+         trip->values = realloc(trip->values, new_capacity*sizeof(double));
+         if (trip->rows == NULL || trip->cols == NULL ||
+               trip->values == NULL) {
+            fprintf(stderr, "Trip_append:  can't allocate %ld triplets\n",
+                  new_capacity);
+            exit(-1);
+         }
+         trip->capacity = new_capacity;
+      }
+      pthread_rwlock_unlock(&trip->lock);
+      pthread_rwlock_rdlock(&trip->lock);
+   }
+
+   memcpy(trip->rows + start, rows, count*sizeof(int));
+   memcpy(trip->cols + start, cols, count*sizeof(int));
+   memcpy(trip->values + start, values, count*sizeof(double));
+   pthread_rwlock_unlock(&trip->lock);
+}  /* Trip_append */
+
+/*-------------------------------------------------------------------
+ * Function:   Trip_append_one
+ * Purpose:    Add a single triplet to the end of a container
+ */
+void Trip_append_one(triplets_t* trip, int row, int col, double value) {
+   Trip_append(trip, &row, &col, &value, 1);
+}  /* Trip_append_one */
+
+/*-------------------------------------------------------------------
+ * Function:   Run_team
+ * Purpose:    Start team->thread_count threads running fn, and wait
+ *             for them to finish
+ */
+static void Run_team(team_t* team, void* (*fn)(void*)) {
+   pthread_t* handles = malloc(team->thread_count*sizeof(pthread_t));
+   member_t* members = malloc(team->thread_count*sizeof(member_t));
+   int rank;
+
+   pthread_barrier_init(&team->barrier, NULL, team->thread_count);
+   for (rank = 0; rank < team->thread_count; rank++) {
+      members[rank].team = team;
+      members[rank].rank = rank;
+      pthread_create(&handles[rank], NULL, fn, &members[rank]);
+   }
+   for (rank = 0; rank < team->thread_count; rank++)
+      pthread_join(handles[rank], NULL);
+   pthread_barrier_destroy(&team->barrier);
+
+   free(handles);
+   free(members);
+}  /* Run_team */
+
+/*-------------------------------------------------------------------
+ * Function:   Block
+ * Purpose:    Find the block [first, last) of 0, 1, ..., total-1
+ *             assigned to thread rank
+ */
+static void Block(int rank, int thread_count, long total, long* first_p,
+      long* last_p) {
+   long quotient = total/thread_count;
+   long remainder = total % thread_count;
+
+   if (rank < remainder) {
+      *first_p = rank*(quotient + 1);
+      *last_p = *first_p + quotient + 1;
+   } else {
+      *first_p = rank*quotient + remainder;
+      *last_p = *first_p + quotient;
+   }
+}  /* Block */
+
+/*-------------------------------------------------------------------
+ * Function:   Exclusive_scan
+ * Purpose:    Replace x[i] by x[0] + ... + x[i-1], and return the
+ *             sum of all the elements
+ */
+static long Exclusive_scan(long x[], int count) {
+   long sum = 0, tmp;
+   int i;
+
+   for (i = 0; i < count; i++) {
+      tmp = x[i];
+      x[i] = sum;
+      sum += tmp;
+   }
+   return sum;
+}  /* Exclusive_scan */
+
+/*-------------------------------------------------------------------
+ * Function:   Trip_sort
+ * Purpose:    Sort the triplets by row, and by col within a row, and
+ *             replace triplets with the same row and col by a single
+ *             triplet whose value is the sum of their values
+ * In args:    n:  number of cols
+ *             thread_count
+ * In/out:     trip
+ */
+void Trip_sort(triplets_t* trip, int n, int thread_count) {
+   team_t team;
+   long count = trip->count;
+
+   if (count == 0) return;
+   team.trip = trip;
+   team.n = n;
+   team.thread_count = thread_count;
+   team.keys = malloc(count*sizeof(unsigned long));
+   team.keys_tmp = malloc(count*sizeof(unsigned long));
+   team.vals = malloc(count*sizeof(double));
+   team.vals_tmp = malloc(count*sizeof(double));
+   team.max_keys = malloc(thread_count*sizeof(unsigned long));
+   team.hist = malloc(thread_count*RADIX*sizeof(long));
+   team.block_sums = malloc((thread_count + 1)*sizeof(long));
+
+   Run_team(&team, Sort_thread);
+   trip->count = team.block_sums[thread_count];
+
+   free(team.keys);
+   free(team.keys_tmp);
+   free(team.vals);
+   free(team.vals_tmp);
+   free(team.max_keys);
+   free(team.hist);
+   free(team.block_sums);
+}  /* Trip_sort */
+
+/*-------------------------------------------------------------------
+ * Function:   Sort_thread
+ * Purpose:    Thread function for Trip_sort
+ * Note:       In each pass, thread rank counts the digits of the keys
+ *             in its block.  Then the counts are scanned in the order
+ *             (digit 0, thread 0), (digit 0, thread 1), . . .
+ *             (digit 1, thread 0), . . ., so each thread knows where
+ *             to put its first key with each digit, and the sort is
+ *             stable.
+ */
+static void* Sort_thread(void* member) {
+   member_t* me = (member_t*) member;
+   team_t* team = me->team;
+   triplets_t* trip = team->trip;
+   int rank = me->rank, thread_count = team->thread_count;
+   long count = trip->count, first, last, i, j, dest, sum, *my_hist;
+   unsigned long *src_keys = team->keys, *dest_keys = team->keys_tmp;
+   double *src_vals = team->vals, *dest_vals = team->vals_tmp, *dp, total;
+   unsigned long key, max_key, *up;
+   int pass, passes, shift, d, q;
+
+   Block(rank, thread_count, count, &first, &last);
+   my_hist = team->hist + rank*RADIX;
+
+   /* Build the keys */
+   max_key = 0;
+   for (i = first; i < last; i++) {
+      key = ((unsigned long) trip->rows[i])*team->n + trip->cols[i];
+      src_keys[i] = key;
+      src_vals[i] = trip->values[i];
+      if (key > max_key) max_key = key;
+   }
+   team->max_keys[rank] = max_key;
+   pthread_barrier_wait(&team->barrier);
+   for (q = 0; q < thread_count; q++)
+      if (team->max_keys[q] > max_key) max_key = team->max_keys[q];
+
+   /* Radix sort:  one pass for each RADIX_BITS bits of max_key */
+   passes = 1;
+   while (passes*RADIX_BITS < 64 && (max_key >> passes*RADIX_BITS) != 0)
+      passes++;
+   for (pass = 0; pass < passes; pass++) {
+      shift = pass*RADIX_BITS;
+      memset(my_hist, 0, RADIX*sizeof(long));
+      for (i = first; i < last; i++)
+         my_hist[(src_keys[i] >> shift) & (RADIX-1)]++;
+      pthread_barrier_wait(&team->barrier);
+
+      if (rank == 0) {
+         sum = 0;
+         for (d = 0; d < RADIX; d++)
+            for (q = 0; q < thread_count; q++) {
+               dest = team->hist[q*RADIX + d];
+               team->hist[q*RADIX + d] = sum;
+               sum += dest;
+            }
+      }
+      pthread_barrier_wait(&team->barrier);
+
+      for (i = first; i < last; i++) {
+         dest = my_hist[(src_keys[i] >> shift) & (RADIX-1)]++;
+         dest_keys[dest] = src_keys[i];
+         dest_vals[dest] = src_vals[i];
+      }
+      pthread_barrier_wait(&team->barrier);
+
+      up = src_keys; src_keys = dest_keys; dest_keys = up;
+      dp = src_vals; src_vals = dest_vals; dest_vals = dp;
+   }
+
+   /* Count the first triplet of each run of equal keys in my block */
+   sum = 0;
+   for (i = first; i < last; i++)
+      if (i == 0 || src_keys[i] != src_keys[i-1]) sum++;
+   team->block_sums[rank] = sum;
+   pthread_barrier_wait(&team->barrier);
+   if (rank == 0)
+      team->block_sums[thread_count] =
+         Exclusive_scan(team->block_sums, thread_count);
+   pthread_barrier_wait(&team->barrier);
+
+   /* Sum each run whose first triplet is in my block.  The run may
+    * continue into the next thread's block. */
+   dest = team->block_sums[rank];
+   for (i = first; i < last; i++) {
+      if (i > 0 && src_keys[i] == src_keys[i-1]) continue;
+      total = src_vals[i];
+      for (j = i + 1; j < count && src_keys[j] == src_keys[i]; j++)
+         total += src_vals[j];
+      trip->rows[dest] = src_keys[i]/team->n;
+      trip->cols[dest] = src_keys[i] % team->n;
+      trip->values[dest] = total;
+      dest++;
+   }
+
+   return NULL;
+}  /* Sort_thread */
+
+/*-------------------------------------------------------------------
+ * Function:   Trip_to_csr
+ * Purpose:    Convert the triplets to CSR format
+ * In args:    trip:  should be sorted by Trip_sort
+ *             m:  number of rows
+ *             thread_count
+ * Out arg:    csr:  free with Csr_free
+ */
+void Trip_to_csr(const triplets_t* trip, int m, csr_t* csr,
+      int thread_count) {
+   team_t team;
+
+   csr->m = m;
+   csr->nnz = trip->count;
+   csr->row_ptr = calloc(m + 1, sizeof(long));
+   csr->col_idx = malloc((trip->count + 1)*sizeof(int));
+   csr->values = malloc((trip->count + 1)*sizeof(double));
+
+   team.trip = (triplets_t*) trip;
+   team.csr = csr;
+   team.thread_count = thread_count;
+   team.block_sums = malloc((thread_count + 1)*sizeof(long));
+   Run_team(&team, Csr_thread);
+   free(team.block_sums);
+}  /* Trip_to_csr */
+
+/*-------------------------------------------------------------------
+ * Function:   Csr_thread
+ * Purpose:    Thread function for Trip_to_csr
+ * Note:       row_ptr[r+1] is first set to the number of nonzeroes in
+ *             row r, and then the counts are replaced by their prefix
+ *             sums:  each thread adds up the counts in its block of
+ *             rows, the block sums are scanned, and then each thread
+ *             scans its block starting from the sum of the preceding
+ *             blocks.
+ */
+static void* Csr_thread(void* member) {
+   member_t* me = (member_t*) member;
+   team_t* team = me->team;
+   const triplets_t* trip = team->trip;
+   csr_t* csr = team->csr;
+   int rank = me->rank, thread_count = team->thread_count;
+   long first, last, i, run_start, sum, tmp;
+
+   /* Count the nonzeroes in each row.  The triplets are sorted, so
+    * a run of a row is added with one atomic add:  only the rows at
+    * the ends of the block can be shared with another thread. */
+   Block(rank, thread_count, trip->count, &first, &last);
+   for (run_start = first; run_start < last; run_start = i) {
+      for (i = run_start + 1;
+            i < last && trip->rows[i] == trip->rows[run_start]; i++);
+      __atomic_fetch_add(&csr->row_ptr[trip->rows[run_start] + 1],
+            i - run_start, __ATOMIC_RELAXED);
+   }
+   memcpy(csr->col_idx + first, trip->cols + first,
+         (last - first)*sizeof(int));
+   memcpy(csr->values + first, trip->values + first,
+         (last - first)*sizeof(double));
+   pthread_barrier_wait(&team->barrier);
+
+   /* Prefix sums of the counts in row_ptr[1], . . ., row_ptr[m] */
+   Block(rank, thread_count, csr->m, &first, &last);
+   sum = 0;
+   for (i = first + 1; i <= last; i++)
+      sum += csr->row_ptr[i];
+   team->block_sums[rank] = sum;
+   pthread_barrier_wait(&team->barrier);
+   if (rank == 0)
+      team->block_sums[thread_count] =
+         Exclusive_scan(team->block_sums, thread_count);
+   pthread_barrier_wait(&team->barrier);
+   sum = team->block_sums[rank];
+   for (i = first + 1; i <= last; i++) {
+      tmp = csr->row_ptr[i];
+      csr->row_ptr[i] = sum + tmp;
+      sum += tmp;
+   }
+
+   return NULL;
+}  /* Csr_thread */
+
+/*-------------------------------------------------------------------
+ * Function:   Csr_free
+ * Purpose:    Free the storage used by a CSR matrix
+ */
+void Csr_free(csr_t* csr) {
+   free(csr->row_ptr);
+   free(csr->col_idx);
+   free(csr->values);
+}  /* Csr_free */
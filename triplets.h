@@ -0,0 +1,81 @@
+/* File:     triplets.h
+ *
+ * Purpose:  Store the nonzero entries of a sparse matrix as (row, col,
+ *           value) triplets -- coordinate or COO format -- and convert
+ *           them to compressed sparse row (CSR) format using Pthreads.
+ *
+ *           The element_t struct (see structs3.c) is one triplet.
+ *           Storing an array of element_t's is an "array of structs"
+ *           (AoS).  A triplets_t is a "struct of arrays" (SoA):  the
+ *           rows, the cols, and the values are stored in three separate
+ *           arrays, so a loop that only uses some of the members only
+ *           reads those members, and the arrays can be processed with
+ *           vector instructions.
+ *
+ * Compile:  Link with triplets.c.  Needs -lpthread.
+ *
+ * Example:
+ *    triplets_t trip;
+ *    csr_t csr;
+ *    . . .
+ *    Trip_init(&trip, 0);
+ *    . . .
+ *    // In any number of threads at the same time
+ *    Trip_append(&trip, my_rows, my_cols, my_vals, my_count);
+ *    . . .
+ *    Trip_sort(&trip, n, thread_count);  // Sort, add duplicates
+ *    Trip_to_csr(&trip, m, &csr, thread_count);
+ *    . . .
+ *    Csr_free(&csr);
+ *    Trip_free(&trip);
+ *
+ * Notes:
+ * 1.  Trip_append reserves space by atomically adding to the count,
+ *     and copies under a read lock, so threads can append at the same
+ *     time.  When the arrays are full, the thread that finds them full
+ *     takes the write lock and doubles them.
+ * 2.  Trip_sort is a parallel least significant digit radix sort of
+ *     the keys row*n + col, 8 bits per pass, so it takes time linear in
+ *     the number of triplets.  After sorting, triplets with the same row
+ *     and col are replaced by a single triplet whose value is their sum.
+ * 3.  Rows and cols should be in the ranges 0 <= row < m, 0 <= col < n.
+ */
+#ifndef _TRIPLETS_H_
+#define _TRIPLETS_H_
+
+#include <pthread.h>
+
+typedef struct {
+   double value;
+   int    row;
+   int    col;
+} element_t;
+
+typedef struct {
+   int*    rows;
+   int*    cols;
+   double* values;
+   long    count;      /* Number of triplets stored */
+   long    capacity;   /* Number of triplets allocated */
+   pthread_rwlock_t lock;
+} triplets_t;
+
+typedef struct {
+   int     m;          /* Number of rows */
+   long    nnz;        /* Number of nonzeroes */
+   long*   row_ptr;    /* m+1 entries:  row i is [row_ptr[i], row_ptr[i+1]) */
+   int*    col_idx;
+   double* values;
+} csr_t;
+
+void Trip_init(triplets_t* trip, long capacity);
+void Trip_free(triplets_t* trip);
+void Trip_append(triplets_t* trip, const int rows[], const int cols[],
+      const double values[], long count);
+void Trip_append_one(triplets_t* trip, int row, int col, double value);
+void Trip_sort(triplets_t* trip, int n, int thread_count);
+void Trip_to_csr(const triplets_t* trip, int m, csr_t* csr,
+      int thread_count);
+void Csr_free(csr_t* csr);
+
+#endif